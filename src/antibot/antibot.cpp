@@ -3,10 +3,183 @@
 // for antibot module
 //-----------------------------------------------------
 #include <antibot/antibot.h>
+#include <checkqueue.h>
 #include <index/addrindex.h>
 //-----------------------------------------------------
 std::unique_ptr<AntiBot> g_antibot;
 //-----------------------------------------------------
+static CCheckQueue<AntiBotCheck> antibotcheckqueue(8);
+
+void ThreadAntiBotCheck()
+{
+    RenameThread("pocketcoin-antibot");
+    antibotcheckqueue.Thread();
+}
+
+bool AntiBotCheck::operator()()
+{
+    for (const UniValue* mtx : items) {
+        ANTIBOTRESULT resultCode = ANTIBOTRESULT::Success;
+        g_antibot->CheckTransactionRIItem(*mtx, *blockVtx, false, height, resultCode);
+        if (resultCode != ANTIBOTRESULT::Success) return false;
+    }
+
+    return true;
+}
+
+void AntiBotCheck::swap(AntiBotCheck& check)
+{
+    items.swap(check.items);
+    std::swap(blockVtx, check.blockVtx);
+    std::swap(height, check.height);
+}
+//-----------------------------------------------------
+std::unique_ptr<AntiBotTxQueue> g_antibot_txqueue;
+
+bool AntiBotTxQueue::Submit(NodeId node, const CTransactionRef& tx, const PocketTxData& data, int height)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (queue.size() >= MAX_ANTIBOT_TX_QUEUE)
+            return false;
+
+        // One peer can not take whole queue
+        auto it = pending.find(node);
+        if (it != pending.end() && it->second >= MAX_ANTIBOT_TX_QUEUE_PEER)
+            return false;
+
+        AntiBotTxCheck check;
+        check.node = node;
+        check.tx = tx;
+        check.data = data;
+        check.height = height;
+        queue.push_back(std::move(check));
+        pending[node]++;
+    }
+
+    cond.notify_one();
+    return true;
+}
+
+std::vector<AntiBotTxCheck> AntiBotTxQueue::TakeReady(NodeId node)
+{
+    std::vector<AntiBotTxCheck> result;
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    auto it = ready.find(node);
+    if (it != ready.end()) {
+        result.swap(it->second);
+        ready.erase(it);
+    }
+
+    return result;
+}
+
+void AntiBotTxQueue::Forget(NodeId node)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    ready.erase(node);
+    if (pending.count(node))
+        disconnected.insert(node);
+}
+
+bool AntiBotTxQueue::GetResult(const uint256& txid, const PocketTxData& data, int height, ANTIBOTRESULT& result)
+{
+    ResultKey key(txid, data.GetHash());
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return getResult(key, height, result);
+}
+
+bool AntiBotTxQueue::getResult(const ResultKey& key, int height, ANTIBOTRESULT& result)
+{
+    auto it = results.find(key);
+    if (it == results.end() || it->second.first != height)
+        return false;
+
+    result = it->second.second;
+    return true;
+}
+
+void AntiBotTxQueue::cacheResult(const ResultKey& key, int height, ANTIBOTRESULT result)
+{
+    if (results.find(key) == results.end())
+        resultsOrder.push_back(key);
+    results[key] = std::make_pair(height, result);
+
+    while (results.size() > MAX_ANTIBOT_TX_RESULTS) {
+        results.erase(resultsOrder.front());
+        resultsOrder.pop_front();
+    }
+}
+
+void AntiBotTxQueue::check(AntiBotTxCheck& item, bool runAntibot)
+{
+    try {
+        item.rtx = RTransaction(item.tx);
+        item.rtx.pTable = item.data.table;
+        item.rtx.pTransaction = g_pocketdb->DB()->NewItem(item.rtx.pTable);
+        reindexer::Error err = item.rtx.pTransaction.FromJSON(item.data.data);
+        if (!err.ok()) {
+            LogPrintf("AntiBotTxQueue: bad pocket data of transaction %s: %s\n", item.tx->GetHash().GetHex(), err.what());
+            item.failed = true;
+            return;
+        }
+
+        if (runAntibot)
+            g_antibot->CheckTransactionRIItem(g_addrindex->GetUniValue(item.rtx, item.rtx.pTransaction, item.rtx.pTable), item.height, item.result);
+    } catch (const std::exception& e) {
+        LogPrintf("AntiBotTxQueue: bad pocket data of transaction %s: %s\n", item.tx->GetHash().GetHex(), e.what());
+        item.failed = true;
+    }
+}
+
+void AntiBotTxQueue::Thread()
+{
+    while (true) {
+        AntiBotTxCheck item;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queue.empty())
+                cond.wait(lock); // Interruption point
+            item = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        // Copy of transaction with same pocket data from another peer may be already checked
+        ResultKey key(item.tx->GetHash(), item.data.GetHash());
+        bool cached;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            cached = getResult(key, item.height, item.result);
+        }
+        check(item, !cached);
+
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (!item.failed)
+                cacheResult(key, item.height, item.result);
+
+            NodeId node = item.node;
+            if (!disconnected.count(node))
+                ready[node].push_back(std::move(item));
+
+            if (--pending[node] == 0) {
+                pending.erase(node);
+                disconnected.erase(node);
+            }
+        }
+
+        if (g_connman)
+            g_connman->WakeMessageHandler();
+    }
+}
+
+void ThreadAntiBotTxCheck()
+{
+    RenameThread("pocketcoin-antibottx");
+    g_antibot_txqueue->Thread();
+}
+//-----------------------------------------------------
 AntiBot::AntiBot()
 {
 }
@@ -115,7 +288,7 @@ bool AntiBot::CheckRegistration(UniValue oitm, std::string address, bool checkMe
 
     // Or maybe registration in this block?
     if (userType < 0 && blockVtx.Exists("Users")) {
-        for (auto& mtx : blockVtx.Data["Users"]) {
+        for (auto& mtx : blockVtx.Data.at("Users")) {
             if (mtx["txid"].get_str() != txId && mtx["address"].get_str() == address) {
                 if (!checkTime_19_3 || mtx["time"].get_int64() <= time)
                     userType = mtx["userType"].get_int();
@@ -237,7 +410,7 @@ bool AntiBot::check_post(const UniValue oitm, BlockVTX& blockVtx, bool checkMemp
 
     // Check block
     if (blockVtx.Exists("Posts")) {
-        for (auto& mtx : blockVtx.Data["Posts"]) {
+        for (auto& mtx : blockVtx.Data.at("Posts")) {
             if (mtx["txid"].get_str() != _txid && mtx["address"].get_str() == _address && mtx["txidEdit"].get_str().empty()) {
                 if (!checkTime_19_3 || mtx["time"].get_int64() <= _time)
                     postsCount += 1;
@@ -317,7 +490,7 @@ bool AntiBot::check_post_edit(const UniValue& oitm, BlockVTX& blockVtx, bool che
 
     // Double edit in block denied
     if (blockVtx.Exists("Posts")) {
-        for (auto& mtx : blockVtx.Data["Posts"]) {
+        for (auto& mtx : blockVtx.Data.at("Posts")) {
             if (mtx["txid"].get_str() == _txid && mtx["txidEdit"].get_str() != _txidEdit) {
                 result = ANTIBOTRESULT::DoublePostEdit;
                 return false;
@@ -385,7 +558,7 @@ bool AntiBot::check_score(const UniValue oitm, BlockVTX& blockVtx, bool checkMem
 
         // Maybe in current block?
         if (blockVtx.Exists("Posts")) {
-            for (auto& mtx : blockVtx.Data["Posts"]) {
+            for (auto& mtx : blockVtx.Data.at("Posts")) {
                 if (mtx["txid"].get_str() == _post) {
                     _post_address = mtx["address"].get_str();
                     not_found = false;
@@ -454,7 +627,7 @@ bool AntiBot::check_score(const UniValue oitm, BlockVTX& blockVtx, bool checkMem
 
     // Check block
     if (blockVtx.Exists("Scores")) {
-        for (auto& mtx : blockVtx.Data["Scores"]) {
+        for (auto& mtx : blockVtx.Data.at("Scores")) {
             if (mtx["txid"].get_str() != _txid && mtx["address"].get_str() == _address) {
                 if (!checkTime_19_3 || mtx["time"].get_int64() <= _time)
                     scoresCount += 1;
@@ -528,7 +701,7 @@ bool AntiBot::check_complain(const UniValue oitm, BlockVTX& blockVtx, bool check
 
         // Maybe in current block?
         if (blockVtx.Exists("Posts")) {
-            for (auto& mtx : blockVtx.Data["Posts"]) {
+            for (auto& mtx : blockVtx.Data.at("Posts")) {
                 if (mtx["txid"].get_str() == _post) {
                     not_found = false;
                     break;
@@ -600,7 +773,7 @@ bool AntiBot::check_complain(const UniValue oitm, BlockVTX& blockVtx, bool check
 
     // Check block
     if (blockVtx.Exists("Complains")) {
-        for (auto& mtx : blockVtx.Data["Complains"]) {
+        for (auto& mtx : blockVtx.Data.at("Complains")) {
             if (mtx["txid"].get_str() != _txid && mtx["address"].get_str() == _address) {
                 if (!checkTime_19_3 || mtx["time"].get_int64() <= _time)
                     complainCount += 1;
@@ -679,7 +852,7 @@ bool AntiBot::check_changeInfo(const UniValue oitm, BlockVTX& blockVtx, bool che
 
     // Check block
     if (blockVtx.Exists("Users")) {
-        for (auto& mtx : blockVtx.Data["Users"]) {
+        for (auto& mtx : blockVtx.Data.at("Users")) {
             if (mtx["address"].get_str() == _address && mtx["txid"].get_str() != _txid) {
                 result = ANTIBOTRESULT::ChangeInfoLimit;
                 return false;
@@ -751,7 +924,7 @@ bool AntiBot::check_subscribe(const UniValue oitm, BlockVTX& blockVtx, bool chec
 
     // Check block
     if (blockVtx.Exists("Subscribes")) {
-        for (auto& mtx : blockVtx.Data["Subscribes"]) {
+        for (auto& mtx : blockVtx.Data.at("Subscribes")) {
             if (mtx["txid"].get_str() != _txid && mtx["address"].get_str() == _address && mtx["address_to"].get_str() == _address_to) {
                 result = ANTIBOTRESULT::ManyTransactions;
                 return false;
@@ -834,7 +1007,7 @@ bool AntiBot::check_blocking(const UniValue oitm, BlockVTX& blockVtx, bool check
 
     // Check block
     if (blockVtx.Exists("Blocking")) {
-        for (auto& mtx : blockVtx.Data["Blocking"]) {
+        for (auto& mtx : blockVtx.Data.at("Blocking")) {
             if (mtx["txid"].get_str() != _txid && mtx["address"].get_str() == _address && mtx["address_to"].get_str() == _address_to) {
                 result = ANTIBOTRESULT::ManyTransactions;
                 return false;
@@ -937,7 +1110,7 @@ bool AntiBot::check_comment(const UniValue oitm, BlockVTX& blockVtx, bool checkM
 
         // Check block
         if (blockVtx.Exists("Comment")) {
-            for (auto& mtx : blockVtx.Data["Comment"]) {
+            for (auto& mtx : blockVtx.Data.at("Comment")) {
                 if (mtx["txid"].get_str() != _txid && mtx["address"].get_str() == _address && mtx["otxid"].get_str() == mtx["txid"].get_str()) {
                     if (!checkTime_19_3 || mtx["time"].get_int64() <= _time)
                         commentsCount += 1;
@@ -1027,7 +1200,7 @@ bool AntiBot::check_comment_edit(const UniValue oitm, BlockVTX& blockVtx, bool c
 
     // Double edit in block denied
     if (blockVtx.Exists("Comment")) {
-        for (auto& mtx : blockVtx.Data["Comment"]) {
+        for (auto& mtx : blockVtx.Data.at("Comment")) {
             if (mtx["txid"].get_str() != _txid && mtx["otxid"].get_str() == _otxid) {
                 result = ANTIBOTRESULT::DoubleCommentEdit;
                 return false;
@@ -1112,7 +1285,7 @@ bool AntiBot::check_comment_delete(const UniValue oitm, BlockVTX& blockVtx, bool
 
     // Double delete in block denied
     if (blockVtx.Exists("Comment")) {
-        for (auto& mtx : blockVtx.Data["Comment"]) {
+        for (auto& mtx : blockVtx.Data.at("Comment")) {
             if (mtx["txid"].get_str() != _txid && mtx["otxid"].get_str() == _otxid) {
                 result = ANTIBOTRESULT::DoubleCommentDelete;
                 return false;
@@ -1177,7 +1350,7 @@ bool AntiBot::check_comment_score(const UniValue oitm, BlockVTX& blockVtx, bool
 
         // Maybe in current block?
         if (blockVtx.Exists("Comment")) {
-            for (auto& mtx : blockVtx.Data["Comment"]) {
+            for (auto& mtx : blockVtx.Data.at("Comment")) {
                 if (mtx["otxid"].get_str() == _comment_id && mtx["msg"].get_str() != "") {
                     _comment_address = mtx["address"].get_str();
                     not_found = false;
@@ -1245,7 +1418,7 @@ bool AntiBot::check_comment_score(const UniValue oitm, BlockVTX& blockVtx, bool
 
         // Check block
         if (blockVtx.Exists("CommentScores")) {
-            for (auto& mtx : blockVtx.Data["CommentScores"]) {
+            for (auto& mtx : blockVtx.Data.at("CommentScores")) {
                 if (mtx["txid"].get_str() != _txid && mtx["address"].get_str() == _address) {
                     if (!checkTime_19_3 || mtx["time"].get_int64() <= _time)
                         scoresCount += 1;
@@ -1379,8 +1552,38 @@ bool AntiBot::CheckInputs(CTransactionRef& tx)
     return true;
 }
 
+bool AntiBot::checkBlockParallel(BlockVTX& blockVtx, int height)
+{
+    // Transactions of one address checked sequentially in one job
+    std::map<std::string, AntiBotCheck> partitions;
+    for (auto& t : blockVtx.Data) {
+        for (auto& mtx : t.second) {
+            AntiBotCheck& check = partitions[mtx["address"].get_str()];
+            check.items.push_back(&mtx);
+            check.blockVtx = &blockVtx;
+            check.height = height;
+        }
+    }
+
+    std::vector<AntiBotCheck> vChecks;
+    vChecks.reserve(partitions.size());
+    for (auto& p : partitions) {
+        vChecks.emplace_back();
+        vChecks.back().swap(p.second);
+    }
+
+    CCheckQueueControl<AntiBotCheck> control(&antibotcheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
 bool AntiBot::CheckBlock(BlockVTX& blockVtx, int height)
 {
+    // Parallel pass over addresses. Any failure is reported
+    // by the sequential pass below in the original order.
+    if (nScriptCheckThreads && blockVtx.Size() > 0 && checkBlockParallel(blockVtx, height))
+        return true;
+
     for (auto& t : blockVtx.Data) {
         for (auto& mtx : t.second) {
             ANTIBOTRESULT resultCode = ANTIBOTRESULT::Success;
@@ -8,10 +8,15 @@
 #include "html.h"
 #include "pocketdb/pocketdb.h"
 #include "pocketdb/pocketnet.h"
+#include "primitives/rtransaction.h"
 #include "validation.h"
+#include <net.h>
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <timedata.h>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
 //-----------------------------------------------------
 struct UserStateItem {
     std::string address;
@@ -203,6 +208,9 @@ private:
     // Check new score to comment
     bool check_comment_score(UniValue oitm, BlockVTX& blockVtx, bool checkMempool, bool checkTime_19_3, bool checkTime_19_6, int height, ANTIBOTRESULT& result);
 
+    // Check block transactions grouped by address on antibot check threads
+    bool checkBlockParallel(BlockVTX& blockVtx, int height);
+
 public:
     explicit AntiBot();
     ~AntiBot();
@@ -239,6 +247,96 @@ public:
     bool AllowModifyReputationOverComment(std::string _score_address, std::string _comment_address, int height, const CTransactionRef& tx, bool lottery);
 };
 //-----------------------------------------------------
+/*
+    Closure for check transactions of one address in block.
+    Used with CCheckQueue on antibot check threads
+*/
+class AntiBotCheck
+{
+public:
+    std::vector<const UniValue*> items;
+    BlockVTX* blockVtx = nullptr;
+    int height = 0;
+
+    bool operator()();
+    void swap(AntiBotCheck& check);
+};
+
+// Worker for parallel CheckBlock
+void ThreadAntiBotCheck();
+//-----------------------------------------------------
+// Default threads for antibot checks of relayed transactions
+static const int DEFAULT_ANTIBOT_TX_THREADS = 2;
+// Max relayed transactions waiting for antibot check
+static const size_t MAX_ANTIBOT_TX_QUEUE = 5000;
+// Max relayed transactions of one peer waiting for antibot check
+static const int MAX_ANTIBOT_TX_QUEUE_PEER = 500;
+// Max cached results of antibot checks
+static const size_t MAX_ANTIBOT_TX_RESULTS = 20000;
+
+/*
+    Relayed transaction with pocket data checked by antibot
+*/
+struct AntiBotTxCheck {
+    NodeId node = -1;
+    CTransactionRef tx;
+    PocketTxData data;
+    // Height of block the transaction is checked for
+    int height = 0;
+    // Transaction with decoded reindexer item, filled by check
+    RTransaction rtx;
+    ANTIBOTRESULT result = ANTIBOTRESULT::Success;
+    // Pocket data is not valid JSON for table
+    bool failed = false;
+};
+
+/*
+    Antibot checks of relayed transactions outside of cs_main.
+    Message handler queues transaction and continues with other
+    messages. Check threads decode pocket data, run antibot and
+    return transaction to the peer's ready list, then wake message
+    handler to accept it to mempool.
+    Results are cached by txid and hash of pocket data for the height of check.
+*/
+class AntiBotTxQueue
+{
+private:
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::deque<AntiBotTxCheck> queue;
+    std::map<NodeId, std::vector<AntiBotTxCheck>> ready;
+    // Checks in progress by peer, results of disconnected peers are dropped
+    std::map<NodeId, int> pending;
+    std::set<NodeId> disconnected;
+    // <<txid, data hash>, <height, result>>, oldest first in resultsOrder
+    typedef std::pair<uint256, uint256> ResultKey;
+    std::map<ResultKey, std::pair<int, ANTIBOTRESULT>> results;
+    std::deque<ResultKey> resultsOrder;
+
+    bool getResult(const ResultKey& key, int height, ANTIBOTRESULT& result);
+    void cacheResult(const ResultKey& key, int height, ANTIBOTRESULT result);
+    /* Decode pocket data and run antibot for transaction */
+    void check(AntiBotTxCheck& item, bool runAntibot);
+
+public:
+    /* Queue check, false if queue or quota of peer is full */
+    bool Submit(NodeId node, const CTransactionRef& tx, const PocketTxData& data, int height);
+    /* Take finished checks of transactions received from peer */
+    std::vector<AntiBotTxCheck> TakeReady(NodeId node);
+    /* Drop finished checks of disconnected peer */
+    void Forget(NodeId node);
+    /* Cached result of check of transaction with same pocket data for height */
+    bool GetResult(const uint256& txid, const PocketTxData& data, int height, ANTIBOTRESULT& result);
+
+    /* Worker thread */
+    void Thread();
+};
+
+// Worker for AntiBotTxQueue
+void ThreadAntiBotTxCheck();
+
+extern std::unique_ptr<AntiBotTxQueue> g_antibot_txqueue;
+//-----------------------------------------------------
 extern std::unique_ptr<AntiBot> g_antibot;
 //-----------------------------------------------------
 #endif // ADDRINDEX_H
\ No newline at end of file
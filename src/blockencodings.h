@@ -6,6 +6,7 @@
 #define POCKETCOIN_BLOCKENCODINGS_H
 
 #include <primitives/block.h>
+#include <version.h>
 
 #include <memory>
 
@@ -27,16 +28,9 @@ public:
 };
 
 class BlockTransactionsRequest {
-public:
-    // A BlockTransactionsRequest message
-    uint256 blockhash;
-    std::vector<uint16_t> indexes;
-
-    ADD_SERIALIZE_METHODS;
-
+private:
     template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITE(blockhash);
+    static void SerializeIndexes(Stream& s, Operation ser_action, std::vector<uint16_t>& indexes) {
         uint64_t indexes_size = (uint64_t)indexes.size();
         READWRITE(COMPACTSIZE(indexes_size));
         if (ser_action.ForRead()) {
@@ -66,6 +60,24 @@ public:
             }
         }
     }
+
+public:
+    // A BlockTransactionsRequest message
+    uint256 blockhash;
+    std::vector<uint16_t> indexes;
+    // Transactions requester already has, but without PocketNET data.
+    // Only data is returned for them, since POCKET_COMPACT_DATA_VERSION
+    std::vector<uint16_t> pocketIndexes;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(blockhash);
+        SerializeIndexes(s, ser_action, indexes);
+        if (s.GetVersion() >= POCKET_COMPACT_DATA_VERSION)
+            SerializeIndexes(s, ser_action, pocketIndexes);
+    }
 };
 
 class BlockTransactions {
@@ -203,6 +215,8 @@ public:
     // extra_txn is a list of extra transactions to look at, in <witness hash, reference> form
     ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn);
     bool IsTxAvailable(size_t index) const;
+    // Transaction at index if available, only before FillBlock
+    CTransactionRef GetAvailableTx(size_t index) const;
     ReadStatus FillBlock(CBlock& block, const std::vector<CTransactionRef>& vtx_missing);
 };
 
@@ -25,6 +25,18 @@ using namespace std::chrono;
 
 /** WWW-Authenticate to present with 401 Unauthorized response */
 static const char* WWW_AUTH_HEADER_DATA = "Basic realm=\"jsonrpc\"";
+/** Cost of RPC methods marked heavy in command table, others cost HTTP_REQUEST_COST */
+static const int RPC_COST_HEAVY = 10;
+
+static int RPCMethodCost(const UniValue& valRequest)
+{
+    const UniValue& method = find_value(valRequest, "method");
+    if (!method.isStr())
+        return HTTP_REQUEST_COST;
+
+    const CRPCCommand* pcmd = tableRPC[method.get_str()];
+    return pcmd && pcmd->heavy ? RPC_COST_HEAVY : HTTP_REQUEST_COST;
+}
 
 /** Simple one-shot callback timer to be used by the RPC mechanism to e.g.
  * re-lock the wallet.
@@ -173,7 +185,7 @@ static bool HTTPReq(HTTPRequest* req, bool rpcAuthenticate)
             }
 
             if (!RPCAuthorized(authHeader.second, jreq.authUser)) {
-                LogPrintf("ThreadRPCServer incorrect password %s attempt from %s\n", authHeader.second, jreq.peerAddr);
+                LogPrintf("ThreadRPCServer incorrect password attempt from %s\n", jreq.peerAddr);
 
                 /*  Deter brute-forcing
                     If this results in a DoS the user really
@@ -185,13 +197,26 @@ static bool HTTPReq(HTTPRequest* req, bool rpcAuthenticate)
                 req->WriteReply(HTTP_UNAUTHORIZED);
                 return false;
             }
+        } else {
+            // Optional credentials only move request to balance of user
+            std::pair<bool, std::string> authHeader = req->GetHeader("authorization");
+            if (authHeader.first && !RPCAuthorized(authHeader.second, jreq.authUser))
+                jreq.authUser.clear();
         }
 
-        if (!valRequest.read(req->ReadBody()))
+        if (!AdmitHTTPRequest(req, jreq.authUser)) {
+            LogPrint(BCLog::RPC, "WARNING: request from %s rejected because request rate (%s) exceeded\n", req->GetClient().ToStringIP(), req->GetWorkQueue());
+            req->WriteReply(HTTP_TOO_MANY_REQUESTS, "Request rate exceeded (" + req->GetWorkQueue() + ")");
+            return false;
+        }
+
+        const std::string body = req->ReadBody();
+        if (!valRequest.read(body))
             throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
             
         // Set the URI
         jreq.URI = req->GetURI();
+
         std::string strReply;
 
         // singleton request
@@ -216,33 +241,41 @@ static bool HTTPReq(HTTPRequest* req, bool rpcAuthenticate)
             }
 
             jreq.parse(valRequest);
+            ChargeHTTPRequest(req, jreq.authUser, RPCMethodCost(valRequest) - HTTP_REQUEST_COST);
 
             auto start = gStatEngineInstance.GetCurrentSystemTime();
 
-            UniValue result = tableRPC.execute(jreq);
-            
+            std::string result = tableRPC.executeCached(jreq);
+
             auto stop = gStatEngineInstance.GetCurrentSystemTime();
 
+            // Send reply
+            strReply = JSONRPCReplySerialized(result, jreq.id);
+
             gStatEngineInstance.AddSample(
                 Statistic::RequestSample{
                     jreq.strMethod,
                     start,
                     stop,
                     jreq.peerAddr.substr(0, jreq.peerAddr.find(':')),
-                    valRequest.write().size(),
-                    result.write().size()
+                    body.size(),
+                    strReply.size(),
+                    Statistic::RequestTime(req->GetQueueWaitTime()),
+                    req->GetWorkQueue()
                 }
             );
 
             auto diff = (stop - start);
             LogPrint(BCLog::RPC, "RPC Method time %s (%s) - %ldms\n", jreq.strMethod, jreq.peerAddr.substr(0, jreq.peerAddr.find(':')), diff.count());
 
-            // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
-
             // array of requests
         } else {
             if (valRequest.isArray()) {
+                int cost = 0;
+                for (size_t i = 0; i < valRequest.size(); i++)
+                    cost += RPCMethodCost(valRequest[i]);
+                ChargeHTTPRequest(req, jreq.authUser, cost - HTTP_REQUEST_COST);
+
                 strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
             } else {
                 throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
@@ -273,6 +306,35 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string&)
     return HTTPReq(req, true);
 }
 
+static bool HTTPReq_Metrics(HTTPRequest* req, const std::string&)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "Metrics are served only for GET requests");
+        return false;
+    }
+
+    // Metrics reveal node load - same credentials as for private RPC
+    std::pair<bool, std::string> authHeader = req->GetHeader("authorization");
+    std::string authUser;
+    if (!authHeader.first || !RPCAuthorized(authHeader.second, authUser)) {
+        if (authHeader.first) {
+            LogPrintf("ThreadRPCServer incorrect password attempt from %s\n", req->GetPeer().ToString());
+            MilliSleep(250);
+        }
+
+        req->WriteHeader("WWW-Authenticate", WWW_AUTH_HEADER_DATA);
+        req->WriteReply(HTTP_UNAUTHORIZED);
+        return false;
+    }
+
+    auto depth = std::chrono::seconds(gArgs.GetArg("-statdepth", 60));
+    std::string strReply = gStatEngineInstance.CompileStatsAsPrometheusSince(gStatEngineInstance.GetCurrentSystemTime() - depth);
+
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, strReply);
+    return true;
+}
+
 static bool InitRPCAuthentication()
 {
     if (gArgs.GetArg("-rpcpassword", "") == "") {
@@ -302,6 +364,7 @@ bool StartHTTPRPC()
     RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
     RegisterHTTPHandler("/post/", true, HTTPReq_JSONRPC_Anonymous);
     RegisterHTTPHandler("/public/", true, HTTPReq_JSONRPC_Anonymous);
+    RegisterHTTPHandler("/metrics", true, HTTPReq_Metrics);
     if (g_wallet_init_interface.HasWalletSupport()) {
         RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC);
     }
@@ -323,6 +386,7 @@ void StopHTTPRPC()
     UnregisterHTTPHandler("/", true);
     UnregisterHTTPHandler("/post/", true);
     UnregisterHTTPHandler("/public/", true);
+    UnregisterHTTPHandler("/metrics", true);
     if (g_wallet_init_interface.HasWalletSupport()) {
         UnregisterHTTPHandler("/wallet/", false);
     }
@@ -13,11 +13,13 @@
 #include <sync.h>
 #include <ui_interface.h>
 
+#include <algorithm>
 #include <memory>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <deque>
+#include <atomic>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -45,6 +47,10 @@
 
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
+/** Part of PUBLIC work queue one client may occupy */
+static const size_t HTTP_PUBLIC_CLIENT_SHARE = 4;
+/** Clients with token buckets kept before full buckets are pruned */
+static const size_t HTTP_CLIENT_BUCKETS_MAX = 16384;
 
 /** HTTP request work item */
 class HTTPWorkItem final : public HTTPClosure
@@ -56,6 +62,7 @@ public:
     }
     void operator()() override
     {
+        req->MarkDequeued();
         func(req.get(), path);
     }
 
@@ -66,8 +73,20 @@ private:
     HTTPRequestHandler func;
 };
 
-/** Simple work queue for distributing work over multiple threads.
+/** Depth of work queue for monitoring.
+ * Lives outside of the queue so it can be read while queues are torn down.
+ */
+struct WorkQueueGauge
+{
+    const char* name;
+    std::atomic<size_t> depth{0};
+    std::atomic<size_t> maxDepth{0};
+};
+
+/** Work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
+ * Items are kept in sub-queues per client address and clients are served
+ * round-robin, so a client flooding the queue delays only its own requests.
  */
 template<typename WorkItem>
 class WorkQueue
@@ -76,18 +95,24 @@ private:
     /** Mutex protects entire object */
     Mutex cs;
     std::condition_variable cond;
-    std::deque<std::unique_ptr<WorkItem>> queue;
+    std::map<CNetAddr, std::deque<std::unique_ptr<WorkItem>>> clients;
+    /** Clients with queued items in order of service */
+    std::deque<CNetAddr> turns;
+    size_t depth;
     bool running;
     size_t maxDepth;
-
-    // int maxsize = 0;
-    // int period = 100;
-
+    size_t maxClientDepth;
+    WorkQueueGauge& gauge;
 
 public:
-    explicit WorkQueue(size_t _maxDepth) : running(true),
-                                           maxDepth(_maxDepth)
+    WorkQueue(size_t _maxDepth, size_t _maxClientDepth, WorkQueueGauge& _gauge) : depth(0),
+                                                                                running(true),
+                                                                                maxDepth(_maxDepth),
+                                                                                maxClientDepth(_maxClientDepth),
+                                                                                gauge(_gauge)
     {
+        gauge.depth = 0;
+        gauge.maxDepth = maxDepth;
     }
     /** Precondition: worker threads have all stopped (they have been joined).
      */
@@ -95,27 +120,23 @@ public:
     {
     }
     /** Enqueue a work item */
-    bool Enqueue(WorkItem *item)
+    bool Enqueue(WorkItem *item, const CNetAddr& client)
     {
         LOCK(cs);
 
+        if (depth >= maxDepth)
+            return false;
 
-        //--------------------------
-        // period -= 1;
-        // if (queue.size() > maxsize) maxsize = queue.size();
-        // if (period <= 0) {
-        //     LogPrintf("--- max queue.size() from last 100 requests: %d\n", maxsize);
-        //     period = 100;
-        //     maxsize = 0;
-        // }
-        //--------------------------
-
-        if (queue.size() >= maxDepth)
-        {
+        auto& queue = clients[client];
+        if (queue.size() >= maxClientDepth)
             return false;
-        }
+
+        if (queue.empty())
+            turns.push_back(client);
 
         queue.emplace_back(std::unique_ptr<WorkItem>(item));
+        depth += 1;
+        gauge.depth = depth;
         cond.notify_one();
 
         return true;
@@ -128,12 +149,24 @@ public:
             std::unique_ptr<WorkItem> i;
             {
                 WAIT_LOCK(cs, lock);
-                while (running && queue.empty())
+                while (running && depth == 0)
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = std::move(queue.front());
-                queue.pop_front();
+
+                CNetAddr client = turns.front();
+                turns.pop_front();
+
+                auto it = clients.find(client);
+                i = std::move(it->second.front());
+                it->second.pop_front();
+                if (it->second.empty())
+                    clients.erase(it);
+                else
+                    turns.push_back(client);
+
+                depth -= 1;
+                gauge.depth = depth;
             }
             (*i)();
         }
@@ -147,6 +180,76 @@ public:
     }
 };
 
+/** Per-client token buckets for admission to work queue.
+ * Admission takes HTTP_REQUEST_COST tokens, cost of executed work above it
+ * is charged later and may leave balance negative until refilled.
+ */
+class HTTPClientBuckets
+{
+private:
+    struct Bucket
+    {
+        double tokens;
+        int64_t updated;
+    };
+
+    Mutex cs;
+    // <client address or user, bucket>
+    std::map<std::string, Bucket> buckets;
+    double rate;
+    double burst;
+
+    Bucket& refill(const std::string& client, int64_t now) EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        auto it = buckets.find(client);
+        if (it == buckets.end())
+            return buckets.emplace(client, Bucket{burst, now}).first->second;
+
+        auto& bucket = it->second;
+        bucket.tokens = std::min(burst, bucket.tokens + rate * (now - bucket.updated) / 1000.0);
+        bucket.updated = now;
+        return bucket;
+    }
+
+    // Full buckets carry no state
+    void prune(int64_t now) EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        for (auto it = buckets.begin(); it != buckets.end();)
+        {
+            if (it->second.tokens + rate * (now - it->second.updated) / 1000.0 >= burst)
+                it = buckets.erase(it);
+            else
+                ++it;
+        }
+    }
+
+public:
+    HTTPClientBuckets(double _rate, double _burst) : rate(_rate), burst(_burst)
+    {
+    }
+
+    bool Admit(const std::string& client)
+    {
+        LOCK(cs);
+        int64_t now = GetTimeMillis();
+        if (buckets.size() >= HTTP_CLIENT_BUCKETS_MAX)
+            prune(now);
+
+        auto& bucket = refill(client, now);
+        if (bucket.tokens < HTTP_REQUEST_COST)
+            return false;
+
+        bucket.tokens -= HTTP_REQUEST_COST;
+        return true;
+    }
+
+    void Charge(const std::string& client, double cost)
+    {
+        LOCK(cs);
+        refill(client, GetTimeMillis()).tokens -= cost;
+    }
+};
+
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
@@ -171,6 +274,13 @@ static std::vector<CSubNet> rpc_allow_subnets;
 static WorkQueue<HTTPClosure> *workQueue = nullptr;
 static WorkQueue<HTTPClosure> *workQueuePost = nullptr;
 static WorkQueue<HTTPClosure> *workQueuePublic = nullptr;
+static WorkQueueGauge workQueueGauge{"MAIN"};
+static WorkQueueGauge workQueuePostGauge{"POST"};
+static WorkQueueGauge workQueuePublicGauge{"PUBLIC"};
+//! Admission control for PUBLIC work queue, null if disabled
+static HTTPClientBuckets *publicBuckets = nullptr;
+//! Reverse proxies allowed to pass client address in X-Forwarded-For
+static std::vector<CSubNet> rpc_public_proxies;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -219,6 +329,59 @@ static bool InitHTTPAllowList()
     return true;
 }
 
+/** Initialize list of trusted reverse proxies */
+static bool InitHTTPProxyList()
+{
+    rpc_public_proxies.clear();
+    for (const std::string &strProxy : gArgs.GetArgs("-rpcpublicproxy"))
+    {
+        CSubNet subnet;
+        LookupSubNet(strProxy.c_str(), subnet);
+        if (!subnet.IsValid())
+        {
+            uiInterface.ThreadSafeMessageBox(
+                strprintf("Invalid -rpcpublicproxy subnet specification: %s.", strProxy),
+                "", CClientUIInterface::MSG_ERROR);
+            return false;
+        }
+        rpc_public_proxies.push_back(subnet);
+    }
+    return true;
+}
+
+/** Client address of request.
+ * Requests from trusted proxy are attributed to the address the proxy
+ * received them from - last entry of X-Forwarded-For. Other requests,
+ * loopback included, are attributed to peer.
+ */
+static CNetAddr HTTPClientAddress(const HTTPRequest* req)
+{
+    CNetAddr peer = req->GetPeer();
+    if (!std::any_of(rpc_public_proxies.begin(), rpc_public_proxies.end(), [&peer](const CSubNet& subnet) { return subnet.Match(peer); }))
+        return peer;
+
+    std::pair<bool, std::string> forwarded = req->GetHeader("X-Forwarded-For");
+    if (!forwarded.first)
+        return peer;
+
+    std::string last = forwarded.second.substr(forwarded.second.rfind(',') + 1);
+    last.erase(0, last.find_first_not_of(" \t"));
+    last.erase(last.find_last_not_of(" \t") + 1);
+
+    CNetAddr client;
+    if (!LookupHost(last.c_str(), client, false) || !client.IsValid())
+        return peer;
+    return client;
+}
+
+/** Key of request client in rate buckets */
+static std::string HTTPClientKey(const HTTPRequest* req, const std::string& authUser)
+{
+    if (!authUser.empty())
+        return "user:" + authUser;
+    return req->GetClient().ToStringIP();
+}
+
 /** HTTP request method as string - use for logging only */
 static std::string RequestMethodString(HTTPRequest::RequestMethod m)
 {
@@ -300,12 +463,14 @@ static void http_request_cb(struct evhttp_request *req, void *arg)
     // Dispatch to worker thread
     if (i != iend)
     {
+        hreq->SetClient(HTTPClientAddress(hreq.get()));
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
 
         if (strURI == "/post/")
         {
             assert(workQueuePost);
-            if (workQueuePost->Enqueue(item.get()))
+            item->req->SetWorkQueue("POST");
+            if (workQueuePost->Enqueue(item.get(), item->req->GetClient()))
                 item.release();
             else
             {
@@ -315,7 +480,8 @@ static void http_request_cb(struct evhttp_request *req, void *arg)
         } else if (strURI == "/public/")
         {
             assert(workQueuePublic);
-            if (workQueuePublic->Enqueue(item.get()))
+            item->req->SetWorkQueue("PUBLIC");
+            if (workQueuePublic->Enqueue(item.get(), item->req->GetClient()))
                 item.release();
             else
             {
@@ -325,7 +491,8 @@ static void http_request_cb(struct evhttp_request *req, void *arg)
         } else
         {
             assert(workQueue);
-            if (workQueue->Enqueue(item.get()))
+            item->req->SetWorkQueue("MAIN");
+            if (workQueue->Enqueue(item.get(), item->req->GetClient()))
                 item.release();
             else
             {
@@ -428,7 +595,7 @@ static void libevent_log_cb(int severity, const char *msg)
 
 bool InitHTTPServer()
 {
-    if (!InitHTTPAllowList())
+    if (!InitHTTPAllowList() || !InitHTTPProxyList())
         return false;
 
     // Redirect libevent's logging to our own log
@@ -474,14 +641,24 @@ bool InitHTTPServer()
     int workQueuePostDepth = std::max((long) gArgs.GetArg("-rpcpostworkqueue", DEFAULT_HTTP_POST_WORKQUEUE), 1L);
     int workQueuePublicDepth = std::max((long) gArgs.GetArg("-rpcpublicworkqueue", DEFAULT_HTTP_PUBLIC_WORKQUEUE), 1L);
 
-    workQueue = new WorkQueue<HTTPClosure>(workQueueMainDepth);
+    workQueue = new WorkQueue<HTTPClosure>(workQueueMainDepth, workQueueMainDepth, workQueueGauge);
     LogPrintf("HTTP: creating work queue of depth %d\n", workQueueMainDepth);
 
-    workQueuePost = new WorkQueue<HTTPClosure>(workQueuePostDepth);
+    workQueuePost = new WorkQueue<HTTPClosure>(workQueuePostDepth, workQueuePostDepth, workQueuePostGauge);
     LogPrintf("HTTP: creating work queue of depth %d\n", workQueuePostDepth);
 
-    workQueuePublic = new WorkQueue<HTTPClosure>(workQueuePublicDepth);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueuePublicDepth);
+    // Anonymous clients share PUBLIC queue and are limited each
+    int workQueuePublicClientDepth = std::max(workQueuePublicDepth / (int) HTTP_PUBLIC_CLIENT_SHARE, 1);
+    workQueuePublic = new WorkQueue<HTTPClosure>(workQueuePublicDepth, workQueuePublicClientDepth, workQueuePublicGauge);
+    LogPrintf("HTTP: creating work queue of depth %d (%d per client)\n", workQueuePublicDepth, workQueuePublicClientDepth);
+
+    double publicRate = gArgs.GetArg("-rpcpublicrate", DEFAULT_HTTP_PUBLIC_RATE);
+    double publicBurst = std::max(gArgs.GetArg("-rpcpublicburst", DEFAULT_HTTP_PUBLIC_BURST), (int64_t) HTTP_REQUEST_COST);
+    if (publicRate > 0)
+    {
+        publicBuckets = new HTTPClientBuckets(publicRate, publicBurst);
+        LogPrintf("HTTP: limiting PUBLIC request cost to %g per second, burst %g per client\n", publicRate, publicBurst);
+    }
 
     // transfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
@@ -592,6 +769,12 @@ void StopHTTPServer()
         workQueuePublic = nullptr;
     }
 
+    if (publicBuckets)
+    {
+        delete publicBuckets;
+        publicBuckets = nullptr;
+    }
+
     if (eventBase)
     {
         LogPrint(BCLog::HTTP, "Waiting for HTTP event thread to exit\n");
@@ -787,6 +970,45 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod() const
     }
 }
 
+void HTTPRequest::SetWorkQueue(const std::string& name)
+{
+    workQueue = name;
+    nTimeEnqueued = GetTimeMillis();
+}
+
+void HTTPRequest::MarkDequeued()
+{
+    nTimeDequeued = GetTimeMillis();
+}
+
+int64_t HTTPRequest::GetQueueWaitTime() const
+{
+    if (nTimeEnqueued == 0 || nTimeDequeued < nTimeEnqueued)
+        return 0;
+    return nTimeDequeued - nTimeEnqueued;
+}
+
+std::vector<HTTPWorkQueueDepth> GetHTTPWorkQueueDepths()
+{
+    std::vector<HTTPWorkQueueDepth> result;
+    for (const WorkQueueGauge* gauge : {&workQueueGauge, &workQueuePostGauge, &workQueuePublicGauge})
+        result.push_back({gauge->name, gauge->depth, gauge->maxDepth});
+    return result;
+}
+
+bool AdmitHTTPRequest(const HTTPRequest* req, const std::string& authUser)
+{
+    if (!publicBuckets || req->GetWorkQueue() != "PUBLIC")
+        return true;
+    return publicBuckets->Admit(HTTPClientKey(req, authUser));
+}
+
+void ChargeHTTPRequest(const HTTPRequest* req, const std::string& authUser, double cost)
+{
+    if (publicBuckets && cost > 0 && req->GetWorkQueue() == "PUBLIC")
+        publicBuckets->Charge(HTTPClientKey(req, authUser), cost);
+}
+
 void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
 {
     LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
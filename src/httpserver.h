@@ -5,9 +5,12 @@
 #ifndef POCKETCOIN_HTTPSERVER_H
 #define POCKETCOIN_HTTPSERVER_H
 
+#include <netaddress.h>
+
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <vector>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_POST_THREADS=4;
@@ -16,6 +19,11 @@ static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_POST_WORKQUEUE=16;
 static const int DEFAULT_HTTP_PUBLIC_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
+/** Cost refilled per second and max balance for PUBLIC client, rate 0 disables limit */
+static const int DEFAULT_HTTP_PUBLIC_RATE=20;
+static const int DEFAULT_HTTP_PUBLIC_BURST=100;
+/** Cost taken from client balance on admission of request */
+static const int HTTP_REQUEST_COST=1;
 
 struct evhttp_request;
 struct event_base;
@@ -50,6 +58,26 @@ void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPR
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Current and maximum depth of HTTP work queue */
+struct HTTPWorkQueueDepth
+{
+    std::string name;
+    size_t depth;
+    size_t maxDepth;
+};
+/** Depths of all HTTP work queues */
+std::vector<HTTPWorkQueueDepth> GetHTTPWorkQueueDepths();
+
+/** Take HTTP_REQUEST_COST from balance of request client.
+ * Client is authenticated user if authUser is not empty, otherwise client address.
+ * Only requests of PUBLIC work queue are limited. Returns false if balance is exhausted.
+ */
+bool AdmitHTTPRequest(const HTTPRequest* req, const std::string& authUser);
+/** Charge client of request for cost of its work above HTTP_REQUEST_COST.
+ * Balance is kept only for clients of PUBLIC work queue.
+ */
+void ChargeHTTPRequest(const HTTPRequest* req, const std::string& authUser, double cost);
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -63,6 +91,10 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    std::string workQueue;
+    CNetAddr client;
+    int64_t nTimeEnqueued = 0;
+    int64_t nTimeDequeued = 0;
 
 public:
     explicit HTTPRequest(struct evhttp_request* req);
@@ -84,6 +116,11 @@ public:
      */
     CService GetPeer() const;
 
+    /** Address of client, differs from peer for requests forwarded by -rpcpublicproxy.
+     */
+    const CNetAddr& GetClient() const { return client; }
+    void SetClient(const CNetAddr& addr) { client = addr; }
+
     /** Get request method.
      */
     RequestMethod GetRequestMethod() const;
@@ -118,6 +155,19 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /** Remember work queue the request is dispatched to and time of enqueue.
+     */
+    void SetWorkQueue(const std::string& name);
+    /** Remember time the request is taken by a worker thread.
+     */
+    void MarkDequeued();
+    /** Name of work queue (MAIN, POST or PUBLIC), empty if not queued.
+     */
+    const std::string& GetWorkQueue() const { return workQueue; }
+    /** Milliseconds the request waited in work queue.
+     */
+    int64_t GetQueueWaitTime() const;
 };
 
 /** Event handler closure.
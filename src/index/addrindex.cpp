@@ -5,8 +5,11 @@
 #include "html.h"
 #include <consensus/consensus.h>
 #include <validation.h>
+#include <numeric>
 //-----------------------------------------------------
 std::unique_ptr<AddrIndex> g_addrindex;
+
+bool GetBlockRHash(const CBlock& block, std::string& blockRHash);
 //-----------------------------------------------------
 AddrIndex::AddrIndex()
 {
@@ -96,7 +99,7 @@ bool AddrIndex::indexUTXO(const CTransactionRef& tx, CBlockIndex* pindex)
         item["amount"] = (int64_t)txout.nValue;
         item["spent_block"] = 0;
 
-        if (!g_pocketdb->UpsertWithCommit("UTXO", item).ok()) return false;
+        if (!g_pocketdb->AddUTXO(item).ok()) return false;
     }
 
     // Get all addresses from tx ins
@@ -107,13 +110,7 @@ bool AddrIndex::indexUTXO(const CTransactionRef& tx, CBlockIndex* pindex)
             int txinout = (int)txin.prevout.n;
 
             // Mark UTXO item as deleted
-            reindexer::QueryResults _res;
-            reindexer::Error err = g_pocketdb->DB()->Select(reindexer::Query("UTXO", 0, 1).WhereComposite("txid+txout", CondEq, {{ Variant(txinid), Variant(txinout) }}), _res);
-            if (err.ok() && _res.Count() > 0) {
-                reindexer::Item item = _res[0].GetItem();
-                item["spent_block"] = pindex->nHeight;
-                if (!g_pocketdb->UpsertWithCommit("UTXO", item).ok()) return false;
-            }
+            if (!g_pocketdb->SpendUTXO(txinid, txinout, pindex->nHeight).ok()) return false;
         }
     }
 
@@ -283,11 +280,7 @@ bool AddrIndex::computeUsersRatings(CBlockIndex* pindex, std::map<std::string, i
         rep += ur.second;
 
         // Create new item with this height - new accumulating rating
-        reindexer::Item _itm_user_rating_new = g_pocketdb->DB()->NewItem("UserRatings");
-        _itm_user_rating_new["address"] = ur.first;
-        _itm_user_rating_new["block"] = pindex->nHeight;
-        _itm_user_rating_new["reputation"] = rep;
-        if (!g_pocketdb->UpsertWithCommit("UserRatings", _itm_user_rating_new).ok()) return false;
+        if (!g_pocketdb->SetUserRating(ur.first, pindex->nHeight, rep).ok()) return false;
 
         // Update user reputation
         if (!g_pocketdb->SetUserReputation(ur.first, rep)) return false;
@@ -312,13 +305,7 @@ bool AddrIndex::computeUsersRatings(CBlockIndex* pindex, std::map<std::string, i
 
             // Check likers exists for this user
             if (!g_pocketdb->ExistsUserLiker(userId, likerId, pindex->nHeight)) {
-                reindexer::Item _itm_rating_new = g_pocketdb->DB()->NewItem("Ratings");
-                _itm_rating_new["type"] = RatingType::RatingUserLikers;
-                _itm_rating_new["block"] = pindex->nHeight;
-                _itm_rating_new["key"] = userId;
-                _itm_rating_new["value"] = likerId;
-
-                if (!g_pocketdb->UpsertWithCommit("Ratings", _itm_rating_new).ok()) {
+                if (!g_pocketdb->AddUserLiker(userId, likerId, pindex->nHeight).ok()) {
                     LogPrintf("Error save user likers ratings %d - %d\n", userId, likerId);
                     return false;
                 }
@@ -429,6 +416,10 @@ bool AddrIndex::IndexBlock(const CBlock& block, CBlockIndex* pindex)
     // <commentid, rep>
     std::map<std::string, int> commentReputations;
 
+    // Pocket rows of this block for rollback journal
+    // <table, vector<txid>>
+    std::map<std::string, std::vector<std::string>> undoRows;
+
     for (const auto& tx : block.vtx) {
         // Indexing UTXOs
         if (!indexUTXO(tx, pindex)) {
@@ -444,6 +435,7 @@ bool AddrIndex::IndexBlock(const CBlock& block, CBlockIndex* pindex)
 
         std::string ri_table;
         if (!GetPocketnetTXType(tx, ri_table)) continue;
+        undoRows[ri_table].push_back(tx->GetHash().GetHex());
 
         // Indexing ratings
         if (ri_table == "Scores" && !indexRating(tx, pindex, userReputations, postRatings, postReputations, userLikers)) {
@@ -476,6 +468,20 @@ bool AddrIndex::IndexBlock(const CBlock& block, CBlockIndex* pindex)
         return false;
     }
 
+    // Save journal for disconnect of this block
+    if (!writeBlockUndo(pindex->nHeight, undoRows, userReputations, postRatings, commentRatings)) {
+        LogPrintf("(AddrIndex::IndexBlock) writeBlockUndo - block (%s)\n", block.GetHash().GetHex());
+        return false;
+    }
+
+    // Lottery of next block reads same state - prepare candidates
+    // while block is at hand, rewards are checked only after 1.0.0_pre
+    if (pindex->nHeight >= (int)Params().GetConsensus().nHeight_version_1_0_0_pre) {
+        auto candidates = std::make_shared<LotteryCandidates>();
+        if (computeLotteryCandidates(block, pindex->nHeight, *candidates))
+            cacheLotteryCandidates(block.GetHash(), pindex->nHeight, candidates);
+    }
+
     return true;
 }
 
@@ -635,7 +641,78 @@ bool AddrIndex::IsPocketnetTransaction(const CTransaction& tx)
     return IsPocketnetTransaction(MakeTransactionRef(tx));
 }
 
-bool AddrIndex::RollbackDB(int blockHeight, bool back_to_mempool)
+// Tables with rows written at block height
+static const std::vector<std::string> ROLLBACK_TABLES = {
+    "Scores", "Posts", "Complains", "UTXO", "Addresses", "Users", "Subscribes", "Blocking",
+    "CommentScores", "Comment", "UserRatings", "PostRatings", "CommentRatings", "Ratings"};
+
+int AddrIndex::getTopHeight()
+{
+    int top = 0;
+    reindexer::Item itm;
+
+    for (const auto& table : ROLLBACK_TABLES) {
+        if (g_pocketdb->SelectOne(reindexer::Query(table).Sort("block", true), itm).ok())
+            top = std::max(top, itm["block"].As<int>());
+    }
+
+    if (g_pocketdb->SelectOne(reindexer::Query("UTXO").Sort("spent_block", true), itm).ok())
+        top = std::max(top, itm["spent_block"].As<int>());
+
+    return top;
+}
+
+bool AddrIndex::RollbackDB(int blockHeight, bool back_to_mempool, int topHeight)
+{
+    // Forget state hashes of rolled back blocks
+    {
+        LOCK(cs_rhash);
+        for (auto it = rhash_cache.begin(); it != rhash_cache.end();) {
+            if (it->second.first > blockHeight)
+                it = rhash_cache.erase(it);
+            else
+                it++;
+        }
+    }
+
+    {
+        LOCK(cs_lottery);
+        for (auto it = lottery_cache.begin(); it != lottery_cache.end();) {
+            if (it->second.first > blockHeight)
+                it = lottery_cache.erase(it);
+            else
+                it++;
+        }
+    }
+
+    // Disconnect of one block knows its height - no scan of tables.
+    // Top blocks are replayed one by one from their journals.
+    int top = topHeight >= 0 ? topHeight : getTopHeight();
+    while (top > blockHeight) {
+        bool found = false;
+        if (!replayBlockUndo(top, back_to_mempool, found)) return false;
+        if (!found) break;
+        top -= 1;
+    }
+    if (top <= blockHeight) return true;
+
+    // Blocks without journal are rolled back from top in chunks of ROLLBACK_CHUNK_BLOCKS:
+    // selects of every chunk are bounded. Views and ratings are restored from rows left
+    // after every chunk, so result is same as of one pass.
+    int height = std::max(top - ROLLBACK_CHUNK_BLOCKS, blockHeight);
+    while (true) {
+        if (!rollbackBlocks(height, back_to_mempool)) return false;
+
+        if (height <= blockHeight) break;
+
+        LogPrintf("RIDB rollback: %d blocks left\n", height - blockHeight);
+        height = std::max(height - ROLLBACK_CHUNK_BLOCKS, blockHeight);
+    }
+
+    return true;
+}
+
+bool AddrIndex::rollbackBlocks(int blockHeight, bool back_to_mempool)
 {
     // Deleting Scores
     {
@@ -687,16 +764,7 @@ bool AddrIndex::RollbackDB(int blockHeight, bool back_to_mempool)
 
     // Rollback UTXO
     {
-        if (!g_pocketdb->DeleteWithCommit(reindexer::Query("UTXO").Where("block", CondGt, blockHeight)).ok()) return false;
-
-        reindexer::QueryResults _utxo_res;
-        if (g_pocketdb->DB()->Select(reindexer::Query("UTXO").Where("spent_block", CondGt, blockHeight), _utxo_res).ok()) {
-            for (auto& it : _utxo_res) {
-                reindexer::Item _utxo_itm = it.GetItem();
-                _utxo_itm["spent_block"] = 0;
-                if (!g_pocketdb->UpsertWithCommit("UTXO", _utxo_itm).ok()) return false;
-            }
-        }
+        if (!g_pocketdb->RollbackUTXO(blockHeight).ok()) return false;
     }
 
     // Rollback Addresses
@@ -799,6 +867,7 @@ bool AddrIndex::RollbackDB(int blockHeight, bool back_to_mempool)
 
         // Rollback ratings blocks
         if (!g_pocketdb->DeleteWithCommit(reindexer::Query("UserRatings").Where("block", CondGt, blockHeight)).ok()) return false;
+        g_pocketdb->RollbackRatingsCache(blockHeight);
 
         // Update users ratings
         for (auto& _user_address : vUsersRatingRefresh) {
@@ -859,11 +928,170 @@ bool AddrIndex::RollbackDB(int blockHeight, bool back_to_mempool)
     // Rollback Ratings
     {
         if (!g_pocketdb->DeleteWithCommit(reindexer::Query("Ratings").Where("block", CondGt, blockHeight)).ok()) return false;
+        g_pocketdb->RollbackRatingsCache(blockHeight);
+    }
+
+    // Journals of rolled back blocks
+    {
+        if (!g_pocketdb->DeleteWithCommit(reindexer::Query("BlockUndo").Where("block", CondGt, blockHeight)).ok()) return false;
     }
 
     return true;
 }
 
+static UniValue UndoKeys(const std::vector<std::string>& keys)
+{
+    UniValue arr(UniValue::VARR);
+    for (const auto& key : keys) arr.push_back(key);
+    return arr;
+}
+
+static std::vector<std::string> UndoKeys(const UniValue& arr)
+{
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < arr.size(); i++) keys.push_back(arr[i].get_str());
+    return keys;
+}
+
+template <typename T>
+static UniValue UndoKeys(const std::map<std::string, T>& map)
+{
+    UniValue arr(UniValue::VARR);
+    for (const auto& it : map) arr.push_back(it.first);
+    return arr;
+}
+
+bool AddrIndex::writeBlockUndo(int height,
+    const std::map<std::string, std::vector<std::string>>& rows,
+    const std::map<std::string, int>& userReputations,
+    const std::map<std::string, std::pair<int, int>>& postRatings,
+    const std::map<std::string, std::pair<int, int>>& commentRatings)
+{
+    UniValue undoRows(UniValue::VOBJ);
+    for (const auto& r : rows) undoRows.pushKV(r.first, UndoKeys(r.second));
+
+    UniValue undo(UniValue::VOBJ);
+    undo.pushKV("rows", undoRows);
+    undo.pushKV("users", UndoKeys(userReputations));
+    undo.pushKV("posts", UndoKeys(postRatings));
+    undo.pushKV("comments", UndoKeys(commentRatings));
+
+    reindexer::Item item = g_pocketdb->DB()->NewItem("BlockUndo");
+    item["block"] = height;
+    item["data"] = undo.write();
+    if (!g_pocketdb->UpsertWithCommit("BlockUndo", item).ok()) return false;
+
+    // Deeper rollback goes through tables
+    return g_pocketdb->DeleteWithCommit(reindexer::Query("BlockUndo").Where("block", CondLe, height - BLOCK_UNDO_DEPTH)).ok();
+}
+
+bool AddrIndex::replayBlockUndo(int height, bool back_to_mempool, bool& found)
+{
+    found = false;
+
+    reindexer::Item undoItm;
+    if (!g_pocketdb->SelectOne(reindexer::Query("BlockUndo").Where("block", CondEq, height), undoItm).ok()) return true;
+
+    UniValue undo(UniValue::VOBJ);
+    if (!undo.read(undoItm["data"].As<string>())) return true;
+    found = true;
+
+    const UniValue& rows = undo["rows"];
+    int prevHeight = height - 1;
+
+    // Scores, complains and comment scores - rows of block only
+    for (const std::string table : {"Scores", "Complains", "CommentScores"}) {
+        std::vector<std::string> txids = UndoKeys(rows[table]);
+        if (txids.empty()) continue;
+
+        if (back_to_mempool) {
+            reindexer::QueryResults res;
+            if (g_pocketdb->DB()->Select(reindexer::Query(table).Where("txid", CondSet, txids), res).ok()) {
+                for (auto& it : res) {
+                    reindexer::Item itm = it.GetItem();
+                    if (!insert_to_mempool(itm, table)) return false;
+                }
+            }
+        }
+
+        if (!g_pocketdb->DeleteWithCommit(reindexer::Query(table).Where("txid", CondSet, txids)).ok()) return false;
+    }
+
+    // Posts - new posts have txid of block transaction, edits have txidEdit
+    std::vector<std::string> postTxids = UndoKeys(rows["Posts"]);
+    if (!postTxids.empty()) {
+        reindexer::QueryResults res;
+        if (!g_pocketdb->DB()->Select(reindexer::Query("Posts").Where("txid", CondSet, postTxids).Or().Where("txidEdit", CondSet, postTxids), res).ok()) return false;
+        for (auto& it : res) {
+            reindexer::Item itm = it.GetItem();
+            if (back_to_mempool && !insert_to_mempool(itm, "Posts")) return false;
+            if (!g_pocketdb->RestorePostItem(itm["txid"].As<string>(), prevHeight).ok()) return false;
+        }
+    }
+
+    // UTXO and Addresses of block are found by indexed block fields
+    if (!g_pocketdb->RollbackUTXO(prevHeight).ok()) return false;
+    if (!g_pocketdb->DeleteWithCommit(reindexer::Query("Addresses").Where("block", CondGt, prevHeight)).ok()) return false;
+
+    // Users, Subscribes and Blocking - delete rows and restore views from history
+    for (const std::string table : {"Users", "Subscribes", "Blocking"}) {
+        std::vector<std::string> txids = UndoKeys(rows[table]);
+        if (txids.empty()) continue;
+
+        reindexer::QueryResults res;
+        if (!g_pocketdb->DB()->Select(reindexer::Query(table).Where("txid", CondSet, txids), res).ok()) return false;
+
+        std::set<std::pair<std::string, std::string>> views;
+        for (auto& it : res) {
+            reindexer::Item itm = it.GetItem();
+            if (back_to_mempool && !insert_to_mempool(itm, table)) return false;
+            views.emplace(itm["address"].As<string>(), table == "Users" ? "" : itm["address_to"].As<string>());
+        }
+
+        if (!g_pocketdb->DeleteWithCommit(reindexer::Query(table).Where("txid", CondSet, txids)).ok()) return false;
+
+        for (const auto& view : views) {
+            reindexer::Error err;
+            if (table == "Users") err = g_pocketdb->UpdateUsersView(view.first, prevHeight);
+            if (table == "Subscribes") err = g_pocketdb->UpdateSubscribesView(view.first, view.second);
+            if (table == "Blocking") err = g_pocketdb->UpdateBlockingView(view.first, view.second);
+            if (!err.ok()) return false;
+        }
+    }
+
+    // Comments - restore previous version
+    std::vector<std::string> commentTxids = UndoKeys(rows["Comment"]);
+    if (!commentTxids.empty()) {
+        reindexer::QueryResults res;
+        if (!g_pocketdb->DB()->Select(reindexer::Query("Comment").Where("txid", CondSet, commentTxids), res).ok()) return false;
+        for (auto& it : res) {
+            reindexer::Item itm = it.GetItem();
+            if (back_to_mempool && !insert_to_mempool(itm, "Comment")) return false;
+            if (!g_pocketdb->RestoreLastItem("Comment", itm["txid"].As<string>(), itm["otxid"].As<string>(), prevHeight).ok()) return false;
+        }
+    }
+
+    // Ratings - keys from journal, no select of rating rows
+    if (!g_pocketdb->DeleteWithCommit(reindexer::Query("UserRatings").Where("block", CondGt, prevHeight)).ok()) return false;
+    if (!g_pocketdb->DeleteWithCommit(reindexer::Query("Ratings").Where("block", CondGt, prevHeight)).ok()) return false;
+    g_pocketdb->RollbackRatingsCache(prevHeight);
+    for (const auto& address : UndoKeys(undo["users"])) {
+        if (!g_pocketdb->UpdateUserReputation(address, prevHeight)) return false;
+    }
+
+    if (!g_pocketdb->DeleteWithCommit(reindexer::Query("PostRatings").Where("block", CondGt, prevHeight)).ok()) return false;
+    for (const auto& posttxid : UndoKeys(undo["posts"])) {
+        if (!g_pocketdb->UpdatePostRating(posttxid, prevHeight)) return false;
+    }
+
+    if (!g_pocketdb->DeleteWithCommit(reindexer::Query("CommentRatings").Where("block", CondGt, prevHeight)).ok()) return false;
+    for (const auto& commentid : UndoKeys(undo["comments"])) {
+        if (!g_pocketdb->UpdateCommentRating(commentid, prevHeight)) return false;
+    }
+
+    return g_pocketdb->DeleteWithCommit(reindexer::Query("BlockUndo").Where("block", CondEq, height)).ok();
+}
+
 bool AddrIndex::GetAddressRegistrationDate(std::vector<std::string> addresses,
     std::vector<AddressRegistrationItem>& registrations)
 {
@@ -1186,45 +1414,60 @@ bool AddrIndex::GetRecommendedPostsByScores(std::string _address, int count, int
     return true;
 }
 
-bool AddrIndex::GetBlockRIData(CBlock block, std::string& data)
+bool AddrIndex::GetBlockRIData(CBlock block, PocketBlockData& data)
 {
-    UniValue ret_data(UniValue::VOBJ);
-    uint256 blockhash = block.GetHash();
+    std::vector<uint16_t> indexes(block.vtx.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    return GetBlockRIData(block, indexes, data);
+}
 
+bool AddrIndex::GetBlockRIData(const CBlock& block, const std::vector<uint16_t>& indexes, PocketBlockData& data)
+{
     // Maybe reindexer part data received from another node?
-    // .. then relay from global POCKETNET_DATA
-    if (POCKETNET_DATA.find(blockhash) != POCKETNET_DATA.end()) {
-        data = POCKETNET_DATA[blockhash];
-        return true;
-    }
+    // .. then relay from global POCKETNET_DATA.
+    // Compact block may bring only part of data, rest is in RIMempool
+    auto pocket_data = POCKETNET_DATA.Get(block.GetHash());
+
+    for (uint16_t index : indexes) {
+        if (index >= block.vtx.size()) return false;
+
+        CTransactionRef tr = block.vtx[index];
+        if (!IsPocketTX(tr)) continue;
 
-    // .. or data already in reindexer DB
-    for (CTransactionRef& tr : block.vtx) {
-        std::string d;
-        if (IsPocketTX(tr)) {
-            if (!GetTXRIData(tr, d)) return false;
-            ret_data.pushKV(tr->GetHash().GetHex(), d);
+        if (pocket_data) {
+            auto it = pocket_data->find(tr->GetHash());
+            if (it != pocket_data->end()) {
+                data.emplace(*it);
+                continue;
+            }
         }
-    }
 
-    if (ret_data.size()) {
-        data = ret_data.write();
+        // .. or data already in reindexer DB
+        PocketTxData d;
+        if (!GetTXRIData(tr, d)) return false;
+        if (!d.IsNull()) data.emplace(tr->GetHash(), std::move(d));
     }
 
     return true;
 }
 
-bool AddrIndex::SetBlockRIData(const CBlock& block, std::string& data, int height)
+bool AddrIndex::HaveTXRIData(const CTransactionRef& tx)
 {
-    UniValue _data(UniValue::VOBJ);
-    _data.read(data);
+    std::string ri_table;
+    if (!GetPocketnetTXType(tx, ri_table)) return true;
 
+    std::string txid = tx->GetHash().GetHex();
+    if (g_pocketdb->Exists(reindexer::Query("Mempool").Where("txid", CondEq, txid))) return true;
+    return CheckRItemExists(ri_table, txid);
+}
+
+bool AddrIndex::SetBlockRIData(const CBlock& block, const PocketBlockData& data, int height)
+{
     for (const auto& tx : block.vtx) {
-        auto key = tx->GetHash().GetHex();
-        if (_data.exists(key))
+        auto it = data.find(tx->GetHash());
+        if (it != data.end())
         {
-            std::string _d = _data[key].get_str();
-            if (!SetTXRIData(tx, _d, height))
+            if (!SetTXRIData(tx, it->second, height))
                 return false;
         }
     }
@@ -1232,7 +1475,7 @@ bool AddrIndex::SetBlockRIData(const CBlock& block, std::string& data, int heigh
     return true;
 }
 
-bool AddrIndex::GetTXRIData(CTransactionRef& tx, std::string& data)
+bool AddrIndex::GetTXRIData(CTransactionRef& tx, PocketTxData& data)
 {
     std::string ri_table = "";
 
@@ -1240,7 +1483,6 @@ bool AddrIndex::GetTXRIData(CTransactionRef& tx, std::string& data)
     if (!GetPocketnetTXType(tx, ri_table)) return true;
     //----------------------
     std::string txid = tx->GetHash().GetHex();
-    UniValue ret_data(UniValue::VOBJ);
 
     // Type of transaction is "pocketnet"
     // First check RIMempool for transactions from mempool
@@ -1305,23 +1547,25 @@ bool AddrIndex::GetTXRIData(CTransactionRef& tx, std::string& data)
         }
     }
 
-    ret_data.pushKV("t", (mempool ? "Mempool" : ri_table));
-    ret_data.pushKV("d", EncodeBase64(itm.GetJSON().ToString()));
-    data = ret_data.write();
+    // Item from RIMempool is a wrapper - relay source table and data
+    if (mempool) {
+        data.table = itm["table"].As<string>();
+        data.data = DecodeBase64(itm["data"].As<string>());
+    } else {
+        data.table = ri_table;
+        data.data = itm.GetJSON().ToString();
+    }
+
     return true;
 }
 
-bool AddrIndex::SetTXRIData(const CTransactionRef& tx, std::string& data, int height)
+bool AddrIndex::SetTXRIData(const CTransactionRef& tx, const PocketTxData& data, int height)
 {
-    UniValue _data(UniValue::VOBJ);
-    if (!_data.read(data)) return false;
+    if (data.IsNull()) return false;
     //----------------------
-    std::string table = _data["t"].get_str();
-    std::string itm_src = DecodeBase64(_data["d"].get_str());
-
-    reindexer::Item itm = g_pocketdb->DB()->NewItem(table);
-    if (!itm.FromJSON(itm_src).ok()) return false;
-    if (!WriteRTransaction(tx, table, itm, height)) return false;
+    reindexer::Item itm = g_pocketdb->DB()->NewItem(data.table);
+    if (!itm.FromJSON(data.data).ok()) return false;
+    if (!WriteRTransaction(tx, data.table, itm, height)) return false;
     //----------------------
     return true;
 }
@@ -1368,14 +1612,6 @@ bool AddrIndex::ClearMempool(std::string txid)
     return g_pocketdb->DeleteWithCommit(reindexer::Query("Mempool").Where("txid", CondEq, txid)).ok();
 }
 
-std::string ComputeHash(std::string src)
-{
-    unsigned char _hash[32] = {};
-    CSHA256().Write((const unsigned char*)src.data(), src.size()).Finalize(_hash);
-    std::vector<unsigned char> vec(_hash, _hash + sizeof(_hash));
-    return HexStr(vec);
-}
-
 bool GetBlockRHash(const CBlock& block, std::string& blockRHash)
 {
     std::string asmstr = ScriptToAsmStr(block.vtx[0]->vin[0].scriptSig);
@@ -1387,264 +1623,249 @@ bool GetBlockRHash(const CBlock& block, std::string& blockRHash)
     return true;
 }
 
-bool AddrIndex::ComputeRHash(CBlockIndex* pindexPrev, std::string& hash)
+// Fields of reindexer tables included in RHash.
+// Rows of table are hashed in `sort` order
+struct RHashTable {
+    std::string table;
+    std::string sort;
+    std::vector<std::string> fields;
+    std::vector<std::string> arrays;
+};
+
+static const std::vector<RHashTable> RHASH_TABLES = {
+    {"Users", "txid", {"txid", "block", "time", "address", "name", "birthday", "gender", "regdate", "avatar", "about", "lang", "url", "pubkey", "donations", "referrer", "id"}, {}},
+    {"Posts", "txid", {"txid", "block", "time", "address", "lang", "caption", "message", "settings", "url"}, {"tags", "images"}},
+    {"Scores", "txid", {"txid", "block", "time", "posttxid", "address", "value"}, {}},
+    {"Subscribes", "txid", {"txid", "block", "time", "address", "address_to", "private", "unsubscribe"}, {}},
+    {"Blocking", "txid", {"txid", "block", "time", "address", "address_to", "unblocking"}, {}},
+    {"Complains", "txid", {"txid", "block", "time", "posttxid", "address", "reason"}, {}},
+    {"UTXO", "txid", {"txid", "txout", "time", "block", "address", "amount", "spent_block"}, {}},
+    {"Addresses", "txid", {"txid", "block", "address", "time"}, {}},
+    {"UserRatings", "address", {"block", "address", "scoreSum", "scoreCnt"}, {}},
+    {"PostRatings", "posttxid", {"block", "posttxid", "scoreSum", "scoreCnt", "reputation"}, {}},
+};
+
+static void WriteRHashValue(CSHA256& hasher, const reindexer::Variant& value)
+{
+    std::string v = value.As<string>();
+    hasher.Write((const unsigned char*)v.data(), v.size());
+}
+
+bool AddrIndex::computeRHash(int height, const std::string& blockRHash, std::string& hash)
 {
-    std::string data = "";
+    CSHA256 hasher;
+    unsigned char _hash[CSHA256::OUTPUT_SIZE];
+
+    // Fields are streamed to hasher of row, row hashes to hasher of table
+    // and table hashes to block hasher - without intermediate strings
+    for (const auto& t : RHASH_TABLES) {
+        reindexer::QueryResults res;
+        if (!g_pocketdb->Select(reindexer::Query(t.table).Where("block", CondEq, height).Sort(t.sort, false), res).ok()) return false;
+        if (res.Count() == 0) continue;
+
+        CSHA256 tableHasher;
+        for (auto& it : res) {
+            reindexer::Item itm(it.GetItem());
 
-    // Compute hashes for reindexer tables
-    {
-        // Get hash of Users
-        {
-            std::string usersData = "";
-            reindexer::QueryResults usersRes;
-            g_pocketdb->Select(reindexer::Query("Users").Where("block", CondEq, pindexPrev->nHeight).Sort("txid", false), usersRes);
-            for (auto& u : usersRes) {
-                std::string _usersData = "";
-                reindexer::Item userItm(u.GetItem());
-
-                _usersData += userItm["txid"].As<string>();
-                _usersData += userItm["block"].As<string>();
-                _usersData += userItm["time"].As<string>();
-                _usersData += userItm["address"].As<string>();
-                _usersData += userItm["name"].As<string>();
-                _usersData += userItm["birthday"].As<string>();
-                _usersData += userItm["gender"].As<string>();
-                _usersData += userItm["regdate"].As<string>();
-                _usersData += userItm["avatar"].As<string>();
-                _usersData += userItm["about"].As<string>();
-                _usersData += userItm["lang"].As<string>();
-                _usersData += userItm["url"].As<string>();
-                _usersData += userItm["pubkey"].As<string>();
-                _usersData += userItm["donations"].As<string>();
-                _usersData += userItm["referrer"].As<string>();
-                _usersData += userItm["id"].As<string>();
-
-                usersData += ComputeHash(_usersData);
+            CSHA256 rowHasher;
+            for (const auto& f : t.fields) WriteRHashValue(rowHasher, itm[f]);
+            for (const auto& f : t.arrays) {
+                reindexer::VariantArray va = itm[f];
+                for (const auto& v : va) WriteRHashValue(rowHasher, v);
             }
 
-            if (usersData != "") data += ComputeHash(usersData);
+            rowHasher.Finalize(_hash);
+            tableHasher.Write(_hash, sizeof(_hash));
         }
 
-        // Get hash of Posts
-        {
-            std::string postsData = "";
-            reindexer::QueryResults postsRes;
-            g_pocketdb->Select(reindexer::Query("Posts").Where("block", CondEq, pindexPrev->nHeight).Sort("txid", false), postsRes);
-            for (auto& postIt : postsRes) {
-                std::string _postsData = "";
-                reindexer::Item postItm(postIt.GetItem());
-
-                _postsData += postItm["txid"].As<string>();
-                _postsData += postItm["block"].As<string>();
-                _postsData += postItm["time"].As<string>();
-                _postsData += postItm["address"].As<string>();
-                _postsData += postItm["lang"].As<string>();
-                _postsData += postItm["caption"].As<string>();
-                _postsData += postItm["message"].As<string>();
-                _postsData += postItm["settings"].As<string>();
-                _postsData += postItm["url"].As<string>();
-
-                reindexer::VariantArray postTags = postItm["tags"];
-                for (unsigned int i = 0; i < postTags.size(); i++) { _postsData += postTags[i].As<string>(); }
-
-                reindexer::VariantArray postImages = postItm["images"];
-                for (unsigned int i = 0; i < postImages.size(); i++) { _postsData += postImages[i].As<string>(); }
-
-                postsData += ComputeHash(_postsData);
-            }
+        tableHasher.Finalize(_hash);
+        hasher.Write(_hash, sizeof(_hash));
+    }
 
-            if (postsData != "") data += ComputeHash(postsData);
-        }
+    // RHash written to block of this height
+    hasher.Write((const unsigned char*)blockRHash.data(), blockRHash.size());
 
-        // Get hash of Scores
-        {
-            std::string scoresData = "";
-            reindexer::QueryResults scoresRes;
-            g_pocketdb->Select(reindexer::Query("Scores").Where("block", CondEq, pindexPrev->nHeight).Sort("txid", false), scoresRes);
-            for (auto& scoreIt : scoresRes) {
-                std::string _scoresData = "";
-                reindexer::Item scoreItm(scoreIt.GetItem());
-
-                _scoresData += scoreItm["txid"].As<string>();
-                _scoresData += scoreItm["block"].As<string>();
-                _scoresData += scoreItm["time"].As<string>();
-                _scoresData += scoreItm["posttxid"].As<string>();
-                _scoresData += scoreItm["address"].As<string>();
-                _scoresData += scoreItm["value"].As<string>();
-
-                scoresData += ComputeHash(_scoresData);
-            }
+    hasher.Finalize(_hash);
+    hash = HexStr(_hash, _hash + sizeof(_hash));
+    return true;
+}
 
-            if (scoresData != "") data += ComputeHash(scoresData);
-        }
+void AddrIndex::cacheRHash(const uint256& blockhash, int height, const std::string& hash)
+{
+    LOCK(cs_rhash);
+    rhash_cache[blockhash] = std::make_pair(height, hash);
 
-        // Get hash of Subscribes
-        {
-            std::string subscribesData = "";
-            reindexer::QueryResults subscribesRes;
-            g_pocketdb->Select(reindexer::Query("Subscribes").Where("block", CondEq, pindexPrev->nHeight).Sort("txid", false), subscribesRes);
-            for (auto& subscribeIt : subscribesRes) {
-                std::string _subscribesData = "";
-                reindexer::Item subscribeItm(subscribeIt.GetItem());
-
-                _subscribesData += subscribeItm["txid"].As<string>();
-                _subscribesData += subscribeItm["block"].As<string>();
-                _subscribesData += subscribeItm["time"].As<string>();
-                _subscribesData += subscribeItm["address"].As<string>();
-                _subscribesData += subscribeItm["address_to"].As<string>();
-                _subscribesData += subscribeItm["private"].As<string>();
-                _subscribesData += subscribeItm["unsubscribe"].As<string>();
-
-                subscribesData += ComputeHash(_subscribesData);
-            }
+    while (rhash_cache.size() > RHASH_CACHE_SIZE) {
+        auto oldest = std::min_element(rhash_cache.begin(), rhash_cache.end(), [](const auto& a, const auto& b) {
+            return a.second.first < b.second.first;
+        });
+        rhash_cache.erase(oldest);
+    }
+}
 
-            if (subscribesData != "") data += ComputeHash(subscribesData);
-        }
+void AddrIndex::cacheLotteryCandidates(const uint256& blockhash, int height, std::shared_ptr<const LotteryCandidates> candidates)
+{
+    LOCK(cs_lottery);
+    lottery_cache[blockhash] = std::make_pair(height, candidates);
 
-        // Get hash of Blocking
-        {
-            std::string blockingsData = "";
-            reindexer::QueryResults blockingsRes;
-            g_pocketdb->Select(reindexer::Query("Blocking").Where("block", CondEq, pindexPrev->nHeight).Sort("txid", false), blockingsRes);
-            for (auto& blockingIt : blockingsRes) {
-                std::string _blockingData = "";
-                reindexer::Item blockingItm(blockingIt.GetItem());
-
-                _blockingData += blockingItm["txid"].As<string>();
-                _blockingData += blockingItm["block"].As<string>();
-                _blockingData += blockingItm["time"].As<string>();
-                _blockingData += blockingItm["address"].As<string>();
-                _blockingData += blockingItm["address_to"].As<string>();
-                _blockingData += blockingItm["unblocking"].As<string>();
-
-                blockingsData += ComputeHash(_blockingData);
-            }
+    while (lottery_cache.size() > LOTTERY_CACHE_SIZE) {
+        auto oldest = std::min_element(lottery_cache.begin(), lottery_cache.end(), [](const auto& a, const auto& b) {
+            return a.second.first < b.second.first;
+        });
+        lottery_cache.erase(oldest);
+    }
+}
 
-            if (blockingsData != "") data += ComputeHash(blockingsData);
-        }
+bool AddrIndex::computeLotteryCandidates(const CBlock& block, int height, LotteryCandidates& candidates)
+{
+    int64_t _lottery_referral_depth = GetActualLimit(Limit::lottery_referral_depth, height);
 
-        // Get hash of Complains
-        {
-            std::string complainsData = "";
-            reindexer::QueryResults complainsRes;
-            g_pocketdb->Select(reindexer::Query("Complains").Where("block", CondEq, pindexPrev->nHeight).Sort("txid", false), complainsRes);
-            for (auto& complainIt : complainsRes) {
-                std::string _complainsData = "";
-                reindexer::Item complainItm(complainIt.GetItem());
-
-                _complainsData += complainItm["txid"].As<string>();
-                _complainsData += complainItm["block"].As<string>();
-                _complainsData += complainItm["time"].As<string>();
-                _complainsData += complainItm["posttxid"].As<string>();
-                _complainsData += complainItm["address"].As<string>();
-                _complainsData += complainItm["reason"].As<string>();
-
-                complainsData += ComputeHash(_complainsData);
-            }
+    // Get all users from block for lottery of next block
+    for (const auto& tx : block.vtx) {
+        std::vector<std::string> vasm;
+        if (!::FindPocketNetAsmString(tx, vasm)) continue;
+        if ((vasm[1] == OR_SCORE || vasm[1] == OR_COMMENT_SCORE) && vasm.size() >= 4) {
+            std::vector<unsigned char> _data_hex = ParseHex(vasm[3]);
+            std::string _data_str(_data_hex.begin(), _data_hex.end());
+            std::vector<std::string> _data;
+            boost::split(_data, _data_str, boost::is_any_of("\t "));
+            if (_data.size() >= 2) {
+                std::string _address = _data[0];
+                int _value = std::stoi(_data[1]);
+
+                // For lottery use scores as 4=1 and 5=2 - Scores to posts
+                if (vasm[1] == OR_SCORE && (_value == 4 || _value == 5)) {
+                    std::string _score_address;
+                    std::string _post_address;
+
+                    // Get address of score initiator
+                    reindexer::Item _score_itm;
+                    if (g_pocketdb->SelectOne(reindexer::Query("Scores").Where("txid", CondEq, tx->GetHash().GetHex()), _score_itm).ok())
+                        _score_address = _score_itm["address"].As<string>();
+
+                    reindexer::Item _post_itm;
+                    if (g_pocketdb->SelectOne(reindexer::Query("Posts").Where("txid", CondEq, _score_itm["posttxid"].As<string>()), _post_itm).ok())
+                        _post_address = _post_itm["address"].As<string>();
+
+                    if (_score_address.empty() || _post_address.empty()) {
+                        LogPrintf("computeLotteryCandidates error: _score_address='%s' _post_address='%s'\n", _score_address, _post_address);
+                        continue;
+                    }
 
-            if (complainsData != "") data += ComputeHash(complainsData);
-        }
+                    if (_address == _post_address && g_antibot->AllowModifyReputationOverPost(_score_address, _post_address, height, tx, true)) {
+                        candidates.postRatings[_post_address] += (_value - 3);
+
+                        // Find winners with referral program
+                        if (height >= Params().GetConsensus().lottery_referral_beg) {
+                            reindexer::Item _referrer_itm;
+
+                            reindexer::Query _referrer_query = reindexer::Query("UsersView").Where("address", CondEq, _post_address).Not().Where("referrer", CondEq, "").Not().Where("referrer", CondEq, _score_address);
+                            if (height >= Params().GetConsensus().lottery_referral_limitation) {
+                                _referrer_query.Where("regdate", CondGe, (int64_t)tx->nTime - _lottery_referral_depth);
+                            }
+
+                            if (g_pocketdb->SelectOne(_referrer_query, _referrer_itm).ok()) {
+                                if (candidates.postReferrers.find(_post_address) == candidates.postReferrers.end()) {
+                                    auto _referrer_address = _referrer_itm["referrer"].As<string>();
+                                    candidates.postReferrers.emplace(_post_address, _referrer_address);
+                                }
+                            }
+                        }
+                    }
+                }
 
-        // Get hash of UTXO
-        {
-            std::string utxosData = "";
-            reindexer::QueryResults utxosRes;
-            g_pocketdb->Select(reindexer::Query("UTXO").Where("block", CondEq, pindexPrev->nHeight).Sort("txid", false), utxosRes);
-            for (auto& utxoIt : utxosRes) {
-                std::string _utxosData = "";
-                reindexer::Item utxoItm(utxoIt.GetItem());
-
-                _utxosData += utxoItm["txid"].As<string>();
-                _utxosData += utxoItm["txout"].As<string>();
-                _utxosData += utxoItm["time"].As<string>();
-                _utxosData += utxoItm["block"].As<string>();
-                _utxosData += utxoItm["address"].As<string>();
-                _utxosData += utxoItm["amount"].As<string>();
-                _utxosData += utxoItm["spent_block"].As<string>();
-
-                utxosData += ComputeHash(_utxosData);
-            }
+                // For lottery use scores as 1 and -1 - Scores to comments
+                if (vasm[1] == OR_COMMENT_SCORE && (_value == 1)) {
+                    std::string _score_address;
+                    std::string _comment_address;
 
-            if (utxosData != "") data += ComputeHash(utxosData);
-        }
+                    // Get address of score initiator
+                    reindexer::Item _score_itm;
+                    if (g_pocketdb->SelectOne(reindexer::Query("CommentScores").Where("txid", CondEq, tx->GetHash().GetHex()), _score_itm).ok())
+                        _score_address = _score_itm["address"].As<string>();
 
-        // Get hash of Addresses
-        {
-            std::string addressesData = "";
-            reindexer::QueryResults addressesRes;
-            g_pocketdb->Select(reindexer::Query("Addresses").Where("block", CondEq, pindexPrev->nHeight).Sort("txid", false), addressesRes);
-            for (auto& addressIt : addressesRes) {
-                std::string _addressesData = "";
-                reindexer::Item addressItm(addressIt.GetItem());
-
-                _addressesData += addressItm["txid"].As<string>();
-                _addressesData += addressItm["block"].As<string>();
-                _addressesData += addressItm["address"].As<string>();
-                _addressesData += addressItm["time"].As<string>();
-
-                addressesData += ComputeHash(_addressesData);
-            }
+                    reindexer::Item _comment_itm;
+                    if (g_pocketdb->SelectOne(reindexer::Query("Comment").Where("txid", CondEq, _score_itm["commentid"].As<string>()), _comment_itm).ok())
+                        _comment_address = _comment_itm["address"].As<string>();
 
-            if (addressesData != "") data += ComputeHash(addressesData);
-        }
+                    if (_score_address.empty() || _comment_address.empty()) {
+                        LogPrintf("computeLotteryCandidates error: _score_address='%s' _comment_address='%s'\n", _score_address, _comment_address);
+                        continue;
+                    }
 
-        // Get hash of UserRatings
-        {
-            std::string userRatingsData = "";
-            reindexer::QueryResults userRatingsRes;
-            g_pocketdb->Select(reindexer::Query("UserRatings").Where("block", CondEq, pindexPrev->nHeight).Sort("address", false), userRatingsRes);
-            for (auto& userRatingIt : userRatingsRes) {
-                std::string _userRatingsData = "";
-                reindexer::Item userRatingItm(userRatingIt.GetItem());
-
-                _userRatingsData += userRatingItm["block"].As<string>();
-                _userRatingsData += userRatingItm["address"].As<string>();
-                _userRatingsData += userRatingItm["scoreSum"].As<string>();
-                _userRatingsData += userRatingItm["scoreCnt"].As<string>();
-
-                userRatingsData += ComputeHash(_userRatingsData);
+                    if (_address == _comment_address && g_antibot->AllowModifyReputationOverComment(_score_address, _comment_address, height, tx, true)) {
+                        candidates.commentRatings[_comment_address] += _value;
+
+                        // Find winners with referral program
+                        if (height >= Params().GetConsensus().lottery_referral_beg) {
+                            reindexer::Item _referrer_itm;
+
+                            reindexer::Query _referrer_query = reindexer::Query("UsersView").Where("address", CondEq, _comment_address).Not().Where("referrer", CondEq, "").Not().Where("referrer", CondEq, _score_address);
+                            if (height >= Params().GetConsensus().lottery_referral_limitation) {
+                                _referrer_query.Where("regdate", CondGe, (int64_t)tx->nTime - _lottery_referral_depth);
+                            }
+
+                            if (g_pocketdb->SelectOne(_referrer_query, _referrer_itm).ok()) {
+                                if (candidates.commentReferrers.find(_comment_address) == candidates.commentReferrers.end()) {
+                                    auto _referrer_address = _referrer_itm["referrer"].As<string>();
+                                    candidates.commentReferrers.emplace(_comment_address, _referrer_address);
+                                }
+                            }
+                        }
+                    }
+                }
             }
-
-            if (userRatingsData != "") data += ComputeHash(userRatingsData);
         }
+    }
 
-        // Get hash of PostRatings
-        {
-            std::string postRatingsData = "";
-            reindexer::QueryResults postRatingsRes;
-            g_pocketdb->Select(reindexer::Query("PostRatings").Where("block", CondEq, pindexPrev->nHeight).Sort("posttxid", false), postRatingsRes);
-            for (auto& postRatingIt : postRatingsRes) {
-                std::string _postRatingsData = "";
-                reindexer::Item postRatingItm(postRatingIt.GetItem());
-
-                _postRatingsData += postRatingItm["block"].As<string>();
-                _postRatingsData += postRatingItm["posttxid"].As<string>();
-                _postRatingsData += postRatingItm["scoreSum"].As<string>();
-                _postRatingsData += postRatingItm["scoreCnt"].As<string>();
-                _postRatingsData += postRatingItm["reputation"].As<string>();
-
-                postRatingsData += ComputeHash(_postRatingsData);
-            }
+    return true;
+}
 
-            if (postRatingsData != "") data += ComputeHash(postRatingsData);
+bool AddrIndex::GetLotteryCandidates(const CBlockIndex* pindex, std::shared_ptr<const LotteryCandidates>& candidates)
+{
+    {
+        LOCK(cs_lottery);
+        auto it = lottery_cache.find(pindex->GetBlockHash());
+        if (it != lottery_cache.end()) {
+            candidates = it->second.second;
+            return true;
         }
     }
 
-    // Get previous block data hash
-    {
-        if (pindexPrev->nHeight > 0) {
-            CBlock prevBlock;
-            if (!ReadBlockFromDisk(prevBlock, pindexPrev, Params().GetConsensus())) return false;
+    // Not cached after restart or for block not indexed by us - computed from current state
+    // as before, and not cached because state can be already ahead of this block
+    CBlock block;
+    ReadBlockFromDisk(block, pindex, Params().GetConsensus());
 
-            std::string prevBlockRHash;
-            if (GetBlockRHash(prevBlock, prevBlockRHash)) {
-                data += prevBlockRHash;
-            }
+    auto computed = std::make_shared<LotteryCandidates>();
+    if (!computeLotteryCandidates(block, pindex->nHeight, *computed)) return false;
+
+    candidates = computed;
+    return true;
+}
+
+bool AddrIndex::ComputeRHash(CBlockIndex* pindexPrev, std::string& hash)
+{
+    {
+        LOCK(cs_rhash);
+        auto it = rhash_cache.find(pindexPrev->GetBlockHash());
+        if (it != rhash_cache.end()) {
+            hash = it->second.second;
+            return true;
         }
     }
 
-    hash = ComputeHash(data);
-    
+    // Get previous block data hash
+    std::string prevBlockRHash;
+    if (pindexPrev->nHeight > 0) {
+        CBlock prevBlock;
+        if (!ReadBlockFromDisk(prevBlock, pindexPrev, Params().GetConsensus())) return false;
+        GetBlockRHash(prevBlock, prevBlockRHash);
+    }
+
+    if (!computeRHash(pindexPrev->nHeight, prevBlockRHash, hash)) return false;
+
+    cacheRHash(pindexPrev->GetBlockHash(), pindexPrev->nHeight, hash);
     return true;
 }
 
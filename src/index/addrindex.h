@@ -56,6 +56,29 @@ struct AddressUnspentTransactionItem {
     }
 };
 //-----------------------------------------------------
+// Count of last blocks with cached RHash
+static const size_t RHASH_CACHE_SIZE = 16;
+// Blocks without journal rolled back from tables at once
+static const int ROLLBACK_CHUNK_BLOCKS = 1000;
+// Count of last blocks with rollback journal in BlockUndo
+static const int BLOCK_UNDO_DEPTH = 1000;
+// Count of last blocks with cached lottery candidates
+static const size_t LOTTERY_CACHE_SIZE = 16;
+//-----------------------------------------------------
+/*
+    Users scored in block who take part in lottery of next block.
+    Depends only on block and RIDB state after it, winners
+    are drawn from it with hash of coinstake kernel.
+*/
+struct LotteryCandidates {
+    // <address, rating>
+    std::map<std::string, int> postRatings;
+    std::map<std::string, int> commentRatings;
+    // <address, referrer>
+    std::map<std::string, std::string> postReferrers;
+    std::map<std::string, std::string> commentReferrers;
+};
+//-----------------------------------------------------
 class AddrIndex
 {
 private:
@@ -120,7 +143,49 @@ private:
         Indexing posts data
     */
     bool indexPost(const CTransactionRef& tx, CBlockIndex* pindex);
-
+    /*
+        Hash rows of reindexer tables written at height
+        together with RHash stored in block of this height
+    */
+    bool computeRHash(int height, const std::string& blockRHash, std::string& hash);
+    /*
+        RHash of state after block, computed on first request.
+        <blockhash, <height, hash>>
+    */
+    CCriticalSection cs_rhash;
+    std::map<uint256, std::pair<int, std::string>> rhash_cache;
+    void cacheRHash(const uint256& blockhash, int height, const std::string& hash);
+    /*
+        Lottery candidates of recently connected blocks.
+        <blockhash, <height, candidates>>
+    */
+    CCriticalSection cs_lottery;
+    std::map<uint256, std::pair<int, std::shared_ptr<const LotteryCandidates>>> lottery_cache;
+    void cacheLotteryCandidates(const uint256& blockhash, int height, std::shared_ptr<const LotteryCandidates> candidates);
+    bool computeLotteryCandidates(const CBlock& block, int height, LotteryCandidates& candidates);
+    /*
+        Max block height of rows in reindexer tables
+    */
+    int getTopHeight();
+    /*
+        Delete all data above blockHeight and restore views and ratings
+    */
+    bool rollbackBlocks(int blockHeight, bool back_to_mempool);
+    /*
+        Rollback journal of block: txids of pocket rows by table
+        and keys of user, post and comment ratings written by block.
+        Saved to BlockUndo when block is indexed.
+    */
+    bool writeBlockUndo(int height,
+        const std::map<std::string, std::vector<std::string>>& rows,
+        const std::map<std::string, int>& userReputations,
+        const std::map<std::string, std::pair<int, int>>& postRatings,
+        const std::map<std::string, std::pair<int, int>>& commentRatings);
+    /*
+        Roll back block at height by its journal only.
+        found = false if block has no journal
+    */
+    bool replayBlockUndo(int height, bool back_to_mempool, bool& found);
 
 public:
     explicit AddrIndex();
@@ -153,8 +218,10 @@ public:
 		New current best block is `bestBlock`
 		Need delete all data from RIDB above this block height
 		Also need recalculating ratings
+		topHeight - highest block with RIDB rows if known by caller,
+		otherwise found from tables
 	*/
-    bool RollbackDB(int blockHeight, bool back_to_mempool = false);
+    bool RollbackDB(int blockHeight, bool back_to_mempool = false, int topHeight = -1);
     /*
 		Get all unspent transactions for array of addresses.
 		Function fill array `std::map<std::string, int>& transactions`.
@@ -192,23 +259,33 @@ public:
     /*
 		Get RI data for block transactions for send to another node.
 	*/
-    bool GetBlockRIData(CBlock block, std::string& data);
+    bool GetBlockRIData(CBlock block, PocketBlockData& data);
+    /*
+        Get RI data only for transactions at indexes in block.
+    */
+    bool GetBlockRIData(const CBlock& block, const std::vector<uint16_t>& indexes, PocketBlockData& data);
     /*
 		Write transaction for block received from another node
 	*/
-    bool SetBlockRIData(const CBlock& block, std::string& data, int height);
+    bool SetBlockRIData(const CBlock& block, const PocketBlockData& data, int height);
     /*
 		Get RI data for transaction for send to another node.
 		Check transaction is PocketNet type transaction
 		and get json data from reindexer DB by OP_RETURN type.
 		* First check RIMempool
 		* Second check general tables
+		Items from RIMempool are unwrapped to source table.
 	*/
-    bool GetTXRIData(CTransactionRef& tx, std::string& data);
+    bool GetTXRIData(CTransactionRef& tx, PocketTxData& data);
+    /*
+        Check RI data of transaction is here: in RIMempool or general tables.
+        True for not PocketNet transactions.
+    */
+    bool HaveTXRIData(const CTransactionRef& tx);
     /*
 		Write PocketNet data for this transaction
 	*/
-    bool SetTXRIData(const CTransactionRef& tx, std::string& data, int height);
+    bool SetTXRIData(const CTransactionRef& tx, const PocketTxData& data, int height);
     /*
 		Write RI Mempool data to general tables
 	*/
@@ -218,7 +295,8 @@ public:
 	*/
     bool ClearMempool(std::string txid);
     /*
-		Compute state of Reindexer DB
+		Compute state of Reindexer DB after block pindexPrev.
+		Cached for last requested blocks
 	*/
     bool ComputeRHash(CBlockIndex* pindexPrev, std::string& hash);
     /*
@@ -229,6 +307,11 @@ public:
 		Write ReindexerDB current state to coinbase transaction
 	*/
     bool WriteRHash(CBlock& block, CBlockIndex* pindexPrev);
+    /*
+        Lottery candidates of block, computed when block is indexed.
+        Read from disk and computed again if not cached
+    */
+    bool GetLotteryCandidates(const CBlockIndex* pindex, std::shared_ptr<const LotteryCandidates>& candidates);
     /*
         Present reindexer::Item as UniValue for antibot check
     */
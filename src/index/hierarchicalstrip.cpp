@@ -0,0 +1,432 @@
+// Copyright (c) 2018 PocketNet developers
+// Materialized ranking for gethierarchicalstrip
+//-----------------------------------------------------
+#include "index/hierarchicalstrip.h"
+#include "antibot/antibot.h"
+#include "pocketdb/pocketnet.h"
+#include <chain.h>
+#include <timedata.h>
+#include <algorithm>
+#include <cmath>
+//-----------------------------------------------------
+std::unique_ptr<HierarchicalStrip> g_hierarchicalstrip;
+//-----------------------------------------------------
+// Ranking parameters, see gethierarchicalstrip
+static const int STRIP_PREV_POSTS = 5;
+static const int STRIP_PREV_POSTS_BLOCKS = 30 * 24 * 60; // about 1 month
+static const double STRIP_DEKAY_REP = 0.82;
+static const double STRIP_DEKAY_POST = 0.96;
+static const double STRIP_DEKAY_POST_VIDEO = 0.99;
+//-----------------------------------------------------
+bool HierarchicalStrip::loadPost(reindexer::Item& itm, int height, StripPostRef& post)
+{
+    auto p = std::make_shared<StripPost>();
+    p->txid = itm["txid"].As<string>();
+    p->address = itm["address"].As<string>();
+    p->lang = itm["lang"].As<string>();
+    p->type = itm["type"].As<int>();
+    p->block = itm["block"].As<int>();
+    p->blockOrig = p->block;
+    p->time = itm["time"].As<int64_t>();
+    p->userRep = 0.0;
+    p->postRep = 0.0;
+
+    reindexer::VariantArray vaTags = itm["tags"];
+    for (auto& tag : vaTags)
+        p->tags.push_back(tag.As<string>());
+
+    reindexer::Item ratingItm;
+    if (g_pocketdb->SelectOne(reindexer::Query("PostRatings").Where("posttxid", CondEq, p->txid).Where("block", CondLe, height).Sort("block", true), ratingItm).ok())
+        p->postRep = ratingItm["reputation"].As<int>();
+
+    if (g_pocketdb->SelectOne(reindexer::Query("UserRatings").Where("address", CondEq, p->address).Where("block", CondLe, height).Sort("block", true), ratingItm).ok())
+        p->userRep = ratingItm["reputation"].As<int>() / 10.0;
+
+    reindexer::Item histItm;
+    if (g_pocketdb->SelectOne(reindexer::Query("PostsHistory").Where("txid", CondEq, p->txid).Where("block", CondLe, height).Sort("block", false), histItm).ok())
+        p->blockOrig = histItm["block"].As<int>();
+
+    // Scores for previous posts of author known at block of post
+    reindexer::QueryResults prevPostsRes;
+    reindexer::Error err = g_pocketdb->DB()->Select(reindexer::Query("Posts", 0, STRIP_PREV_POSTS)
+                                                        .Where("address", CondEq, p->address)
+                                                        .Where("block", CondLt, p->blockOrig)
+                                                        .Where("block", CondGe, p->blockOrig - STRIP_PREV_POSTS_BLOCKS),
+        prevPostsRes);
+    if (!err.ok()) return false;
+
+    std::vector<std::string> prevPostsIds;
+    for (auto it : prevPostsRes) {
+        reindexer::Item itmPP(it.GetItem());
+        prevPostsIds.push_back(itmPP["txid"].As<string>());
+    }
+
+    int cntPositiveScores = 0;
+    if (!prevPostsIds.empty()) {
+        std::vector<int> scores = {1, 5};
+        reindexer::QueryResults scoresRes;
+        err = g_pocketdb->DB()->Select(reindexer::Query("Scores")
+                                           .Where("posttxid", CondSet, prevPostsIds)
+                                           .Where("block", CondLe, p->block)
+                                           .Where("value", CondSet, scores),
+            scoresRes);
+        if (!err.ok()) return false;
+
+        std::set<std::string> addressesRated;
+        for (auto it : scoresRes) {
+            reindexer::Item itmScore(it.GetItem());
+            std::string scoreAddress = itmScore["address"].As<string>();
+            if (addressesRated.count(scoreAddress)) continue;
+
+            if (g_antibot->AllowModifyReputationOverPost(scoreAddress, p->address, itmScore["block"].As<int>(), itmScore["time"].As<int64_t>(), itmScore["txid"].As<string>(), false)) {
+                addressesRated.insert(scoreAddress);
+                cntPositiveScores += itmScore["value"].As<int>() == 5 ? 1 : -1;
+            }
+        }
+    }
+    p->last5 = 1.0 * cntPositiveScores;
+
+    post = p;
+    return true;
+}
+
+bool HierarchicalStrip::loadBadAddresses(int height, std::set<std::string>& addresses)
+{
+    int64_t _bad_reputation_limit = GetActualLimit(Limit::bad_reputation, height);
+    reindexer::QueryResults res;
+    if (!g_pocketdb->DB()->Select(reindexer::Query("UsersView").Where("reputation", CondLe, _bad_reputation_limit), res).ok())
+        return false;
+
+    for (auto it : res) {
+        reindexer::Item itm(it.GetItem());
+        addresses.insert(itm["address"].As<string>());
+    }
+
+    return true;
+}
+
+bool HierarchicalStrip::loadPosts(int height, std::map<std::string, StripPostRef>& posts,
+    const StripKey* key, const std::set<std::string>* skipAddresses)
+{
+    reindexer::Query query = reindexer::Query("Posts")
+                                 .Where("block", CondLe, height)
+                                 .Where("block", CondGt, height - HIERARCHICAL_STRIP_BLOCKS)
+                                 .Where("txidRepost", CondEq, "");
+    if (key && !key->first.empty()) query.Where("lang", CondEq, key->first);
+    if (key && !key->second.empty()) query.Where("type", CondSet, key->second);
+
+    reindexer::QueryResults res;
+    reindexer::Error err = g_pocketdb->DB()->Select(query, res);
+    if (!err.ok()) return false;
+
+    for (auto it : res) {
+        reindexer::Item itm(it.GetItem());
+        if (skipAddresses && skipAddresses->count(itm["address"].As<string>())) continue;
+
+        StripPostRef post;
+        if (!loadPost(itm, height, post)) return false;
+        posts.emplace(post->txid, post);
+    }
+
+    return true;
+}
+
+bool HierarchicalStrip::rebuild(int height)
+{
+    std::map<std::string, StripPostRef> newPosts;
+    auto newBadAddresses = std::make_shared<std::set<std::string>>();
+    if (!loadBadAddresses(height, *newBadAddresses)) return false;
+    if (!loadPosts(height, newPosts)) return false;
+
+    LOCK(cs);
+    posts.swap(newPosts);
+    badAddresses = newBadAddresses;
+    this->height = height;
+    return true;
+}
+
+bool HierarchicalStrip::applyBlock(int height)
+{
+    // Only this thread changes posts - read without lock
+    std::map<std::string, StripPostRef> newPosts;
+    for (auto& p : posts) {
+        if (p.second->block > height - HIERARCHICAL_STRIP_BLOCKS)
+            newPosts.emplace(p.first, p.second);
+    }
+
+    auto newBadAddresses = std::make_shared<std::set<std::string>>();
+    if (!loadBadAddresses(height, *newBadAddresses)) return false;
+
+    // New and edited posts
+    reindexer::QueryResults postsRes;
+    if (!g_pocketdb->DB()->Select(reindexer::Query("Posts").Where("block", CondEq, height), postsRes).ok())
+        return false;
+
+    for (auto it : postsRes) {
+        reindexer::Item itm(it.GetItem());
+        std::string txid = itm["txid"].As<string>();
+        if (itm["txidRepost"].As<string>() != "") {
+            newPosts.erase(txid);
+            continue;
+        }
+
+        StripPostRef post;
+        if (!loadPost(itm, height, post)) return false;
+        newPosts[txid] = post;
+    }
+
+    // Reputations changed in this block
+    reindexer::QueryResults postRatingsRes;
+    if (!g_pocketdb->DB()->Select(reindexer::Query("PostRatings").Where("block", CondEq, height), postRatingsRes).ok())
+        return false;
+
+    for (auto it : postRatingsRes) {
+        reindexer::Item itm(it.GetItem());
+        auto found = newPosts.find(itm["posttxid"].As<string>());
+        if (found == newPosts.end() || found->second->block == height) continue;
+
+        auto p = std::make_shared<StripPost>(*found->second);
+        p->postRep = itm["reputation"].As<int>();
+        found->second = p;
+    }
+
+    std::map<std::string, double> userReps;
+    reindexer::QueryResults userRatingsRes;
+    if (!g_pocketdb->DB()->Select(reindexer::Query("UserRatings").Where("block", CondEq, height), userRatingsRes).ok())
+        return false;
+
+    for (auto it : userRatingsRes) {
+        reindexer::Item itm(it.GetItem());
+        userReps[itm["address"].As<string>()] = itm["reputation"].As<int>() / 10.0;
+    }
+
+    if (!userReps.empty()) {
+        for (auto& p : newPosts) {
+            auto found = userReps.find(p.second->address);
+            if (found == userReps.end() || p.second->block == height) continue;
+
+            auto post = std::make_shared<StripPost>(*p.second);
+            post->userRep = found->second;
+            p.second = post;
+        }
+    }
+
+    LOCK(cs);
+    posts.swap(newPosts);
+    badAddresses = newBadAddresses;
+    this->height = height;
+    return true;
+}
+
+void HierarchicalStrip::reset()
+{
+    LOCK(cs);
+    posts.clear();
+    badAddresses.reset();
+    strips.clear();
+    height = -1;
+    blockHash.SetNull();
+    pendingHeight = -1;
+}
+
+std::shared_ptr<const std::vector<StripPostRef>> HierarchicalStrip::rank(const std::map<std::string, StripPostRef>& posts,
+    const std::set<std::string>& badAddresses, const StripKey& key, int height)
+{
+    const std::string& lang = key.first;
+    const std::vector<int>& contentTypes = key.second;
+    int64_t now = GetAdjustedTime();
+
+    std::vector<StripPostRef> selected;
+    for (auto& p : posts) {
+        const StripPost& post = *p.second;
+        if (post.time > now) continue;
+        if (!lang.empty() && post.lang != lang) continue;
+        if (!contentTypes.empty() && !std::binary_search(contentTypes.begin(), contentTypes.end(), post.type)) continue;
+        if (badAddresses.count(post.address)) continue;
+        selected.push_back(p.second);
+    }
+
+    double dekayPost = STRIP_DEKAY_POST;
+    if (contentTypes.size() == 1 && contentTypes[0] == getcontenttype("video"))
+        dekayPost = STRIP_DEKAY_POST_VIDEO;
+
+    // Percent of other posts with strictly lower value
+    int nElements = selected.size();
+    const auto percentiles = [&selected, nElements](double StripPost::*field) {
+        std::vector<double> sorted;
+        for (auto& p : selected)
+            sorted.push_back((*p).*field);
+        std::sort(sorted.begin(), sorted.end());
+
+        std::vector<double> result;
+        for (auto& p : selected) {
+            if (nElements > 1) {
+                auto lower = std::lower_bound(sorted.begin(), sorted.end(), (*p).*field) - sorted.begin();
+                result.push_back(1.0 * (lower * 100) / (nElements - 1));
+            } else {
+                result.push_back(100);
+            }
+        }
+        return result;
+    };
+
+    auto last5r = percentiles(&StripPost::last5);
+    auto urepr = percentiles(&StripPost::userRep);
+    auto prepr = percentiles(&StripPost::postRep);
+
+    std::vector<std::pair<double, std::string>> postsRaited;
+    std::map<std::string, StripPostRef> byTxid;
+    for (int i = 0; i < nElements; i++) {
+        const StripPost& post = *selected[i];
+        double uRepR = urepr[i];
+        double pRepR = prepr[i];
+        if (nElements > 1) {
+            uRepR = std::min(post.userRep, uRepR) * (post.userRep < 0 ? 2.0 : 1.0);
+            pRepR = std::min(post.postRep, pRepR) * (post.postRep < 0 ? 2.0 : 1.0);
+        }
+
+        double dRep = pow(STRIP_DEKAY_REP, (height - post.blockOrig));
+        double dPost = pow(dekayPost, (height - post.blockOrig));
+        double postRF = 0.4 * (0.75 * last5r[i] + 0.25 * uRepR) * dRep + 0.6 * pRepR * dPost;
+
+        postsRaited.push_back(std::make_pair(postRF, post.txid));
+        byTxid.emplace(post.txid, selected[i]);
+    }
+
+    std::sort(postsRaited.begin(), postsRaited.end(), std::greater{});
+
+    auto result = std::make_shared<std::vector<StripPostRef>>();
+    for (auto& v : postsRaited)
+        result->push_back(byTxid[v.second]);
+
+    return result;
+}
+
+void HierarchicalStrip::rankStrips()
+{
+    std::vector<StripKey> keys;
+    std::shared_ptr<const std::set<std::string>> bad;
+    int rankHeight;
+    {
+        LOCK(cs);
+        for (auto& s : strips)
+            keys.push_back(s.first);
+        bad = badAddresses;
+        rankHeight = height;
+    }
+
+    // Only this thread changes posts - read without lock
+    for (auto& key : keys) {
+        auto ranked = rank(posts, *bad, key, rankHeight);
+
+        LOCK(cs);
+        auto found = strips.find(key);
+        if (found == strips.end()) continue;
+        found->second.posts = ranked;
+        found->second.height = rankHeight;
+    }
+}
+
+void HierarchicalStrip::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    if (fInitialDownload) {
+        reset();
+        return;
+    }
+
+    int curHeight;
+    uint256 curHash;
+    {
+        LOCK(cs);
+        pendingHeight = pindexNew->nHeight;
+        curHeight = height;
+        curHash = blockHash;
+    }
+
+    // Continue from materialized block if it is still in chain
+    bool applied = false;
+    if (curHeight >= 0 && curHeight < pindexNew->nHeight && pindexNew->nHeight - curHeight <= HIERARCHICAL_STRIP_BLOCKS) {
+        const CBlockIndex* pindex = pindexNew->GetAncestor(curHeight);
+        if (pindex && pindex->GetBlockHash() == curHash) {
+            applied = true;
+            for (int h = curHeight + 1; applied && h <= pindexNew->nHeight; h++)
+                applied = applyBlock(h);
+        }
+    }
+
+    if (!applied && !rebuild(pindexNew->nHeight)) {
+        LogPrintf("HierarchicalStrip: failed ranking posts at height %d\n", pindexNew->nHeight);
+        reset();
+        return;
+    }
+
+    {
+        LOCK(cs);
+        blockHash = pindexNew->GetBlockHash();
+    }
+
+    rankStrips();
+
+    LOCK(cs);
+    pendingHeight = -1;
+}
+
+HierarchicalStrip::StripKey HierarchicalStrip::makeKey(const std::string& lang, std::vector<int> contentTypes)
+{
+    std::sort(contentTypes.begin(), contentTypes.end());
+    contentTypes.erase(std::unique(contentTypes.begin(), contentTypes.end()), contentTypes.end());
+    return StripKey(lang, contentTypes);
+}
+
+bool HierarchicalStrip::Get(int height, const std::string& lang, std::vector<int> contentTypes, HierarchicalStripResult& result)
+{
+    StripKey key = makeKey(lang, std::move(contentTypes));
+
+    LOCK(cs);
+    if (height < 0 || blockHash.IsNull() || !badAddresses)
+        return false;
+
+    // Tip moved and is still ranked - serve last materialized ranking
+    if (height != this->height) {
+        if (height < this->height || height > pendingHeight) return false;
+        height = this->height;
+    }
+
+    auto found = strips.find(key);
+    if (found == strips.end()) {
+        // Forget strip not requested for longest time
+        if (strips.size() >= HIERARCHICAL_STRIP_MAX_KEYS) {
+            auto oldest = std::min_element(strips.begin(), strips.end(), [](const std::pair<const StripKey, Strip>& a, const std::pair<const StripKey, Strip>& b) {
+                return a.second.lastRequest < b.second.lastRequest;
+            });
+            strips.erase(oldest);
+        }
+
+        found = strips.emplace(key, Strip()).first;
+    }
+
+    Strip& strip = found->second;
+    if (strip.height != height) {
+        strip.posts = rank(posts, *badAddresses, key, height);
+        strip.height = height;
+    }
+    strip.lastRequest = GetTime();
+
+    result.posts = strip.posts;
+    result.badAddresses = badAddresses;
+    return true;
+}
+
+bool HierarchicalStrip::Compute(int height, const std::string& lang, std::vector<int> contentTypes, HierarchicalStripResult& result)
+{
+    StripKey key = makeKey(lang, std::move(contentTypes));
+
+    std::map<std::string, StripPostRef> heightPosts;
+    auto heightBadAddresses = std::make_shared<std::set<std::string>>();
+    if (!loadBadAddresses(height, *heightBadAddresses)) return false;
+    if (!loadPosts(height, heightPosts, &key, heightBadAddresses.get())) return false;
+
+    result.posts = rank(heightPosts, *heightBadAddresses, key, height);
+    result.badAddresses = heightBadAddresses;
+    return true;
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2018 PocketNet developers
+// Materialized ranking for gethierarchicalstrip
+//-----------------------------------------------------
+#ifndef HIERARCHICALSTRIP_H
+#define HIERARCHICALSTRIP_H
+//-----------------------------------------------------
+#include "pocketdb/pocketdb.h"
+#include <sync.h>
+#include <uint256.h>
+#include <validationinterface.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+//-----------------------------------------------------
+// Posts of last blocks taking part in ranking
+static const int HIERARCHICAL_STRIP_BLOCKS = 300;
+// Max count of (lang, content types) strips kept ranked
+static const size_t HIERARCHICAL_STRIP_MAX_KEYS = 32;
+//-----------------------------------------------------
+/*
+    Ranking inputs of one post.
+    last5 depends only on post block and never changes,
+    reputations are refreshed from ratings of every new block.
+*/
+struct StripPost {
+    std::string txid;
+    std::string address;
+    std::string lang;
+    int type;
+    std::vector<std::string> tags;
+    int block;
+    int blockOrig;
+    int64_t time;
+    double last5;
+    double userRep;
+    double postRep;
+};
+
+typedef std::shared_ptr<const StripPost> StripPostRef;
+
+/* Posts ranked for one (lang, content types) at height */
+struct HierarchicalStripResult {
+    std::shared_ptr<const std::vector<StripPostRef>> posts;
+    // Users with reputation below Limit::bad_reputation, not ranked
+    std::shared_ptr<const std::set<std::string>> badAddresses;
+};
+//-----------------------------------------------------
+/*
+    Background ranking stage for gethierarchicalstrip.
+    After each connected block ranking inputs of posts from
+    last HIERARCHICAL_STRIP_BLOCKS blocks are updated incrementally
+    with posts and ratings of new block, then requested strips
+    are ranked again. RPC only filters and pages ranked list.
+    Ranking covers lang and content types, tags and exclusions
+    of request are applied to ranked list.
+    On reorg or gap inputs are collected from scratch.
+*/
+class HierarchicalStrip final : public CValidationInterface
+{
+private:
+    typedef std::pair<std::string, std::vector<int>> StripKey;
+
+    struct Strip {
+        std::shared_ptr<const std::vector<StripPostRef>> posts;
+        int height = -1;
+        int64_t lastRequest = 0;
+    };
+
+    CCriticalSection cs;
+    // Ranking inputs by txid at `height`
+    std::map<std::string, StripPostRef> posts;
+    std::shared_ptr<const std::set<std::string>> badAddresses;
+    std::map<StripKey, Strip> strips;
+    int height = -1;
+    uint256 blockHash;
+    // Tip being ranked by UpdatedBlockTip, -1 if none
+    int pendingHeight = -1;
+
+    bool loadPost(reindexer::Item& itm, int height, StripPostRef& post);
+    bool loadBadAddresses(int height, std::set<std::string>& addresses);
+    /*
+        Ranking inputs of posts from HIERARCHICAL_STRIP_BLOCKS blocks up to height.
+        With key only posts of its lang and content types are loaded,
+        posts of skipAddresses are not loaded.
+    */
+    bool loadPosts(int height, std::map<std::string, StripPostRef>& posts,
+        const StripKey* key = nullptr, const std::set<std::string>* skipAddresses = nullptr);
+    bool rebuild(int height);
+    bool applyBlock(int height);
+    void reset();
+    static std::shared_ptr<const std::vector<StripPostRef>> rank(const std::map<std::string, StripPostRef>& posts,
+        const std::set<std::string>& badAddresses, const StripKey& key, int height);
+    void rankStrips();
+    static StripKey makeKey(const std::string& lang, std::vector<int> contentTypes);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override;
+
+public:
+    /*
+        Ranked posts for lang and content types at height.
+        While new tip is ranked, requests up to its height are served
+        with last materialized ranking.
+        Returns false if ranking at this height is not materialized.
+    */
+    bool Get(int height, const std::string& lang, std::vector<int> contentTypes, HierarchicalStripResult& result);
+    /*
+        Same ranking collected from scratch for height that is not
+        materialized, e.g. historical height or before first block tip.
+        Slow - does not touch materialized state.
+    */
+    bool Compute(int height, const std::string& lang, std::vector<int> contentTypes, HierarchicalStripResult& result);
+};
+//-----------------------------------------------------
+extern std::unique_ptr<HierarchicalStrip> g_hierarchicalstrip;
+//-----------------------------------------------------
+#endif // HIERARCHICALSTRIP_H
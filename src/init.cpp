@@ -54,6 +54,8 @@
 
 #include <antibot/antibot.h>
 #include <index/addrindex.h>
+#include <index/hierarchicalstrip.h>
+#include <websocket/notifier.h>
 #include <pocketdb/pocketdb.h>
 
 #ifndef WIN32
@@ -195,6 +197,7 @@ void Shutdown()
     // Because these depend on each-other, we make sure that neither can be
     // using the other before destroying them.
     if (peerLogic) UnregisterValidationInterface(peerLogic.get());
+    if (g_hierarchicalstrip) UnregisterValidationInterface(g_hierarchicalstrip.get());
     if (g_connman) g_connman->Stop();
     if (g_txindex) g_txindex->Stop();
 
@@ -210,6 +213,9 @@ void Shutdown()
     peerLogic.reset();
     g_connman.reset();
     g_txindex.reset();
+    g_hierarchicalstrip.reset();
+    g_antibot_txqueue.reset();
+    g_wsnotifier.reset();
 
     if (g_is_mempool_loaded && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool();
@@ -254,6 +260,7 @@ void Shutdown()
     g_wallet_init_interface.Stop();
 
     // Stoping reindexer DB
+    POCKETNET_DATA.Close();
     g_pocketdb->~PocketDB();
     LogPrintf("Close reindexer DB\n");
 
@@ -350,6 +357,7 @@ void SetupServerArgs()
     gArgs.AddArg("-?", "Print this help message and exit", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-version", "Print version and exit", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-alertnotify=<cmd>", "Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)", false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-antibotthreads=<n>", strprintf("Set the number of threads for antibot checks of relayed transactions, 0 = check in message handler (default: %d)", DEFAULT_ANTIBOT_TX_THREADS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksdir=<dir>", "Specify blocks directory (default: <datadir>/blocks)", false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", false, OptionsCategory::OPTIONS);
@@ -377,6 +385,8 @@ void SetupServerArgs()
 #else
     hidden_args.emplace_back("-pid");
 #endif
+    gArgs.AddArg("-pocketdataspill=<n>", strprintf("Maximum disk space in megabytes for spilled pocket data of received blocks, data spilled first is dropped (default: %d)", DEFAULT_POCKETDATA_SPILL), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-pocketdatacache=<n>", strprintf("Maximum memory in megabytes for pocket data of received blocks waiting for connection, the rest is spilled to disk (default: %d)", DEFAULT_POCKETDATA_CACHE), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
                                          "Warning: Reverting this setting requires re-downloading the entire blockchain. "
                                          "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)",
@@ -512,7 +522,10 @@ void SetupServerArgs()
     gArgs.AddArg("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcallowip=<ip>", "Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times", false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcauth=<userpw>", "Username and hashed password for JSON-RPC connections. The field <userpw> comes in the format: <USERNAME>:<SALT>$<HASH>. A canonical python script is included in share/rpcauth. The client then connects normally using the rpcuser=<USERNAME>/rpcpassword=<PASSWORD> pair of arguments. This option can be specified multiple times", false, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcbatchparallel=<n>", strprintf("Max read-only calls of one JSON-RPC batch executed at once, 1 to execute sequentially (default: %d)", DEFAULT_RPC_BATCH_PARALLEL), false, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcbatchthreads=<n>", strprintf("Set the number of threads executing read-only calls of JSON-RPC batches (default: %d)", DEFAULT_RPC_BATCH_THREADS), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcbind=<addr>[:port]", "Bind to given address to listen for JSON-RPC connections. This option is ignored unless -rpcallowip is also passed. Port is optional and overrides -rpcport. Use [host]:port notation for IPv6. This option can be specified multiple times (default: 127.0.0.1 and ::1 i.e., localhost, or if -rpcallowip has been specified, 0.0.0.0 and :: i.e., all addresses)", false, OptionsCategory::RPC);
+    gArgs.AddArg("-rpccachesize=<n>", strprintf("Memory for cached replies of hot read-only RPC methods in MiB, 0 to disable (default: %d)", DEFAULT_RPC_CACHE_SIZE), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpccookiefile=<loc>", "Location of the auth cookie. Relative paths will be prefixed by a net-specific datadir location. (default: data dir)", false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcpassword=<pw>", "Password for JSON-RPC connections", false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcport=<port>", strprintf("Listen for JSON-RPC connections on <port> (default: %u, testnet: %u, regtest: %u)", defaultBaseParams->RPCPort(), testnetBaseParams->RPCPort(), regtestBaseParams->RPCPort()), false, OptionsCategory::RPC);
@@ -521,6 +534,9 @@ void SetupServerArgs()
 
     gArgs.AddArg("-rpcthreads=<n>", strprintf("Set the number of threads to service RPC (MAIN) calls (default: %d)", DEFAULT_HTTP_THREADS), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcpostthreads=<n>", strprintf("Set the number of threads to service RPC (POST) calls (default: %d)", DEFAULT_HTTP_POST_THREADS), false, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcpublicburst=<n>", strprintf("Max request cost a client of RPC (PUBLIC) may spend at once (default: %d)", DEFAULT_HTTP_PUBLIC_BURST), false, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcpublicproxy=<ip>", "Limit requests to RPC (PUBLIC) received from reverse proxy at specified source by client address in X-Forwarded-For header instead of proxy address. Valid for <ip> are a single IP or a subnet as for -rpcallowip, e.g. 127.0.0.1 for proxy on same host. This option can be specified multiple times", false, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcpublicrate=<n>", strprintf("Request cost per second allowed to each client of RPC (PUBLIC), 0 to disable limit. Lookups cost %d, strips and search cost more (default: %d)", HTTP_REQUEST_COST, DEFAULT_HTTP_PUBLIC_RATE), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcpublicthreads=<n>", strprintf("Set the number of threads to service RPC (PUBLIC) calls (default: %d)", DEFAULT_HTTP_PUBLIC_THREADS), false, OptionsCategory::RPC);
 
     gArgs.AddArg("-rpcuser=<user>", "Username for JSON-RPC connections", false, OptionsCategory::RPC);
@@ -1269,12 +1285,11 @@ static void StartWS()
                     if (std::find(keys.begin(), keys.end(), "wssport") != keys.end()) wssPort = val["wssport"].get_int();
 
                     if (std::find(keys.begin(), keys.end(), "nonce") != keys.end()) {
-                        WSUser wsUser = {connection, _addr, block, ip, service, mainPort, wssPort};
-                        WSConnections.erase(connection->ID());
-                        WSConnections.insert_or_assign(connection->ID(), wsUser);
+                        WSUser wsUser = {connection, _addr, block, ip, service, mainPort, wssPort, nullptr};
+                        WSConnections.Set(connection->ID(), wsUser);
                     } else if (std::find(keys.begin(), keys.end(), "msg") != keys.end()) {
                         if (val["msg"].get_str() == "unsubscribe") {
-                            WSConnections.erase(connection->ID());
+                            WSConnections.Erase(connection->ID());
                         }
                     }
                 } catch (const std::exception& e) {
@@ -1291,15 +1306,11 @@ static void StartWS()
     };
 
     ws.on_close = [](std::shared_ptr<WsServer::Connection> connection, int status, const string& /*reason*/) {
-        if (WSConnections.find(connection->ID()) != WSConnections.end()) {
-            WSConnections.erase(connection->ID());
-        }
+        WSConnections.Erase(connection->ID());
     };
 
     ws.on_error = [](std::shared_ptr<WsServer::Connection> connection, const SimpleWeb::error_code& ec) {
-        if (WSConnections.find(connection->ID()) != WSConnections.end()) {
-            WSConnections.erase(connection->ID());
-        }
+        WSConnections.Erase(connection->ID());
     };
 
     server.start();
@@ -1307,6 +1318,9 @@ static void StartWS()
 
 static void InitWS()
 {
+    g_wsnotifier = std::unique_ptr<WSNotifier>(new WSNotifier());
+    threadGroup.create_thread(&ThreadWSNotify);
+
     std::thread server_thread(&StartWS);
     server_thread.detach();
 }
@@ -1365,6 +1379,10 @@ bool AppInitMain()
     if (nScriptCheckThreads) {
         for (int i = 0; i < nScriptCheckThreads - 1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+
+        // AntiBot block checks run after script checks with same threads count
+        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+            threadGroup.create_thread(&ThreadAntiBotCheck);
     }
 
     // Start the lightweight task scheduler thread
@@ -1400,10 +1418,24 @@ bool AppInitMain()
     if (!g_pocketdb->Init()) {
         return InitError(_("Unable to start reindexer database."));
     }
+    int64_t nPocketDataCache = std::max<int64_t>(gArgs.GetArg("-pocketdatacache", DEFAULT_POCKETDATA_CACHE), 0) << 20;
+    int64_t nPocketDataSpill = std::max<int64_t>(gArgs.GetArg("-pocketdataspill", DEFAULT_POCKETDATA_SPILL), 0) << 20;
+    POCKETNET_DATA.Init(GetDataDir() / "pocketdata", nPocketDataCache, nPocketDataSpill);
+    LogPrintf("* Using %.1fMiB for pocket data of received blocks\n", nPocketDataCache * (1.0 / 1024 / 1024));
     // ********************************************************* Step 4.2: Start AddrIndex
     g_addrindex = std::unique_ptr<AddrIndex>(new AddrIndex());
     // ********************************************************* Step 4.3: Start AntiBot
     g_antibot = std::unique_ptr<AntiBot>(new AntiBot());
+    int nAntiBotTxThreads = std::max<int>(gArgs.GetArg("-antibotthreads", DEFAULT_ANTIBOT_TX_THREADS), 0);
+    if (nAntiBotTxThreads > 0) {
+        g_antibot_txqueue = std::unique_ptr<AntiBotTxQueue>(new AntiBotTxQueue());
+        for (int i = 0; i < nAntiBotTxThreads; i++)
+            threadGroup.create_thread(&ThreadAntiBotTxCheck);
+    }
+    LogPrintf("Using %d threads for antibot checks of relayed transactions\n", nAntiBotTxThreads);
+    // ********************************************************* Step 4.4: Start ranking for hierarchical strip
+    g_hierarchicalstrip = std::unique_ptr<HierarchicalStrip>(new HierarchicalStrip());
+    RegisterValidationInterface(g_hierarchicalstrip.get());
 
     // ********************************************************* Step 5: verify wallet database integrity
     if (!g_wallet_init_interface.Verify()) return false;
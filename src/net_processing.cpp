@@ -155,8 +155,14 @@ namespace {
     /** When our tip was last updated. */
     std::atomic<int64_t> g_last_tip_update(0);
 
+    /** Relayed transaction with its PocketNET payload, loaded on first getdata */
+    struct RelayTx {
+        CTransactionRef tx;
+        std::shared_ptr<const PocketTxData> pocketData;
+    };
+
     /** Relay map */
-    typedef std::map<uint256, CTransactionRef> MapRelay;
+    typedef std::map<uint256, RelayTx> MapRelay;
     MapRelay mapRelay GUARDED_BY(cs_main);
     /** Expiration-time ordered list of (expire time, relay map entry) pairs. */
     std::deque<std::pair<int64_t, MapRelay::iterator>> vRelayExpiration GUARDED_BY(cs_main);
@@ -721,6 +727,7 @@ void PeerLogicValidation::FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTim
         mapBlocksInFlight.erase(entry.hash);
     }
     EraseOrphansFor(nodeid);
+    if (g_antibot_txqueue) g_antibot_txqueue->Forget(nodeid);
     nPreferredDownload -= state->fPreferredDownload;
     nPeersWithValidatedDownloads -= (state->nBlocksInFlightValidHeaders != 0);
     assert(nPeersWithValidatedDownloads >= 0);
@@ -975,6 +982,49 @@ void PeerLogicValidation::BlockConnected(const std::shared_ptr<const CBlock>& pb
     g_last_tip_update = GetTime();
 }
 
+template <typename T>
+static PocketDataWire<T> PocketDataForPeer(const T& data, const CNode* pnode)
+{
+    return PocketDataWire<T>(data, pnode->GetSendVersion());
+}
+
+/** Read pocket data appended to block or tx message in the form this peer sends it */
+template <typename T>
+static void ReadPocketData(CDataStream& vRecv, const CNode* pfrom, T& data)
+{
+    if (!ReadPocketDataWire(vRecv, pfrom->GetSendVersion(), data))
+        LogPrintf("WARNING! Failed parse pocket data from peer=%d\n", pfrom->GetId());
+}
+
+/**
+ * Pocket data sent with compact block. Peers since POCKET_COMPACT_DATA_VERSION
+ * find data of known transactions in own RIMempool and request missing data
+ * with getblocktxn, so only data of transactions not announced to or by
+ * the peer is sent. `compact` is storage for the reduced data.
+ */
+static const PocketBlockData& CompactPocketDataForPeer(const PocketBlockData& data, CNode* pnode, PocketBlockData& compact)
+{
+    if (pnode->GetSendVersion() < POCKET_COMPACT_DATA_VERSION)
+        return data;
+
+    LOCK(pnode->cs_inventory);
+    for (const auto& it : data) {
+        if (!pnode->filterInventoryKnown.contains(it.first))
+            compact.emplace(it);
+    }
+
+    return compact;
+}
+
+/** PocketNET data of transaction received with block or stored in RIMempool or general tables */
+static bool HavePocketData(const CTransactionRef& tx, const PocketBlockData* received)
+{
+    if (received && received->count(tx->GetHash()))
+        return true;
+
+    return g_addrindex->HaveTXRIData(tx);
+}
+
 // All of the following cache a recent block, and are protected by cs_most_recent_block
 static CCriticalSection cs_most_recent_block;
 static std::shared_ptr<const CBlock> most_recent_block GUARDED_BY(cs_most_recent_block);
@@ -1022,11 +1072,12 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
                 !PeerHasHeader(&state, pindex) && PeerHasHeader(&state, pindex->pprev)) {
 			//-------------------------
 			// Get PocketData for transactions from this block
-			std::string pocket_data;
+			PocketBlockData pocket_data;
 			if (g_addrindex->GetBlockRIData(*most_recent_block, pocket_data)) {
                 LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
                         hashBlock.ToString(), pnode->GetId());
-                connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock, pocket_data));
+                PocketBlockData compact_data;
+                connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock, PocketDataForPeer(CompactPocketDataForPeer(pocket_data, pnode, compact_data), pnode)));
                 state.pindexBestHeaderSent = pindex;
             }
         }
@@ -1282,9 +1333,9 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
 
 
 			int h = pindex->nHeight;
-			std::string pocket_data;
+			PocketBlockData pocket_data;
 			if (g_addrindex->GetBlockRIData(block, pocket_data)) {
-                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data), pocket_data));
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data), PocketDataForPeer(pocket_data, pfrom)));
                 // Don't set pblock as we've sent the block
             }
         } else {
@@ -1322,8 +1373,9 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
 			else {
                 // TODO (brangr): refactor this logic
 				// Get RI data for transactions from this block
-				std::string pocket_data = "";
-				g_addrindex->GetBlockRIData(*pblock, pocket_data);
+				PocketBlockData _block_data;
+				g_addrindex->GetBlockRIData(*pblock, _block_data);
+				auto pocket_data = PocketDataForPeer(_block_data, pfrom);
 				//-----------------------
 				if (inv.type == MSG_BLOCK)
 					connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock, pocket_data));
@@ -1341,14 +1393,16 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
 						if ((fPeerWantsWitness || !fWitnessesPresentInARecentCompactBlock) && a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
 							//-------------------------
 							// Get PocketData for transactions from this block
-							std::string _pocket_data;
+							PocketBlockData _pocket_data;
 							g_addrindex->GetBlockRIData(*a_recent_block, _pocket_data);
 							//-------------------------
-							connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *a_recent_compact_block, _pocket_data));
+							PocketBlockData compact_data;
+							connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *a_recent_compact_block, PocketDataForPeer(CompactPocketDataForPeer(_pocket_data, pfrom, compact_data), pfrom)));
 						}
 						else {
 							CBlockHeaderAndShortTxIDs cmpctblock(*pblock, fPeerWantsWitness);
-							connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock, pocket_data));
+							PocketBlockData compact_data;
+							connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock, PocketDataForPeer(CompactPocketDataForPeer(_block_data, pfrom, compact_data), pfrom)));
 						}
 					}
 					else {
@@ -1372,6 +1426,23 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
     }
 }
 
+/**
+ * PocketNET payload for relayed transaction.
+ * Loaded from ReindexerDB only if not known yet and kept in mempool entry,
+ * so every next getdata for this transaction reuses it.
+ */
+static std::shared_ptr<const PocketTxData> GetRelayPocketData(const CTransactionRef& tx, std::shared_ptr<const PocketTxData> known) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if (known) return known;
+
+    CTransactionRef txref = tx;
+    auto pocket_data = std::make_shared<PocketTxData>();
+    if (!g_addrindex->GetTXRIData(txref, *pocket_data)) return nullptr;
+
+    mempool.SetPocketData(tx->GetHash(), pocket_data);
+    return pocket_data;
+}
+
 void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc) LOCKS_EXCLUDED(cs_main)
 {
     AssertLockNotHeld(cs_main);
@@ -1397,10 +1468,10 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
             auto mi = mapRelay.find(inv.hash);
             int nSendFlags = (inv.type == MSG_TX ? SERIALIZE_TRANSACTION_NO_WITNESS : 0);
             if (mi != mapRelay.end()) {
-				// Join PocketNet data from ReindexerDB to transaction stream
-				std::string pocket_data;
-                if (g_addrindex->GetTXRIData(mi->second, pocket_data)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *mi->second, pocket_data));
+                // Join PocketNet data from ReindexerDB to transaction stream
+                if (!mi->second.pocketData) mi->second.pocketData = GetRelayPocketData(mi->second.tx, nullptr);
+                if (mi->second.pocketData) {
+                    connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *mi->second.tx, PocketDataForPeer(*mi->second.pocketData, pfrom)));
                     push = true;
                 }
             } else if (pfrom->timeLastMempoolReq) {
@@ -1408,10 +1479,10 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
                 // To protect privacy, do not answer getdata using the mempool when
                 // that TX couldn't have been INVed in reply to a MEMPOOL request.
                 if (txinfo.tx && txinfo.nTime <= pfrom->timeLastMempoolReq) {
-					// Join PocketNet data from ReindexerDB to transaction stream
-					std::string pocket_data;
-					if (g_addrindex->GetTXRIData(txinfo.tx, pocket_data)) {
-                        connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *txinfo.tx, pocket_data));
+                    // Join PocketNet data from ReindexerDB to transaction stream
+                    auto pocket_data = GetRelayPocketData(txinfo.tx, txinfo.pocketData);
+                    if (pocket_data) {
+                        connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *txinfo.tx, PocketDataForPeer(*pocket_data, pfrom)));
                         push = true;
                     }
                 }
@@ -1454,12 +1525,6 @@ static uint32_t GetFetchFlags(CNode* pfrom) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
 
 inline void static SendBlockTransactions(const CBlock& block, const BlockTransactionsRequest& req, CNode* pfrom, CConnman* connman)
 {
-    // TODO (brangr): get transactions from resp - not from block
-	// Get PocketData for transactions from this block
-	std::string pocket_data;
-	g_addrindex->GetBlockRIData(block, pocket_data);
-	//-------------------------
-	// PocketData for this transactions
     BlockTransactions resp(req);
     for (size_t i = 0; i < req.indexes.size(); i++) {
         if (req.indexes[i] >= block.vtx.size()) {
@@ -1469,10 +1534,24 @@ inline void static SendBlockTransactions(const CBlock& block, const BlockTransac
         }
         resp.txn[i] = block.vtx[req.indexes[i]];
     }
+    for (uint16_t index : req.pocketIndexes) {
+        if (index >= block.vtx.size()) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 100, strprintf("Peer %d sent us a getblocktxn with out-of-bounds pocket data indices", pfrom->GetId()));
+            return;
+        }
+    }
+    //-------------------------
+    // PocketData only for requested transactions
+    std::vector<uint16_t> pocket_indexes(req.indexes);
+    pocket_indexes.insert(pocket_indexes.end(), req.pocketIndexes.begin(), req.pocketIndexes.end());
+    PocketBlockData pocket_data;
+    g_addrindex->GetBlockRIData(block, pocket_indexes, pocket_data);
+    //-------------------------
     LOCK(cs_main);
     const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
     int nSendFlags = State(pfrom->GetId())->fWantsCmpctWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
-    connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::BLOCKTXN, resp, pocket_data));
+    connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::BLOCKTXN, resp, PocketDataForPeer(pocket_data, pfrom)));
 }
 
 bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::vector<CBlockHeader>& headers, const CChainParams& chainparams, bool punish_duplicate_invalid)
@@ -1745,6 +1824,217 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
     return true;
 }
 
+/** Accept relayed transaction to mempool and relay it further.
+ * precheck is result of antibot check done on antibot threads, may be null.
+ */
+static void ProcessTransaction(CNode* pfrom, CConnman* connman, const CTransactionRef& ptx, const PocketTxData& pocket_data, AntiBotTxCheck* precheck, bool enable_bip61)
+{
+    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    std::deque<COutPoint> vWorkQueue;
+    std::vector<uint256> vEraseQueue;
+    const CTransaction& tx = *ptx;
+    RTransaction rtx(ptx);
+    const uint256& txhash = tx.GetHash();
+    CInv inv(MSG_TX, txhash);
+
+    LOCK2(cs_main, g_cs_orphans);
+
+    bool fMissingInputs = false;
+    CValidationState state;
+
+    pfrom->setAskFor.erase(inv.hash);
+    mapAlreadyAskedFor.erase(inv.hash);
+
+    std::list<CTransactionRef> lRemovedTxn;
+
+    // Antibot checked transaction with pocketnet consensus rules
+    if (g_addrindex->IsPocketnetTransaction(rtx)) {
+        if (pocket_data.IsNull()) {
+            LogPrintf("WARNING! NetMsgType::TX Receive transaction without pocketdata: %s\n", ptx->GetHash().GetHex());
+            state.Invalid(false, REJECT_INCOMPLETE, "Network");
+        } else {
+            ANTIBOTRESULT ab_result = ANTIBOTRESULT::Success;
+            if (precheck && precheck->failed) {
+                // Pocket data not decoded on antibot threads
+                state.DoS(10, false, REJECT_INVALID, "bad-pocketdata");
+            } else if (precheck && precheck->height == chainActive.Height() + 1) {
+                // Decoded and checked on antibot threads
+                rtx = std::move(precheck->rtx);
+                ab_result = precheck->result;
+            } else {
+                rtx.pTable = pocket_data.table;
+                rtx.pTransaction = g_pocketdb->DB()->NewItem(rtx.pTable);
+                if (!rtx.pTransaction.FromJSON(pocket_data.data).ok())
+                    state.DoS(10, false, REJECT_INVALID, "bad-pocketdata");
+                else if (!g_antibot_txqueue || !g_antibot_txqueue->GetResult(txhash, pocket_data, chainActive.Height() + 1, ab_result))
+                    g_antibot->CheckTransactionRIItem(g_addrindex->GetUniValue(rtx, rtx.pTransaction, rtx.pTable), chainActive.Height() + 1, ab_result);
+            }
+
+            if (!state.IsInvalid() && ab_result != ANTIBOTRESULT::Success) {
+                LogPrintf("WARNING! Receive transaction, antibot check: %d %s\n", ab_result, ptx->GetHash().GetHex());
+                state.Invalid(false, ab_result, "Antibot");
+            }
+        }
+    }
+
+    if (!state.IsInvalid() && !AlreadyHave(inv) && AcceptToMemoryPool(mempool, state, rtx, &fMissingInputs, &lRemovedTxn, false /* bypass_limits */, 0 /* nAbsurdFee */))
+    {
+        mempool.check(pcoinsTip.get());
+        RelayTransaction(tx, connman);
+        for (unsigned int i = 0; i < tx.vout.size(); i++) {
+            vWorkQueue.emplace_back(inv.hash, i);
+        }
+
+        pfrom->nLastTXTime = GetTime();
+
+        LogPrint(BCLog::MEMPOOL, "AcceptToMemoryPool: peer=%d: accepted %s (poolsz %u txn, %u kB)\n",
+            pfrom->GetId(),
+            tx.GetHash().ToString(),
+            mempool.size(), mempool.DynamicMemoryUsage() / 1000);
+
+        // Recursively process any orphan transactions that depended on this one
+        std::set<NodeId> setMisbehaving;
+        while (!vWorkQueue.empty()) {
+            auto itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue.front());
+            vWorkQueue.pop_front();
+            if (itByPrev == mapOrphanTransactionsByPrev.end())
+                continue;
+            for (auto mi = itByPrev->second.begin();
+                 mi != itByPrev->second.end();
+                 ++mi)
+            {
+                const CTransactionRef& porphanTx = (*mi)->second.tx;
+                const CTransaction& orphanTx = *porphanTx;
+                const uint256& orphanHash = orphanTx.GetHash();
+                NodeId fromPeer = (*mi)->second.fromPeer;
+                bool fMissingInputs2 = false;
+                // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
+                // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
+                // anyone relaying LegitTxX banned)
+                CValidationState stateDummy;
+
+
+                if (setMisbehaving.count(fromPeer))
+                    continue;
+                if (AcceptToMemoryPool(mempool, stateDummy, porphanTx, &fMissingInputs2, &lRemovedTxn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
+                    LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
+                    RelayTransaction(orphanTx, connman);
+                    for (unsigned int i = 0; i < orphanTx.vout.size(); i++) {
+                        vWorkQueue.emplace_back(orphanHash, i);
+                    }
+                    vEraseQueue.push_back(orphanHash);
+                }
+                else if (!fMissingInputs2)
+                {
+                    int nDos = 0;
+                    if (stateDummy.IsInvalid(nDos) && nDos > 0)
+                    {
+                        // Punish peer that gave us an invalid orphan tx
+                        Misbehaving(fromPeer, nDos);
+                        setMisbehaving.insert(fromPeer);
+                        LogPrint(BCLog::MEMPOOL, "   invalid orphan tx %s\n", orphanHash.ToString());
+                    }
+                    // Has inputs but not accepted to mempool
+                    // Probably non-standard or insufficient fee
+                    LogPrint(BCLog::MEMPOOL, "   removed orphan tx %s\n", orphanHash.ToString());
+                    vEraseQueue.push_back(orphanHash);
+                    if (!orphanTx.HasWitness() && !stateDummy.CorruptionPossible()) {
+                        // Do not use rejection cache for witness transactions or
+                        // witness-stripped transactions, as they can have been malleated.
+                        // See https://github.com/pocketcoin/pocketcoin/issues/8279 for details.
+                        assert(recentRejects);
+                        recentRejects->insert(orphanHash);
+                    }
+                }
+                mempool.check(pcoinsTip.get());
+            }
+        }
+
+        for (const uint256& hash : vEraseQueue)
+            EraseOrphanTx(hash);
+    }
+    else if (fMissingInputs)
+    {
+        bool fRejectedParents = false; // It may be the case that the orphans parents have all been rejected
+        for (const CTxIn& txin : tx.vin) {
+            if (recentRejects->contains(txin.prevout.hash)) {
+                fRejectedParents = true;
+                break;
+            }
+        }
+        if (!fRejectedParents) {
+            uint32_t nFetchFlags = GetFetchFlags(pfrom);
+            for (const CTxIn& txin : tx.vin) {
+                CInv _inv(MSG_TX | nFetchFlags, txin.prevout.hash);
+                pfrom->AddInventoryKnown(_inv);
+                if (!AlreadyHave(_inv)) pfrom->AskFor(_inv);
+            }
+            AddOrphanTx(ptx, pfrom->GetId());
+
+            // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
+            unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, gArgs.GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+            unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
+            if (nEvicted > 0) {
+                LogPrint(BCLog::MEMPOOL, "mapOrphan overflow, removed %u tx\n", nEvicted);
+            }
+        } else {
+            LogPrint(BCLog::MEMPOOL, "not keeping orphan with rejected parents %s\n",tx.GetHash().ToString());
+            // We will continue to reject this tx since it has rejected
+            // parents so avoid re-requesting it from other peers.
+            recentRejects->insert(tx.GetHash());
+        }
+    } else {
+        if (!tx.HasWitness() && !state.CorruptionPossible()) {
+            // Do not use rejection cache for witness transactions or
+            // witness-stripped transactions, as they can have been malleated.
+            // See https://github.com/pocketcoin/pocketcoin/issues/8279 for details.
+            assert(recentRejects);
+            recentRejects->insert(txhash);
+            if (RecursiveDynamicUsage(*ptx) < 100000) {
+                AddToCompactExtraTransactions(ptx);
+            }
+        } else if (tx.HasWitness() && RecursiveDynamicUsage(*ptx) < 100000) {
+            AddToCompactExtraTransactions(ptx);
+        }
+
+        if (pfrom->fWhitelisted && gArgs.GetBoolArg("-whitelistforcerelay", DEFAULT_WHITELISTFORCERELAY)) {
+            // Always relay transactions received from whitelisted peers, even
+            // if they were already in the mempool or rejected from it due
+            // to policy, allowing the node to function as a gateway for
+            // nodes hidden behind it.
+            //
+            // Never relay transactions that we would assign a non-zero DoS
+            // score for, as we expect peers to do the same with us in that
+            // case.
+            int nDoS = 0;
+            if (!state.IsInvalid(nDoS) || nDoS == 0) {
+                LogPrintf("Force relaying tx %s from whitelisted peer=%d\n", tx.GetHash().ToString(), pfrom->GetId());
+                RelayTransaction(tx, connman);
+            } else {
+                LogPrintf("Not relaying invalid transaction %s from whitelisted peer=%d (%s)\n", tx.GetHash().ToString(), pfrom->GetId(), FormatStateMessage(state));
+            }
+        }
+    }
+
+    for (const CTransactionRef& removedTx : lRemovedTxn)
+        AddToCompactExtraTransactions(removedTx);
+
+    int nDoS = 0;
+    if (state.IsInvalid(nDoS))
+    {
+        LogPrint(BCLog::MEMPOOLREJ, "%s from peer=%d was not accepted: %s\n", tx.GetHash().ToString(),
+            pfrom->GetId(),
+            FormatStateMessage(state));
+        if (enable_bip61 && state.GetRejectCode() > 0 && state.GetRejectCode() < REJECT_INTERNAL) { // Never send AcceptToMemoryPool's internal codes over P2P
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::REJECT, std::string(NetMsgType::TX), (unsigned char)state.GetRejectCode(),
+                               state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash));
+        }
+        if (nDoS > 0) {
+            Misbehaving(pfrom->GetId(), nDoS);
+        }
+    }
+}
+
 bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, bool enable_bip61)
 {
     LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->GetId());
@@ -2372,220 +2662,34 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
-        std::deque<COutPoint> vWorkQueue;
-        std::vector<uint256> vEraseQueue;
         CTransactionRef ptx;
 
 		vRecv >> ptx;
-		const CTransaction& tx = *ptx;
-        RTransaction rtx(*ptx);
-		const uint256& txhash = tx.GetHash();
+		const uint256& txhash = ptx->GetHash();
 		//----------------------
-		std::string pocket_data;
-		if (vRecv.size() > 0) {
-			vRecv >> pocket_data;
-		}
+		PocketTxData pocket_data;
+		ReadPocketData(vRecv, pfrom, pocket_data);
 		//----------------------
         CInv inv(MSG_TX, txhash);
         pfrom->AddInventoryKnown(inv);
 
-        LOCK2(cs_main, g_cs_orphans);
-
-        bool fMissingInputs = false;
-        CValidationState state;
-
-        pfrom->setAskFor.erase(inv.hash);
-        mapAlreadyAskedFor.erase(inv.hash);
-
-        std::list<CTransactionRef> lRemovedTxn;
-		
-        // Antibot checked transaction with pocketnet consensus rules
-        if (g_addrindex->IsPocketnetTransaction(rtx)) {
-            if (pocket_data == "") {
-                LogPrintf("WARNING! NetMsgType::TX Receive transaction without pocketdata: %s\n", ptx->GetHash().GetHex());
-                state.Invalid(false, REJECT_INCOMPLETE, "Network");
-            } else {
-                // Check transaction with Antibot
-                UniValue _txs_src(UniValue::VOBJ);
-                _txs_src.read(pocket_data);
-
-                rtx.pTable = _txs_src["t"].get_str();
-                rtx.pTransaction = g_pocketdb->DB()->NewItem(rtx.pTable);
-                rtx.pTransaction.FromJSON(DecodeBase64(_txs_src["d"].get_str()));
-
-                if (rtx.pTable == "Mempool") {
-                    rtx.pTable = rtx.pTransaction["table"].As<string>();
-                    std::string _data = rtx.pTransaction["data"].As<string>();
-                    rtx.pTransaction = g_pocketdb->DB()->NewItem(rtx.pTable);
-                    rtx.pTransaction.FromJSON(DecodeBase64(_data));
-                }
-
-                ANTIBOTRESULT ab_result;
-                g_antibot->CheckTransactionRIItem(g_addrindex->GetUniValue(rtx, rtx.pTransaction, rtx.pTable), chainActive.Height() + 1, ab_result);
-                if (ab_result != ANTIBOTRESULT::Success) {
-                    LogPrintf("WARNING! Receive transaction, antibot check: %d %s\n", ab_result, ptx->GetHash().GetHex());
-                    state.Invalid(false, ab_result, "Antibot");
-                }
-            }
-        }
-        
-        if (!state.IsInvalid() && !AlreadyHave(inv) && AcceptToMemoryPool(mempool, state, rtx, &fMissingInputs, &lRemovedTxn, false /* bypass_limits */, 0 /* nAbsurdFee */))
-		{
-            mempool.check(pcoinsTip.get());
-            RelayTransaction(tx, connman);
-            for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                vWorkQueue.emplace_back(inv.hash, i);
-            }
-
-            pfrom->nLastTXTime = GetTime();
-
-            LogPrint(BCLog::MEMPOOL, "AcceptToMemoryPool: peer=%d: accepted %s (poolsz %u txn, %u kB)\n",
-                pfrom->GetId(),
-                tx.GetHash().ToString(),
-                mempool.size(), mempool.DynamicMemoryUsage() / 1000);
-
-            // Recursively process any orphan transactions that depended on this one
-            std::set<NodeId> setMisbehaving;
-            while (!vWorkQueue.empty()) {
-                auto itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue.front());
-                vWorkQueue.pop_front();
-                if (itByPrev == mapOrphanTransactionsByPrev.end())
-                    continue;
-                for (auto mi = itByPrev->second.begin();
-                     mi != itByPrev->second.end();
-                     ++mi)
-                {
-                    const CTransactionRef& porphanTx = (*mi)->second.tx;
-                    const CTransaction& orphanTx = *porphanTx;
-                    const uint256& orphanHash = orphanTx.GetHash();
-                    NodeId fromPeer = (*mi)->second.fromPeer;
-                    bool fMissingInputs2 = false;
-                    // Use a dummy CValidationState so someone can't setup nodes to counter-DoS based on orphan
-                    // resolution (that is, feeding people an invalid transaction based on LegitTxX in order to get
-                    // anyone relaying LegitTxX banned)
-                    CValidationState stateDummy;
-
-
-                    if (setMisbehaving.count(fromPeer))
-                        continue;
-                    if (AcceptToMemoryPool(mempool, stateDummy, porphanTx, &fMissingInputs2, &lRemovedTxn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
-                        LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
-                        RelayTransaction(orphanTx, connman);
-                        for (unsigned int i = 0; i < orphanTx.vout.size(); i++) {
-                            vWorkQueue.emplace_back(orphanHash, i);
-                        }
-                        vEraseQueue.push_back(orphanHash);
-                    }
-                    else if (!fMissingInputs2)
-                    {
-                        int nDos = 0;
-                        if (stateDummy.IsInvalid(nDos) && nDos > 0)
-                        {
-                            // Punish peer that gave us an invalid orphan tx
-                            Misbehaving(fromPeer, nDos);
-                            setMisbehaving.insert(fromPeer);
-                            LogPrint(BCLog::MEMPOOL, "   invalid orphan tx %s\n", orphanHash.ToString());
-                        }
-                        // Has inputs but not accepted to mempool
-                        // Probably non-standard or insufficient fee
-                        LogPrint(BCLog::MEMPOOL, "   removed orphan tx %s\n", orphanHash.ToString());
-                        vEraseQueue.push_back(orphanHash);
-                        if (!orphanTx.HasWitness() && !stateDummy.CorruptionPossible()) {
-                            // Do not use rejection cache for witness transactions or
-                            // witness-stripped transactions, as they can have been malleated.
-                            // See https://github.com/pocketcoin/pocketcoin/issues/8279 for details.
-                            assert(recentRejects);
-                            recentRejects->insert(orphanHash);
-                        }
-                    }
-                    mempool.check(pcoinsTip.get());
-                }
-            }
-
-            for (const uint256& hash : vEraseQueue)
-                EraseOrphanTx(hash);
-        }
-        else if (fMissingInputs)
-        {
-            bool fRejectedParents = false; // It may be the case that the orphans parents have all been rejected
-            for (const CTxIn& txin : tx.vin) {
-                if (recentRejects->contains(txin.prevout.hash)) {
-                    fRejectedParents = true;
-                    break;
-                }
-            }
-            if (!fRejectedParents) {
-                uint32_t nFetchFlags = GetFetchFlags(pfrom);
-                for (const CTxIn& txin : tx.vin) {
-                    CInv _inv(MSG_TX | nFetchFlags, txin.prevout.hash);
-                    pfrom->AddInventoryKnown(_inv);
-                    if (!AlreadyHave(_inv)) pfrom->AskFor(_inv);
-                }
-                AddOrphanTx(ptx, pfrom->GetId());
-
-                // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
-                unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, gArgs.GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
-                unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
-                if (nEvicted > 0) {
-                    LogPrint(BCLog::MEMPOOL, "mapOrphan overflow, removed %u tx\n", nEvicted);
-                }
-            } else {
-                LogPrint(BCLog::MEMPOOL, "not keeping orphan with rejected parents %s\n",tx.GetHash().ToString());
-                // We will continue to reject this tx since it has rejected
-                // parents so avoid re-requesting it from other peers.
-                recentRejects->insert(tx.GetHash());
-            }
-        } else {
-            if (!tx.HasWitness() && !state.CorruptionPossible()) {
-                // Do not use rejection cache for witness transactions or
-                // witness-stripped transactions, as they can have been malleated.
-                // See https://github.com/pocketcoin/pocketcoin/issues/8279 for details.
-                assert(recentRejects);
-                recentRejects->insert(txhash);
-                if (RecursiveDynamicUsage(*ptx) < 100000) {
-                    AddToCompactExtraTransactions(ptx);
-                }
-            } else if (tx.HasWitness() && RecursiveDynamicUsage(*ptx) < 100000) {
-                AddToCompactExtraTransactions(ptx);
-            }
-
-            if (pfrom->fWhitelisted && gArgs.GetBoolArg("-whitelistforcerelay", DEFAULT_WHITELISTFORCERELAY)) {
-                // Always relay transactions received from whitelisted peers, even
-                // if they were already in the mempool or rejected from it due
-                // to policy, allowing the node to function as a gateway for
-                // nodes hidden behind it.
-                //
-                // Never relay transactions that we would assign a non-zero DoS
-                // score for, as we expect peers to do the same with us in that
-                // case.
-                int nDoS = 0;
-                if (!state.IsInvalid(nDoS) || nDoS == 0) {
-                    LogPrintf("Force relaying tx %s from whitelisted peer=%d\n", tx.GetHash().ToString(), pfrom->GetId());
-                    RelayTransaction(tx, connman);
-                } else {
-                    LogPrintf("Not relaying invalid transaction %s from whitelisted peer=%d (%s)\n", tx.GetHash().ToString(), pfrom->GetId(), FormatStateMessage(state));
-                }
+        // Antibot checks of pocket transactions run without cs_main,
+        // transaction is accepted later from ProcessMessages
+        if (g_antibot_txqueue && !pocket_data.IsNull() && g_addrindex->IsPocketnetTransaction(*ptx)) {
+            bool fQueue;
+            int nHeight;
+            {
+                LOCK(cs_main);
+                nHeight = chainActive.Height() + 1;
+                fQueue = !AlreadyHave(inv);
             }
-        }
-
-        for (const CTransactionRef& removedTx : lRemovedTxn)
-            AddToCompactExtraTransactions(removedTx);
 
-        int nDoS = 0;
-        if (state.IsInvalid(nDoS))
-        {
-            LogPrint(BCLog::MEMPOOLREJ, "%s from peer=%d was not accepted: %s\n", tx.GetHash().ToString(),
-                pfrom->GetId(),
-                FormatStateMessage(state));
-            if (enable_bip61 && state.GetRejectCode() > 0 && state.GetRejectCode() < REJECT_INTERNAL) { // Never send AcceptToMemoryPool's internal codes over P2P
-                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::REJECT, strCommand, (unsigned char)state.GetRejectCode(),
-                                   state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash));
-            }
-            if (nDoS > 0) {
-                Misbehaving(pfrom->GetId(), nDoS);
-            }
+            ANTIBOTRESULT ab_result;
+            if (fQueue && !g_antibot_txqueue->GetResult(txhash, pocket_data, nHeight, ab_result) && g_antibot_txqueue->Submit(pfrom->GetId(), ptx, pocket_data, nHeight))
+                return true;
         }
 
+        ProcessTransaction(pfrom, connman, ptx, pocket_data, nullptr, enable_bip61);
         return true;
     }
 
@@ -2594,13 +2698,11 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         CBlockHeaderAndShortTxIDs cmpctblock;
         vRecv >> cmpctblock;
 		//------------------------------
-		std::string pocket_data;
-		if (vRecv.size() > 0) {
-			vRecv >> pocket_data;
-		}
+		PocketBlockData pocket_data;
+		ReadPocketData(vRecv, pfrom, pocket_data);
 
-		if (pocket_data != "") {
-			POCKETNET_DATA.emplace(cmpctblock.header.GetHash(), pocket_data);
+		if (!pocket_data.empty()) {
+			POCKETNET_DATA.Put(cmpctblock.header.GetHash(), std::move(pocket_data));
 		}
 		//------------------------------
         bool received_new_header = false;
@@ -2737,12 +2839,19 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                     return true;
                 }
 
+                // Peers since POCKET_COMPACT_DATA_VERSION send pocket data only of
+                // transactions we were not told about, rest is requested if we miss it
+                bool fCompactPocketData = pfrom->GetRecvVersion() >= POCKET_COMPACT_DATA_VERSION;
+                auto received_data = POCKETNET_DATA.Get(cmpctblock.header.GetHash());
+
                 BlockTransactionsRequest req;
                 for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++) {
                     if (!partialBlock.IsTxAvailable(i))
                         req.indexes.push_back(i);
+                    else if (fCompactPocketData && !HavePocketData(partialBlock.GetAvailableTx(i), received_data.get()))
+                        req.pocketIndexes.push_back(i);
                 }
-                if (req.indexes.empty()) {
+                if (req.indexes.empty() && req.pocketIndexes.empty()) {
                     // Dirty hack to jump to BLOCKTXN code (TODO: move message handling into their own functions)
                     BlockTransactions txn;
                     txn.blockhash = cmpctblock.header.GetHash();
@@ -2767,7 +2876,11 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 std::vector<CTransactionRef> dummy;
                 status = tempBlock.FillBlock(*pblock, dummy);
                 if (status == READ_STATUS_OK) {
-                    fBlockReconstructed = true;
+                    // Without all pocket data block can not be connected, wait for it from other peer
+                    auto received_data = POCKETNET_DATA.Get(pblock->GetHash());
+                    fBlockReconstructed = std::all_of(pblock->vtx.begin(), pblock->vtx.end(), [&received_data](const CTransactionRef& tx) {
+                        return HavePocketData(tx, received_data.get());
+                    });
                 }
             }
         } else {
@@ -2839,10 +2952,8 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         BlockTransactions resp;
         vRecv >> resp;
 		//------------------------------
-		std::string pocket_data;
-		if (vRecv.size() > 0) {
-			vRecv >> pocket_data;
-		}
+		PocketBlockData pocket_data;
+		ReadPocketData(vRecv, pfrom, pocket_data);
 		//------------------------------
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
         bool fBlockRead = false;
@@ -2897,8 +3008,8 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         } // Don't hold cs_main when we call into ProcessNewBlock
 
         if (fBlockRead) {
-			if (pocket_data != "") {
-				POCKETNET_DATA.emplace(pblock->GetHash(), pocket_data);
+			if (!pocket_data.empty()) {
+				POCKETNET_DATA.Put(pblock->GetHash(), std::move(pocket_data));
 			}
 			//----------------------------------
             bool fNewBlock = false;
@@ -2951,17 +3062,15 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
         vRecv >> *pblock;
 
-		std::string pocket_data;
-		if (vRecv.size() > 0) {
-			vRecv >> pocket_data;
-		}
+		PocketBlockData pocket_data;
+		ReadPocketData(vRecv, pfrom, pocket_data);
 
 		std::string new_block_hash = pblock->GetHash().ToString();
         LogPrint(BCLog::NET, "received block %s peer=%d\n", pblock->GetHash().ToString(), pfrom->GetId());
 		//----------------------------
 		// Before `ProcessNewBlock` need pass pocket data
-		if (pocket_data != "") {
-			POCKETNET_DATA.emplace(pblock->GetHash(), pocket_data);
+		if (!pocket_data.empty()) {
+			POCKETNET_DATA.Put(pblock->GetHash(), std::move(pocket_data));
 		}
 		//----------------------------
         bool forceProcessing = false;
@@ -3239,6 +3348,17 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     if (pfrom->fDisconnect)
         return false;
 
+    // Transactions with finished antibot check
+    if (g_antibot_txqueue) {
+        for (auto& item : g_antibot_txqueue->TakeReady(pfrom->GetId())) {
+            try {
+                ProcessTransaction(pfrom, connman, item.tx, item.data, &item, m_enable_bip61);
+            } catch (const std::exception& e) {
+                PrintExceptionContinue(&e, "ProcessMessages()");
+            }
+        }
+    }
+
     // this maintains the order of responses
     if (!pfrom->vRecvGetData.empty()) return true;
 
@@ -3884,7 +4004,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                             vRelayExpiration.pop_front();
                         }
 
-                        auto ret = mapRelay.insert(std::make_pair(hash, std::move(txinfo.tx)));
+                        auto ret = mapRelay.insert(std::make_pair(hash, RelayTx{std::move(txinfo.tx), std::move(txinfo.pocketData)}));
                         if (ret.second) {
                             vRelayExpiration.push_back(std::make_pair(nNow + 15 * 60 * 1000000, ret.first));
                         }
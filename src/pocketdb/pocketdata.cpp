@@ -0,0 +1,254 @@
+// Copyright (c) 2018 PocketNet developers
+// PocketNET data relayed with blocks and transactions
+//-----------------------------------------------------
+#include "pocketdb/pocketdata.h"
+#include <memusage.h>
+#include <univalue.h>
+#include <util.h>
+#include <utilstrencodings.h>
+//-----------------------------------------------------
+PocketDataStore POCKETNET_DATA;
+
+static const char DB_POCKETDATA = 'p';
+//-----------------------------------------------------
+std::string EncodePocketDataLegacy(const PocketTxData& data)
+{
+    if (data.IsNull()) return "";
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("t", data.table);
+    ret.pushKV("d", EncodeBase64(data.data));
+    return ret.write();
+}
+
+std::string EncodePocketDataLegacy(const PocketBlockData& data)
+{
+    if (data.empty()) return "";
+
+    UniValue ret(UniValue::VOBJ);
+    for (const auto& it : data) {
+        ret.pushKV(it.first.GetHex(), EncodePocketDataLegacy(it.second));
+    }
+    return ret.write();
+}
+
+bool DecodePocketDataLegacy(const std::string& src, PocketTxData& data)
+{
+    UniValue _src(UniValue::VOBJ);
+    if (!_src.read(src) || !_src.isObject()) return false;
+    if (!_src["t"].isStr() || !_src["d"].isStr()) return false;
+
+    data.table = _src["t"].get_str();
+    data.data = DecodeBase64(_src["d"].get_str());
+
+    // Old nodes send items from RIMempool as is
+    if (data.table == "Mempool") {
+        UniValue _mp(UniValue::VOBJ);
+        if (!_mp.read(data.data) || !_mp["table"].isStr() || !_mp["data"].isStr()) return false;
+
+        data.table = _mp["table"].get_str();
+        data.data = DecodeBase64(_mp["data"].get_str());
+    }
+
+    return true;
+}
+
+bool DecodePocketDataLegacy(const std::string& src, PocketBlockData& data)
+{
+    UniValue _src(UniValue::VOBJ);
+    if (!_src.read(src) || !_src.isObject()) return false;
+
+    for (const auto& key : _src.getKeys()) {
+        if (!_src[key].isStr()) return false;
+
+        PocketTxData tx_data;
+        if (!DecodePocketDataLegacy(_src[key].get_str(), tx_data)) return false;
+        data.emplace(uint256S(key), tx_data);
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------
+static size_t PocketDataUsage(const PocketBlockData& data)
+{
+    size_t usage = memusage::DynamicUsage(data);
+    for (const auto& it : data) {
+        usage += memusage::MallocUsage(it.second.table.capacity());
+        usage += memusage::MallocUsage(it.second.data.capacity());
+    }
+    return usage;
+}
+
+void PocketDataStore::Init(const fs::path& path, size_t limit_bytes, size_t spill_limit_bytes)
+{
+    LOCK(cs);
+    limit = limit_bytes;
+    spill_limit = spill_limit_bytes;
+    db.reset(new CDBWrapper(path, 1 << 20, false, true));
+    evict();
+}
+
+void PocketDataStore::Close()
+{
+    LOCK(cs);
+    db.reset();
+    spilled.clear();
+    spilled_order.clear();
+    spilled_usage = 0;
+}
+
+void PocketDataStore::insert(const uint256& blockhash, std::shared_ptr<const PocketBlockData> data)
+{
+    AssertLockHeld(cs);
+
+    Entry entry;
+    entry.usage = PocketDataUsage(*data);
+    entry.data = std::move(data);
+    entry.lru = lru.insert(lru.begin(), blockhash);
+
+    memory_usage += entry.usage;
+    entries.emplace(blockhash, std::move(entry));
+}
+
+void PocketDataStore::evict()
+{
+    AssertLockHeld(cs);
+
+    // Most recent entry stays in memory even if it alone exceeds limit
+    while (memory_usage > limit && lru.size() > 1) {
+        uint256 blockhash = lru.back();
+        auto it = entries.find(blockhash);
+
+        spill(blockhash, it->second);
+
+        memory_usage -= it->second.usage;
+        entries.erase(it);
+        lru.pop_back();
+    }
+}
+
+void PocketDataStore::spill(const uint256& blockhash, const Entry& entry)
+{
+    AssertLockHeld(cs);
+
+    // Drop blocks spilled first to make room
+    while (!spilled_order.empty() && spilled_usage + entry.usage > spill_limit) {
+        uint256 oldest = spilled_order.front();
+        LogPrint(BCLog::CMPCTBLOCK, "PocketDataStore: dropped spilled data of block %s\n", oldest.GetHex());
+        unspill(oldest);
+        stats.drops++;
+    }
+
+    if (!db || entry.usage > spill_limit || !db->Write(std::make_pair(DB_POCKETDATA, blockhash), *entry.data)) {
+        LogPrintf("WARNING! PocketDataStore: dropped data of block %s\n", blockhash.GetHex());
+        stats.drops++;
+        return;
+    }
+
+    spilled.emplace(blockhash, Spilled{entry.usage, spilled_order.insert(spilled_order.end(), blockhash)});
+    spilled_usage += entry.usage;
+    stats.spills++;
+}
+
+void PocketDataStore::unspill(const uint256& blockhash)
+{
+    AssertLockHeld(cs);
+
+    auto it = spilled.find(blockhash);
+    if (it == spilled.end())
+        return;
+
+    if (db)
+        db->Erase(std::make_pair(DB_POCKETDATA, blockhash));
+
+    spilled_usage -= it->second.usage;
+    spilled_order.erase(it->second.order);
+    spilled.erase(it);
+}
+
+std::shared_ptr<const PocketBlockData> PocketDataStore::get(const uint256& blockhash)
+{
+    AssertLockHeld(cs);
+
+    auto it = entries.find(blockhash);
+    if (it != entries.end()) {
+        lru.splice(lru.begin(), lru, it->second.lru);
+        return it->second.data;
+    }
+
+    if (spilled.count(blockhash)) {
+        auto data = std::make_shared<PocketBlockData>();
+        bool read = db && db->Read(std::make_pair(DB_POCKETDATA, blockhash), *data);
+        unspill(blockhash);
+        if (read) {
+            insert(blockhash, data);
+            evict();
+            return data;
+        }
+
+        LogPrintf("WARNING! PocketDataStore: failed read spilled data of block %s\n", blockhash.GetHex());
+    }
+
+    return nullptr;
+}
+
+void PocketDataStore::remove(const uint256& blockhash)
+{
+    AssertLockHeld(cs);
+
+    auto it = entries.find(blockhash);
+    if (it != entries.end()) {
+        memory_usage -= it->second.usage;
+        lru.erase(it->second.lru);
+        entries.erase(it);
+    }
+
+    unspill(blockhash);
+}
+
+void PocketDataStore::Put(const uint256& blockhash, PocketBlockData&& data)
+{
+    LOCK(cs);
+
+    // Data requested with getblocktxn completes data received with compact block
+    if (auto staged = get(blockhash)) {
+        data.insert(staged->begin(), staged->end());
+        if (data.size() == staged->size()) return;
+        remove(blockhash);
+    }
+
+    insert(blockhash, std::make_shared<const PocketBlockData>(std::move(data)));
+    evict();
+}
+
+std::shared_ptr<const PocketBlockData> PocketDataStore::Get(const uint256& blockhash)
+{
+    LOCK(cs);
+
+    auto data = get(blockhash);
+    if (data)
+        stats.hits++;
+    else
+        stats.misses++;
+
+    return data;
+}
+
+void PocketDataStore::Erase(const uint256& blockhash)
+{
+    LOCK(cs);
+    remove(blockhash);
+}
+
+PocketDataStats PocketDataStore::GetStats()
+{
+    LOCK(cs);
+
+    PocketDataStats ret = stats;
+    ret.items = entries.size() + spilled.size();
+    ret.memory_usage = memory_usage;
+    ret.spilled_items = spilled.size();
+    ret.spilled_usage = spilled_usage;
+    return ret;
+}
@@ -0,0 +1,197 @@
+// Copyright (c) 2018 PocketNet developers
+// PocketNET data relayed with blocks and transactions
+//-----------------------------------------------------
+#ifndef POCKETDATA_H
+#define POCKETDATA_H
+//-----------------------------------------------------
+#include <dbwrapper.h>
+#include <fs.h>
+#include <hash.h>
+#include <serialize.h>
+#include <sync.h>
+#include <uint256.h>
+#include <version.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+//-----------------------------------------------------
+/*
+    PocketNET part of one transaction relayed between nodes.
+    table - reindexer namespace of item (never "Mempool")
+    data - item JSON as is, without base64
+*/
+struct PocketTxData {
+    std::string table;
+    std::string data;
+
+    bool IsNull() const { return table.empty(); }
+    // Same txid may be relayed with different payloads
+    uint256 GetHash() const { return SerializeHash(*this); }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(table);
+        READWRITE(data);
+    }
+};
+
+/*
+    PocketNET part of block transactions
+    Key - transaction hash
+*/
+typedef std::map<uint256, PocketTxData> PocketBlockData;
+
+/*
+    Legacy wire format for peers before POCKET_DATA_BINARY_VERSION:
+    tx - JSON {"t": table, "d": base64(item JSON)}
+    block - JSON object {txid: tx JSON string}
+    Decoder also unwraps "Mempool" items sent by old nodes
+*/
+std::string EncodePocketDataLegacy(const PocketTxData& data);
+std::string EncodePocketDataLegacy(const PocketBlockData& data);
+bool DecodePocketDataLegacy(const std::string& src, PocketTxData& data);
+bool DecodePocketDataLegacy(const std::string& src, PocketBlockData& data);
+
+/*
+    Pocket data appended to block and tx messages. Peers since
+    POCKET_DATA_BINARY_VERSION get the structure serialized as is,
+    older peers the legacy base64 JSON string.
+*/
+template <typename T>
+class PocketDataWire
+{
+    const T& data;
+    const bool binary;
+
+public:
+    PocketDataWire(const T& _data, int version) : data(_data), binary(version >= POCKET_DATA_BINARY_VERSION) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        if (binary)
+            s << data;
+        else
+            s << EncodePocketDataLegacy(data);
+    }
+};
+
+/*
+    Read pocket data appended to message in the form peer of version sends it.
+    Returns false and empty data if legacy string can not be decoded.
+*/
+template <typename Stream, typename T>
+bool ReadPocketDataWire(Stream& s, int version, T& data)
+{
+    if (s.size() == 0)
+        return true;
+
+    if (version >= POCKET_DATA_BINARY_VERSION) {
+        s >> data;
+        return true;
+    }
+
+    std::string legacy;
+    s >> legacy;
+    if (legacy != "" && !DecodePocketDataLegacy(legacy, data)) {
+        data = T();
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------
+// Default memory limit for staged block data in MiB
+static const int64_t DEFAULT_POCKETDATA_CACHE = 64;
+// Default limit for staged block data spilled to disk in MiB
+static const int64_t DEFAULT_POCKETDATA_SPILL = 1024;
+
+struct PocketDataStats {
+    size_t items = 0;
+    size_t memory_usage = 0;
+    size_t spilled_items = 0;
+    size_t spilled_usage = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t spills = 0;
+    uint64_t drops = 0;
+};
+
+/*
+    Staging store for PocketNET data received with blocks.
+    Data lives here from receiving a block until it is connected.
+    Compact blocks may carry data only of part of transactions,
+    rest is found in RIMempool or arrives later with blocktxn.
+    Memory usage is limited - least recently used blocks
+    are spilled to disk and loaded back on request.
+    Spilled data is limited too - blocks spilled first are
+    dropped, they are the oldest and most likely never
+    connected. Spill database is wiped on every start.
+*/
+class PocketDataStore
+{
+private:
+    struct Entry {
+        std::shared_ptr<const PocketBlockData> data;
+        size_t usage;
+        std::list<uint256>::iterator lru;
+    };
+
+    struct Hasher {
+        size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+    };
+
+    struct Spilled {
+        size_t usage;
+        std::list<uint256>::iterator order;
+    };
+
+    CCriticalSection cs;
+    std::unordered_map<uint256, Entry, Hasher> entries;
+    // Most recently used first
+    std::list<uint256> lru;
+    std::unordered_map<uint256, Spilled, Hasher> spilled;
+    // First spilled first
+    std::list<uint256> spilled_order;
+    size_t memory_usage = 0;
+    size_t spilled_usage = 0;
+    size_t limit = DEFAULT_POCKETDATA_CACHE << 20;
+    size_t spill_limit = DEFAULT_POCKETDATA_SPILL << 20;
+    std::unique_ptr<CDBWrapper> db;
+    PocketDataStats stats;
+
+    void insert(const uint256& blockhash, std::shared_ptr<const PocketBlockData> data);
+    void evict();
+    void spill(const uint256& blockhash, const Entry& entry);
+    void unspill(const uint256& blockhash);
+    std::shared_ptr<const PocketBlockData> get(const uint256& blockhash);
+    void remove(const uint256& blockhash);
+
+public:
+    /* Open spill database and set memory and disk limits in bytes */
+    void Init(const fs::path& path, size_t limit_bytes, size_t spill_limit_bytes);
+    void Close();
+
+    /* Stage data of block. Data already staged for this block is kept and completed with new transactions */
+    void Put(const uint256& blockhash, PocketBlockData&& data);
+    /* Staged data of block or nullptr */
+    std::shared_ptr<const PocketBlockData> Get(const uint256& blockhash);
+    void Erase(const uint256& blockhash);
+
+    PocketDataStats GetStats();
+};
+
+/*
+    Temp storage for PocketNET data, received by another nodes
+    Key - block hash
+*/
+extern PocketDataStore POCKETNET_DATA;
+//-----------------------------------------------------
+#endif // POCKETDATA_H
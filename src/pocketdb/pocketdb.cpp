@@ -4,13 +4,14 @@
 #include "pocketdb/pocketdb.h"
 #include "html.h"
 #include "tools/logger.h"
+#include <shutdown.h>
+#include <ui_interface.h>
 
 #if defined(HAVE_CONFIG_H)
 #include <config/pocketcoin-config.h>
 #endif //HAVE_CONFIG_H
 //-----------------------------------------------------
 std::unique_ptr<PocketDB> g_pocketdb;
-std::map<uint256, std::string> POCKETNET_DATA;
 //-----------------------------------------------------
 PocketDB::PocketDB()
 {
@@ -45,6 +46,7 @@ void PocketDB::CloseNamespaces()
     db->CloseNamespace("Addresses");
     db->CloseNamespace("Comments");
     db->CloseNamespace("Comment");
+    db->CloseNamespace("BlockUndo");
 }
 
 // Check for update DB
@@ -58,6 +60,9 @@ bool PocketDB::UpdateDB()
 
     // Need to update?
     if (db_version < cur_version) {
+        // Convert data in place if every version has migration step
+        if (CanMigrate(db_version)) return Migrate(db_version);
+
         LogPrintf("Update RDB structure from v%s to v%s. Blockchain data will be erased and uploaded again.\n", db_version, cur_version);
 
         CloseNamespaces();
@@ -75,6 +80,115 @@ bool PocketDB::UpdateDB()
     return true;
 }
 
+const std::vector<PocketDB::Migration>& PocketDB::Migrations()
+{
+    // Add step {cur_version, "description", &PocketDB::Step} with every schema change
+    static const std::vector<Migration> migrations = {};
+
+    return migrations;
+}
+
+bool PocketDB::CanMigrate(int db_version)
+{
+    // Empty or unknown DB - nothing to convert
+    if (db_version <= 0) return false;
+
+    for (int version = db_version + 1; version <= cur_version; version++) {
+        auto& migrations = Migrations();
+        if (std::find_if(migrations.begin(), migrations.end(), [&](const Migration& m) { return m.version == version; }) == migrations.end())
+            return false;
+    }
+
+    return true;
+}
+
+bool PocketDB::Migrate(int db_version)
+{
+    for (const Migration& migration : Migrations()) {
+        if (migration.version <= db_version || migration.version > cur_version) continue;
+
+        LogPrintf("Migrate RDB from v%d to v%d: %s\n", migration.version - 1, migration.version, migration.description);
+        int64_t nStart = GetTimeMillis();
+
+        if (!(this->*migration.apply)()) {
+            LogPrintf("Failed migrate RDB to v%d: %s\n", migration.version, migration.description);
+            return false;
+        }
+
+        SaveVersion(migration.version);
+        LogPrintf("Migrated RDB to v%d in %dms\n", migration.version, GetTimeMillis() - nStart);
+    }
+
+    return true;
+}
+
+void PocketDB::SaveVersion(int version)
+{
+    Item service_new_item = db->NewItem("Service");
+    service_new_item["version"] = version;
+    UpsertWithCommit("Service", service_new_item);
+}
+
+bool PocketDB::MigrateRows(const std::string& description, const std::string& table, std::function<bool(Item&)> fn)
+{
+    size_t total = SelectTotalCount(table);
+    size_t done = 0;
+
+    while (done < total) {
+        if (ShutdownRequested()) return false;
+
+        // Source table is not changed by steps, so offsets are stable
+        QueryResults res;
+        Error err = db->Select(Query(table, done, POCKETDB_MIGRATION_BATCH), res);
+        if (!err.ok()) {
+            LogPrintf("Migrate RDB: select %s failed - %s\n", table, err.what());
+            return false;
+        }
+        if (res.Count() == 0) break;
+
+        for (auto& it : res) {
+            Item itm(it.GetItem());
+            if (!fn(itm)) return false;
+        }
+
+        done += res.Count();
+        LogPrintf("Migrate RDB: %s %d/%d\n", description, done, total);
+        uiInterface.InitMessage(strprintf(_("Migrating Reindexer DB: %s (%d%%)..."), description, done * 100 / total));
+    }
+
+    return true;
+}
+
+bool PocketDB::MigrateViews()
+{
+    // Last state of every key is written again, so views are dropped first
+    // and step is safe to repeat after interruption
+    if (!DropTable("UsersView") || !DropTable("SubscribesView") || !DropTable("BlockingView")) return false;
+
+    std::set<std::string> users;
+    bool ok = MigrateRows("UsersView", "Users", [&](Item& itm) {
+        std::string address = itm["address"].As<string>();
+        if (!users.insert(address).second) return true;
+        return UpdateUsersView(address, std::numeric_limits<int>::max()).ok();
+    });
+    if (!ok) return false;
+
+    std::set<std::pair<std::string, std::string>> subscribes;
+    ok = MigrateRows("SubscribesView", "Subscribes", [&](Item& itm) {
+        auto key = std::make_pair(itm["address"].As<string>(), itm["address_to"].As<string>());
+        if (!subscribes.insert(key).second) return true;
+        return UpdateSubscribesView(key.first, key.second).ok();
+    });
+    if (!ok) return false;
+
+    std::set<std::pair<std::string, std::string>> blockings;
+    return MigrateRows("BlockingView", "Blocking", [&](Item& itm) {
+        auto key = std::make_pair(itm["address"].As<string>(), itm["address_to"].As<string>());
+        if (!blockings.insert(key).second) return true;
+        return UpdateBlockingView(key.first, key.second).ok();
+    });
+}
+
 bool PocketDB::ConnectDB()
 {
     db = new Reindexer();
@@ -102,9 +216,7 @@ bool PocketDB::Init()
     LogPrintf("Loaded Reindexer DB (%s)\n", (GetDataDir() / "pocketdb").string());
 
     // Save current version
-    Item service_new_item = db->NewItem("Service");
-    service_new_item["version"] = cur_version;
-    UpsertWithCommit("Service", service_new_item);
+    SaveVersion(cur_version);
 
     // Turn on/off statistic
     // Item conf_item = db->NewItem("#config");
@@ -414,11 +526,32 @@ bool PocketDB::InitDB(std::string table)
         db->Commit("Ratings");
     }
 
+    // Rollback journals of last blocks
+    if (table == "BlockUndo" || table == "ALL") {
+        db->OpenNamespace("BlockUndo", StorageOpts().Enabled().CreateIfMissing());
+        db->AddIndex("BlockUndo", {"block", "tree", "int", IndexOpts().PK()});
+        db->AddIndex("BlockUndo", {"data", "-", "string", IndexOpts()});
+        db->Commit("BlockUndo");
+    }
+
     return true;
 }
 
 bool PocketDB::DropTable(std::string table)
 {
+    if (table == "UTXO") {
+        LOCK(cs_balance);
+        balance_cache.clear();
+        balance_lru.clear();
+    }
+
+    if (table == "UserRatings" || table == "Ratings") {
+        LOCK(cs_ratings);
+        ratings_generation += 1;
+        reputation_cache.Clear();
+        likers_cache.Clear();
+    }
+
     Error err = db->DropNamespace(table);
     if (!err.ok()) LogPrintf("Drop namespace(%s) %s\n", table, err.what());
 
@@ -939,21 +1072,147 @@ Error PocketDB::RestoreLastItem(std::string table, std::string txid, std::string
 }
 
 
+// Maximum addresses kept in balances cache
+static const size_t BALANCE_CACHE_MAX_SIZE = 500000;
+
+AddressBalance* PocketDB::getAddressBalance(const std::string& address)
+{
+    AssertLockHeld(cs_balance);
+
+    auto it = balance_cache.find(address);
+    if (it != balance_cache.end()) {
+        balance_lru.splice(balance_lru.begin(), balance_lru, it->second.lru);
+        return &it->second.balance;
+    }
+
+    QueryResults res;
+    if (!db->Select(Query("UTXO").Where("address", CondEq, address).Where("spent_block", CondEq, 0), res).ok())
+        return nullptr;
+
+    AddressBalance balance;
+    for (auto& r : res) {
+        Item itm(r.GetItem());
+        int64_t amount = itm["amount"].As<int64_t>();
+        balance.blocks[itm["block"].As<int>()] += amount;
+        balance.total += amount;
+    }
+
+    if (balance_cache.size() >= BALANCE_CACHE_MAX_SIZE) {
+        balance_cache.erase(balance_lru.back());
+        balance_lru.pop_back();
+    }
+
+    balance_lru.push_front(address);
+    BalanceCacheEntry& entry = balance_cache[address];
+    entry.balance = std::move(balance);
+    entry.lru = balance_lru.begin();
+    return &entry.balance;
+}
+
+void PocketDB::addAddressBalance(const std::string& address, int block, int64_t amount)
+{
+    AssertLockHeld(cs_balance);
+
+    // Not loaded addresses will be read from UTXO on first request
+    auto it = balance_cache.find(address);
+    if (it == balance_cache.end()) return;
+
+    AddressBalance& balance = it->second.balance;
+    balance.total += amount;
+    if ((balance.blocks[block] += amount) == 0) balance.blocks.erase(block);
+}
+
 int64_t PocketDB::GetUserBalance(std::string _address, int height)
 {
-    AggregationResult aggRes;
-    if (SelectAggr(
-            Query("UTXO")
-                .Where("address", CondEq, _address)
-                .Where("block", CondLt, height)
-                .Where("spent_block", CondEq, 0)
-                .Aggregate("amount", AggSum),
-            "amount", aggRes)
-            .ok()) {
-        return (int64_t)aggRes.value;
-    } else {
-        return 0;
+    LOCK(cs_balance);
+    AddressBalance* pbalance = getAddressBalance(_address);
+    if (!pbalance) return 0;
+    const AddressBalance& balance = *pbalance;
+
+    // Usually called for the next block - all unspent outputs match
+    if (balance.blocks.empty() || balance.blocks.rbegin()->first < height) return balance.total;
+
+    int64_t sum = 0;
+    for (auto it = balance.blocks.begin(); it != balance.blocks.end() && it->first < height; it++)
+        sum += it->second;
+
+    return sum;
+}
+
+Error PocketDB::AddUTXO(Item& item)
+{
+    LOCK(cs_balance);
+
+    // Output written again (replay or reconnect) replaces its old row
+    QueryResults res;
+    Error err = db->Select(Query("UTXO", 0, 1).WhereComposite("txid+txout", CondEq, {{Variant(item["txid"].As<string>()), Variant(item["txout"].As<int>())}}), res);
+    if (!err.ok()) return err;
+
+    err = UpsertWithCommit("UTXO", item);
+    if (!err.ok()) return err;
+
+    if (res.Count() > 0) {
+        Item prev = res[0].GetItem();
+        if (prev["spent_block"].As<int>() == 0)
+            addAddressBalance(prev["address"].As<string>(), prev["block"].As<int>(), -prev["amount"].As<int64_t>());
+    }
+
+    if (item["spent_block"].As<int>() == 0)
+        addAddressBalance(item["address"].As<string>(), item["block"].As<int>(), item["amount"].As<int64_t>());
+
+    return err;
+}
+
+Error PocketDB::SpendUTXO(std::string txid, int txout, int height)
+{
+    LOCK(cs_balance);
+    QueryResults res;
+    Error err = db->Select(Query("UTXO", 0, 1).WhereComposite("txid+txout", CondEq, {{Variant(txid), Variant(txout)}}), res);
+    if (!err.ok() || res.Count() == 0) return Error(errOK);
+
+    Item item = res[0].GetItem();
+    int spent_block = item["spent_block"].As<int>();
+    if (spent_block == height) return Error(errOK);
+
+    item["spent_block"] = height;
+    err = UpsertWithCommit("UTXO", item);
+
+    // Output spent again (replay or reconnect) is already out of balance
+    if (err.ok() && spent_block == 0)
+        addAddressBalance(item["address"].As<string>(), item["block"].As<int>(), -item["amount"].As<int64_t>());
+
+    return err;
+}
+
+Error PocketDB::RollbackUTXO(int height)
+{
+    LOCK(cs_balance);
+
+    Error err = DeleteWithCommit(Query("UTXO").Where("block", CondGt, height));
+    if (!err.ok()) return err;
+
+    // Outputs above height are gone - drop them from loaded balances
+    for (auto& bc : balance_cache) {
+        AddressBalance& balance = bc.second.balance;
+        for (auto it = balance.blocks.upper_bound(height); it != balance.blocks.end();) {
+            balance.total -= it->second;
+            it = balance.blocks.erase(it);
+        }
     }
+
+    QueryResults res;
+    if (!db->Select(Query("UTXO").Where("spent_block", CondGt, height), res).ok()) return Error(errOK);
+
+    for (auto& it : res) {
+        Item item = it.GetItem();
+        item["spent_block"] = 0;
+        err = UpsertWithCommit("UTXO", item);
+        if (!err.ok()) return err;
+
+        addAddressBalance(item["address"].As<string>(), item["block"].As<int>(), item["amount"].As<int64_t>());
+    }
+
+    return Error(errOK);
 }
 
 std::tuple<int, int> PocketDB::GetUserData(std::string address)
@@ -965,12 +1224,53 @@ std::tuple<int, int> PocketDB::GetUserData(std::string address)
     return std::make_tuple(-1, -1);
 }
 
+void PocketDB::pushRatingHistory(RatingHistory& history, int height, int value)
+{
+    // Row with same block replaced by upsert
+    if (!history.items.empty() && history.items.back().first == height) {
+        history.items.back().second = value;
+        return;
+    }
+
+    history.items.emplace_back(height, value);
+    if (history.items.size() > RATING_HISTORY_SIZE) {
+        history.items.pop_front();
+        history.complete = false;
+    }
+}
+
 int PocketDB::GetUserReputation(std::string _address, int height)
 {
     // Set to default if rating for user not found
     int rep = 0;
 
-    // Sorting by block desc - last accumulating rating
+    uint64_t generation;
+    {
+        LOCK(cs_ratings);
+        RatingHistory* history = reputation_cache.Get(_address);
+        if (history && history->Get(height, rep)) return rep;
+        generation = ratings_generation;
+    }
+
+    // Sorting by block desc - last accumulating ratings
+    QueryResults res;
+    if (!db->Select(Query("UserRatings", 0, RATING_HISTORY_SIZE).Where("address", CondEq, _address).Sort("block", true), res).ok()) return rep;
+
+    RatingHistory history;
+    history.complete = res.Count() < RATING_HISTORY_SIZE;
+    for (auto& r : res) {
+        Item itm(r.GetItem());
+        history.items.emplace_front(itm["block"].As<int>(), itm["reputation"].As<int>());
+    }
+
+    {
+        LOCK(cs_ratings);
+        if (generation == ratings_generation) reputation_cache.Put(_address, history);
+    }
+
+    if (history.Get(height, rep)) return rep;
+
+    // Requested height older than cached history
     Item _itm_rating;
     if (SelectOne(
             Query("UserRatings")
@@ -987,6 +1287,36 @@ int PocketDB::GetUserReputation(std::string _address, int height)
 
 int PocketDB::GetUserLikersCount(int userId, int height)
 {
+    int count = 0;
+
+    uint64_t generation;
+    {
+        LOCK(cs_ratings);
+        RatingHistory* history = likers_cache.Get(userId);
+        if (history && history->Get(height, count)) return count;
+        generation = ratings_generation;
+    }
+
+    // Last likers rows by block desc with total count - row of every block counts one
+    QueryResults res;
+    if (!db->Select(Query("Ratings", 0, RATING_HISTORY_SIZE).Where("type", CondEq, (int)RatingType::RatingUserLikers).Where("key", CondEq, userId).Sort("block", true).ReqTotal(), res).ok()) return 0;
+
+    RatingHistory history;
+    history.complete = res.Count() < RATING_HISTORY_SIZE;
+    int total = (int)res.TotalCount();
+    for (auto& r : res) {
+        Item itm(r.GetItem());
+        history.items.emplace_front(itm["block"].As<int>(), total--);
+    }
+
+    {
+        LOCK(cs_ratings);
+        if (generation == ratings_generation) likers_cache.Put(userId, history);
+    }
+
+    if (history.Get(height, count)) return count;
+
+    // Requested height older than cached history
     return SelectCount(
         Query("Ratings")
             .Where("type", CondEq, (int)RatingType::RatingUserLikers)
@@ -1003,6 +1333,61 @@ bool PocketDB::ExistsUserLiker(int userId, int likerId, int height)
             .Where("value", CondEq, likerId));
 }
 
+Error PocketDB::SetUserRating(std::string address, int height, int rep)
+{
+    LOCK(cs_ratings);
+
+    Item itm = db->NewItem("UserRatings");
+    itm["address"] = address;
+    itm["block"] = height;
+    itm["reputation"] = rep;
+
+    Error err = UpsertWithCommit("UserRatings", itm);
+    if (!err.ok()) return err;
+
+    ratings_generation += 1;
+    RatingHistory* history = reputation_cache.Peek(address);
+    if (history) pushRatingHistory(*history, height, rep);
+
+    return err;
+}
+
+Error PocketDB::AddUserLiker(int userId, int likerId, int height)
+{
+    LOCK(cs_ratings);
+
+    // Ratings PK is type+block+key - one row for all likers of user in block
+    bool exists = Exists(Query("Ratings").Where("type", CondEq, (int)RatingType::RatingUserLikers).Where("block", CondEq, height).Where("key", CondEq, userId));
+
+    Item itm = db->NewItem("Ratings");
+    itm["type"] = RatingType::RatingUserLikers;
+    itm["block"] = height;
+    itm["key"] = userId;
+    itm["value"] = likerId;
+
+    Error err = UpsertWithCommit("Ratings", itm);
+    if (err.ok()) ratings_generation += 1;
+    if (!err.ok() || exists) return err;
+
+    RatingHistory* history = likers_cache.Peek(userId);
+    if (history) {
+        if (history->items.empty() && !history->complete)
+            likers_cache.Erase(userId);
+        else
+            pushRatingHistory(*history, height, (history->items.empty() ? 0 : history->items.back().second) + 1);
+    }
+
+    return err;
+}
+
+void PocketDB::RollbackRatingsCache(int height)
+{
+    LOCK(cs_ratings);
+    ratings_generation += 1;
+    reputation_cache.Truncate(height);
+    likers_cache.Truncate(height);
+}
+
 bool PocketDB::SetUserReputation(std::string address, int rep)
 {
     reindexer::QueryResults userViewRes;
@@ -8,11 +8,15 @@
 #include "core/namespacedef.h"
 #include "core/reindexer.h"
 #include "core/type_consts.h"
+#include "pocketdb/pocketdata.h"
 #include "tools/errors.h"
 #include "util.h"
 #include <crypto/sha256.h>
+#include <deque>
 #include <uint256.h>
 #include <univalue.h>
+#include <list>
+#include <unordered_map>
 #include <utilstrencodings.h>
 //-----------------------------------------------------
 using namespace reindexer;
@@ -42,6 +46,130 @@ enum ContentType {
     ContentTranslate = 5,
 };
 
+//-----------------------------------------------------
+// Unspent amounts of one address grouped by UTXO block
+struct AddressBalance {
+    int64_t total = 0;
+    std::map<int, int64_t> blocks;
+};
+
+//-----------------------------------------------------
+// Last accumulated values of one rating by block height
+struct RatingHistory {
+    // <block, value> ordered by block
+    std::deque<std::pair<int, int>> items;
+    // Items contain all rows - empty lookup means zero
+    bool complete = false;
+
+    bool Get(int height, int& value) const
+    {
+        for (auto it = items.rbegin(); it != items.rend(); it++) {
+            if (it->first <= height) {
+                value = it->second;
+                return true;
+            }
+        }
+
+        if (!complete) return false;
+        value = 0;
+        return true;
+    }
+};
+
+//-----------------------------------------------------
+// Rating histories by key, least recently requested keys evicted first
+template <typename K>
+class RatingHistoryCache {
+private:
+    struct Entry {
+        RatingHistory history;
+        typename std::list<K>::iterator lru;
+    };
+    std::unordered_map<K, Entry> entries;
+    // Keys by last request, most recent first
+    std::list<K> lru;
+    size_t max_size;
+
+public:
+    explicit RatingHistoryCache(size_t max_size) : max_size(max_size) {}
+
+    // Loaded history of key, moved to front. nullptr if not loaded
+    RatingHistory* Get(const K& key)
+    {
+        auto it = entries.find(key);
+        if (it == entries.end()) return nullptr;
+        lru.splice(lru.begin(), lru, it->second.lru);
+        return &it->second.history;
+    }
+
+    // Loaded history of key without changing order - for writes
+    RatingHistory* Peek(const K& key)
+    {
+        auto it = entries.find(key);
+        return it == entries.end() ? nullptr : &it->second.history;
+    }
+
+    void Put(const K& key, RatingHistory history)
+    {
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            it->second.history = std::move(history);
+            lru.splice(lru.begin(), lru, it->second.lru);
+            return;
+        }
+
+        if (entries.size() >= max_size) {
+            entries.erase(lru.back());
+            lru.pop_back();
+        }
+
+        lru.push_front(key);
+        Entry& entry = entries[key];
+        entry.history = std::move(history);
+        entry.lru = lru.begin();
+    }
+
+    void Erase(const K& key)
+    {
+        auto it = entries.find(key);
+        if (it == entries.end()) return;
+        lru.erase(it->second.lru);
+        entries.erase(it);
+    }
+
+    // Drop rows above height, histories left without rows are reloaded on next request
+    void Truncate(int height)
+    {
+        for (auto it = entries.begin(); it != entries.end();) {
+            auto& items = it->second.history.items;
+            while (!items.empty() && items.back().first > height)
+                items.pop_back();
+
+            if (items.empty() && !it->second.history.complete) {
+                lru.erase(it->second.lru);
+                it = entries.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    void Clear()
+    {
+        entries.clear();
+        lru.clear();
+    }
+
+    size_t Size() const { return entries.size(); }
+};
+
+//-----------------------------------------------------
+// Rating rows kept per key in reputation and likers caches
+static const size_t RATING_HISTORY_SIZE = 16;
+// Maximum keys kept in reputation and likers caches
+static const size_t RATING_CACHE_MAX_SIZE = 500000;
+// Rows converted between commits while migrating DB in place
+static const int POCKETDB_MIGRATION_BATCH = 10000;
 //-----------------------------------------------------
 class PocketDB {
 private:
@@ -49,6 +177,53 @@ private:
 
     int cur_version = 2;
 
+    /*
+        In-place migration step from version-1 to version.
+        New indexes are declared in InitDB and built on open,
+        so steps only convert data of existing namespaces.
+        Version in Service is saved after every step - interrupted
+        migration continues from last finished step on next start.
+    */
+    struct Migration {
+        int version;
+        std::string description;
+        bool (PocketDB::*apply)();
+    };
+    static const std::vector<Migration>& Migrations();
+    bool CanMigrate(int db_version);
+    bool Migrate(int db_version);
+    void SaveVersion(int version);
+    // Pass all rows of table to fn in batches of POCKETDB_MIGRATION_BATCH with progress reporting
+    bool MigrateRows(const std::string& description, const std::string& table, std::function<bool(Item&)> fn);
+    // Rebuild UsersView, SubscribesView and BlockingView from history tables - for steps changing views
+    bool MigrateViews();
+
+    // In-memory balances over UTXO, loaded lazily per address.
+    // All UTXO writes go through this class under cs_balance
+    // so the cache always matches the namespace.
+    // Least recently requested addresses are evicted first.
+    struct BalanceCacheEntry {
+        AddressBalance balance;
+        std::list<std::string>::iterator lru;
+    };
+    CCriticalSection cs_balance;
+    std::unordered_map<std::string, BalanceCacheEntry> balance_cache;
+    // Addresses by last request, most recent first
+    std::list<std::string> balance_lru;
+    // Loaded balance of address, nullptr if UTXO select failed
+    AddressBalance* getAddressBalance(const std::string& address);
+    void addAddressBalance(const std::string& address, int block, int64_t amount);
+
+    // Reputation and likers history caches, loaded lazily.
+    // Rows are written through SetUserRating/AddUserLiker.
+    // Selects run without cs_ratings, loaded history is cached
+    // only if no rows were written meanwhile (ratings_generation)
+    CCriticalSection cs_ratings;
+    RatingHistoryCache<std::string> reputation_cache{RATING_CACHE_MAX_SIZE};
+    RatingHistoryCache<int> likers_cache{RATING_CACHE_MAX_SIZE};
+    uint64_t ratings_generation = 0;
+    void pushRatingHistory(RatingHistory& history, int height, int value);
+
     void CloseNamespaces();
     bool UpdateDB();
     bool ConnectDB();
@@ -106,6 +281,12 @@ public:
     int GetUserReputation(std::string _address, int height);
     int GetUserLikersCount(int userId, int height);
     bool ExistsUserLiker(int userId, int likerId, int height);
+    // Write accumulated reputation of user for block
+    Error SetUserRating(std::string address, int height, int rep);
+    // Write new distinct liker of user for block
+    Error AddUserLiker(int userId, int likerId, int height);
+    // Forget cached ratings above height
+    void RollbackRatingsCache(int height);
 
     // Post
     bool UpdatePostRating(std::string posttxid, int sum, int cnt, int& rep);
@@ -119,6 +300,12 @@ public:
 
     // Returns sum of all unspent transactions for address
     int64_t GetUserBalance(std::string _address, int height);
+    // Write new UTXO item
+    Error AddUTXO(Item& item);
+    // Mark UTXO txid:txout as spent in block
+    Error SpendUTXO(std::string txid, int txout, int height);
+    // Remove UTXO created above height and unspend UTXO spent above height
+    Error RollbackUTXO(int height);
     std::tuple<int, int> GetUserData(std::string address);
 
     // Search tags in DB
@@ -136,11 +323,5 @@ public:
 //-----------------------------------------------------
 extern std::unique_ptr<PocketDB> g_pocketdb;
 
-/*
-    Temp dictionary for PocketNET data, received by another nodes
-    Key - block hash
-    Value - JSON string (UniValue)
-*/
-extern std::map<uint256, std::string> POCKETNET_DATA;
 //-----------------------------------------------------
 #endif // POCKETDB_H
\ No newline at end of file
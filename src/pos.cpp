@@ -9,6 +9,7 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <consensus/validation.h>
+#include <index/addrindex.h>
 #include <pocketdb/pocketnet.h>
 #include <pos.h>
 #include <pow.h>
@@ -231,6 +232,18 @@ bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, int64_t nTime, con
         prevout, nTime, hashProofOfStake, hashProofOfStakeSource, targetProofOfStake);
 }
 
+bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, int64_t nTime, CBlockIndex* pindexFrom, CTransactionRef const& txPrev, const COutPoint& prevout, CDataStream& hashProofOfStakeSource)
+{
+    // Violations are expected while searching, skip them without logging
+    if (pindexFrom->GetBlockTime() + Params().GetConsensus().nStakeMinAge > nTime || nTime < txPrev->nTime) {
+        return false;
+    }
+
+    arith_uint256 hashProofOfStake, targetProofOfStake;
+    return CheckStakeKernelHash(pindexPrev, nBits, *pindexFrom, txPrev,
+        prevout, nTime, hashProofOfStake, hashProofOfStakeSource, targetProofOfStake);
+}
+
 bool CheckStakeKernelHash(CBlockIndex* pindexPrev, unsigned int nBits, CBlockIndex& blockFrom, CTransactionRef const& txPrev, COutPoint const& prevout, unsigned int nTimeTx, arith_uint256& hashProofOfStake, CDataStream& hashProofOfStakeSource, arith_uint256& targetProofOfStake, bool fPrintProofOfStake)
 {
     unsigned int nTimeBlockFrom = blockFrom.GetBlockTime();
@@ -515,181 +528,51 @@ bool TransactionGetCoinAge(CTransactionRef transaction, uint64_t& nCoinAge)
     return true;
 }
 
-bool GetRatingRewards(CAmount nCredit, std::vector<CTxOut>& results, CAmount& totalAmount, const CBlockIndex* pindexPrev, CDataStream& hashProofOfStakeSource, std::vector<opcodetype>& winner_types, const CBlock* block)
+void SelectLotteryWinners(const std::map<std::string, int>& ratings, const CDataStream& hashProofOfStakeSource, std::vector<std::string>& winners)
 {
-    const int RATINGS_PAYOUT_MAX = 25;
-    int height = pindexPrev->nHeight;
+    const size_t RATINGS_PAYOUT_MAX = 25;
 
-    std::vector<std::string> vLotteryPost;
-    std::vector<std::string> vLotteryComment;
+    std::vector<std::pair<std::string, std::pair<int, arith_uint256>>> allSorted;
+    for (auto& it : ratings) {
+        CDataStream ss(hashProofOfStakeSource);
+        ss << it.first;
+        arith_uint256 hashSortRating = UintToArith256(Hash(ss.begin(), ss.end())) / it.second;
+        allSorted.push_back(std::make_pair(it.first, std::make_pair(it.second, hashSortRating)));
+    }
 
-    std::map<std::string, std::string> mLotteryPostRef;
-    std::map<std::string, std::string> mLotteryCommentRef;
-
-    std::map<std::string, int> allPostRatings;
-    std::map<std::string, int> allCommentRatings;
-
-    CBlock blockPrev;
-    ReadBlockFromDisk(blockPrev, pindexPrev, Params().GetConsensus());
-
-    int64_t _lottery_referral_depth = GetActualLimit(Limit::lottery_referral_depth, height);
-
-    // Get all users from prev block for current lottery
-    for (const auto& tx : blockPrev.vtx) {
-        std::vector<std::string> vasm;
-        if (!FindPocketNetAsmString(tx, vasm)) continue;
-        if ((vasm[1] == OR_SCORE || vasm[1] == OR_COMMENT_SCORE) && vasm.size() >= 4) {
-            std::vector<unsigned char> _data_hex = ParseHex(vasm[3]);
-            std::string _data_str(_data_hex.begin(), _data_hex.end());
-            std::vector<std::string> _data;
-            boost::split(_data, _data_str, boost::is_any_of("\t "));
-            if (_data.size() >= 2) {
-                std::string _address = _data[0];
-                int _value = std::stoi(_data[1]);
-
-                // For lottery use scores as 4=1 and 5=2 - Scores to posts
-                if (vasm[1] == OR_SCORE && (_value == 4 || _value == 5)) {
-                    std::string _score_address;
-                    std::string _post_address;
-
-                    // Get address of score initiator
-                    reindexer::Item _score_itm;
-                    if (g_pocketdb->SelectOne(reindexer::Query("Scores").Where("txid", CondEq, tx->GetHash().GetHex()), _score_itm).ok())
-                        _score_address = _score_itm["address"].As<string>();
-
-                    reindexer::Item _post_itm;
-                    if (g_pocketdb->SelectOne(reindexer::Query("Posts").Where("txid", CondEq, _score_itm["posttxid"].As<string>()), _post_itm).ok())
-                        _post_address = _post_itm["address"].As<string>();
-
-                    if (_score_address.empty() || _post_address.empty()) {
-                        LogPrintf("GetRatingRewards error: _score_address='%s' _post_address='%s'\n", _score_address, _post_address);
-                        continue;
-                    }
-
-                    if (_address == _post_address && g_antibot->AllowModifyReputationOverPost(_score_address, _post_address, height, tx, true)) {
-                        if (allPostRatings.find(_post_address) == allPostRatings.end()) allPostRatings.insert(std::make_pair(_post_address, 0));
-                        allPostRatings[_post_address] += (_value - 3);
-
-                        // Find winners with referral program
-                        if (height >= Params().GetConsensus().lottery_referral_beg) {
-                            reindexer::Item _referrer_itm;
-
-                            reindexer::Query _referrer_query = reindexer::Query("UsersView").Where("address", CondEq, _post_address).Not().Where("referrer", CondEq, "").Not().Where("referrer", CondEq, _score_address);
-                            if (height >= Params().GetConsensus().lottery_referral_limitation) {
-                                _referrer_query.Where("regdate", CondGe, (int64_t)tx->nTime - _lottery_referral_depth);
-                            }
-
-                            if (g_pocketdb->SelectOne(_referrer_query, _referrer_itm).ok()) {
-                                if (mLotteryPostRef.find(_post_address) == mLotteryPostRef.end()) {
-                                    auto _referrer_address = _referrer_itm["referrer"].As<string>();
-                                    mLotteryPostRef.emplace(_post_address, _referrer_address);
-                                }
-                            }
-                        }
-                    }
-                }
-
-                // For lottery use scores as 1 and -1 - Scores to comments
-                if (vasm[1] == OR_COMMENT_SCORE && (_value == 1)) {
-                    std::string _score_address;
-                    std::string _comment_address;
-
-                    // Get address of score initiator
-                    reindexer::Item _score_itm;
-                    if (g_pocketdb->SelectOne(reindexer::Query("CommentScores").Where("txid", CondEq, tx->GetHash().GetHex()), _score_itm).ok())
-                        _score_address = _score_itm["address"].As<string>();
-
-                    reindexer::Item _comment_itm;
-                    if (g_pocketdb->SelectOne(reindexer::Query("Comment").Where("txid", CondEq, _score_itm["commentid"].As<string>()), _comment_itm).ok())
-                        _comment_address = _comment_itm["address"].As<string>();
-
-                    if (_score_address.empty() || _comment_address.empty()) {
-                        LogPrintf("GetRatingRewards error: _score_address='%s' _comment_address='%s'\n", _score_address, _comment_address);
-                        continue;
-                    }
-
-                    if (_address == _comment_address && g_antibot->AllowModifyReputationOverComment(_score_address, _comment_address, height, tx, true)) {
-                        if (allCommentRatings.find(_comment_address) == allCommentRatings.end()) allCommentRatings.insert(std::make_pair(_comment_address, 0));
-                        allCommentRatings[_comment_address] += _value;
-
-                        // Find winners with referral program
-                        if (height >= Params().GetConsensus().lottery_referral_beg) {
-                            reindexer::Item _referrer_itm;
-
-                            reindexer::Query _referrer_query = reindexer::Query("UsersView").Where("address", CondEq, _comment_address).Not().Where("referrer", CondEq, "").Not().Where("referrer", CondEq, _score_address);
-                            if (height >= Params().GetConsensus().lottery_referral_limitation) {
-                                _referrer_query.Where("regdate", CondGe, (int64_t)tx->nTime - _lottery_referral_depth);
-                            }
-
-                            if (g_pocketdb->SelectOne(_referrer_query, _referrer_itm).ok()) {
-                                if (mLotteryCommentRef.find(_comment_address) == mLotteryCommentRef.end()) {
-                                    auto _referrer_address = _referrer_itm["referrer"].As<string>();
-                                    mLotteryCommentRef.emplace(_comment_address, _referrer_address);
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
+    // Shrink founded users
+    std::sort(allSorted.begin(), allSorted.end(), [](auto & a, auto & b) {
+        return a.second.second < b.second.second;
+    });
+
+    if (allSorted.size() > RATINGS_PAYOUT_MAX) {
+        allSorted.resize(RATINGS_PAYOUT_MAX);
     }
 
-    // Sort founded users
-    {
-        std::vector<std::pair<std::string, std::pair<int, arith_uint256>>> allPostSorted;
-        std::vector<std::pair<std::string, std::pair<int, arith_uint256>>> allCommentSorted;
-
-        {
-            // Users with scores by post
-            for (auto& it : allPostRatings) {
-                CDataStream ss(hashProofOfStakeSource);
-                ss << it.first;
-                arith_uint256 hashSortRating = UintToArith256(Hash(ss.begin(), ss.end())) / it.second;
-                allPostSorted.push_back(std::make_pair(it.first, std::make_pair(it.second, hashSortRating)));
-            }
+    for (auto& it : allSorted) {
+        winners.push_back(it.first);
+    }
+}
 
-            // Users with scores by comment
-            for (auto& it : allCommentRatings) {
-                CDataStream ss(hashProofOfStakeSource);
-                ss << it.first;
-                arith_uint256 hashSortRating = UintToArith256(Hash(ss.begin(), ss.end())) / it.second;
-                allCommentSorted.push_back(std::make_pair(it.first, std::make_pair(it.second, hashSortRating)));
-            }
-        }
+bool GetRatingRewards(CAmount nCredit, std::vector<CTxOut>& results, CAmount& totalAmount, const CBlockIndex* pindexPrev, CDataStream& hashProofOfStakeSource, std::vector<opcodetype>& winner_types, const CBlock* block)
+{
+    int height = pindexPrev->nHeight;
 
-        // Shrink founded users
-        {
-            // Users with scores by post
-            if (allPostSorted.size() > 0) {
-                std::sort(allPostSorted.begin(), allPostSorted.end(), [](auto & a, auto & b) {
-                    return a.second.second < b.second.second;
-                });
-
-                if (allPostSorted.size() > RATINGS_PAYOUT_MAX) {
-                    allPostSorted.resize(RATINGS_PAYOUT_MAX);
-                }
-
-                for (auto& it : allPostSorted) {
-                    vLotteryPost.push_back(it.first);
-                }
-            }
+    std::vector<std::string> vLotteryPost;
+    std::vector<std::string> vLotteryComment;
 
-            // Users with scores by comment
-            if (allCommentSorted.size() > 0) {
-                std::sort(allCommentSorted.begin(), allCommentSorted.end(), [](auto & a, auto & b) {
-                    return a.second.second < b.second.second;
-                });
+    // Users scored in previous block, prepared when it was connected
+    std::shared_ptr<const LotteryCandidates> candidates;
+    if (!g_addrindex->GetLotteryCandidates(pindexPrev, candidates)) return false;
 
-                if (allCommentSorted.size() > RATINGS_PAYOUT_MAX) {
-                    allCommentSorted.resize(RATINGS_PAYOUT_MAX);
-                }
+    const auto& allPostRatings = candidates->postRatings;
+    const auto& allCommentRatings = candidates->commentRatings;
+    const auto& mLotteryPostRef = candidates->postReferrers;
+    const auto& mLotteryCommentRef = candidates->commentReferrers;
 
-                for (auto& it : allCommentSorted) {
-                    vLotteryComment.push_back(it.first);
-                }
-            }
-        }
-    }
+    // Sort founded users
+    SelectLotteryWinners(allPostRatings, hashProofOfStakeSource, vLotteryPost);
+    SelectLotteryWinners(allCommentRatings, hashProofOfStakeSource, vLotteryComment);
 
     // Create transactions for all winners
     bool ret = false;
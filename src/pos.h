@@ -43,6 +43,9 @@ int64_t GetWeight(int64_t nIntervalBeginning, int64_t nIntervalEnd);
 
 bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, int64_t nTime, const COutPoint& prevout, int64_t* pBlockTime, CWallet* wallet, CDataStream& hashProofOfStakeSource);
 
+/* Check kernel with already known previous transaction and its block, no disk reads */
+bool CheckKernel(CBlockIndex* pindexPrev, unsigned int nBits, int64_t nTime, CBlockIndex* pindexFrom, CTransactionRef const & txPrev, const COutPoint& prevout, CDataStream& hashProofOfStakeSource);
+
 bool CheckStakeKernelHash(CBlockIndex* pindexPrev, unsigned int nBits, CBlockIndex& blockFrom, CTransactionRef const & txPrev, COutPoint const & prevout, unsigned int nTimeTx, arith_uint256& hashProofOfStake, CDataStream& hashProofOfStakeSource, arith_uint256& targetProofOfStake, bool fPrintProofOfStake = true);
 
 bool CheckProofOfStake(CBlockIndex* pindexPrev, CTransactionRef const & tx, unsigned int nBits, arith_uint256& hashProofOfStake, CDataStream& hashProofOfStakeSource, arith_uint256& targetProofOfStake, std::vector<CScriptCheck> *pvChecks, bool fCheckSignature = false);
@@ -53,6 +56,8 @@ bool CheckCoinStakeTimestamp(int nHeight, int64_t nTimeBlock, int64_t nTimeTx);
 
 bool ComputeNextStakeModifier(const CBlockIndex* pindexPrev, uint64_t& nStakeModifier, bool& fGeneratedStakeModifier);
 
+/** Up to 25 users with lowest hash(source, address) / rating, in order of payout */
+void SelectLotteryWinners(const std::map<std::string, int>& ratings, const CDataStream& hashProofOfStakeSource, std::vector<std::string>& winners);
 bool GetRatingRewards(CAmount nCredit, std::vector<CTxOut>& results, CAmount& totalAmount, const CBlockIndex* pindex, CDataStream& hashProofOfStakeSource, std::vector<opcodetype>& winner_types, const CBlock* block = nullptr);
 void GetReferrers(std::vector<std::string>& winners, std::map<std::string, std::string> all_referrers, std::vector<std::string>& referrers);
 bool GenerateOuts(CAmount nCredit, std::vector<CTxOut>& results, CAmount& totalAmount, std::vector<std::string> winners, opcodetype op_code_type, int height, std::vector<opcodetype>& winner_types);
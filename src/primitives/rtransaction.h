@@ -10,6 +10,8 @@ public:
     RTransaction(CTransactionRef tx);
     RTransaction(CMutableTransaction tx);
     RTransaction(CTransaction tx);
+    RTransaction(RTransaction&&) = default;
+    RTransaction& operator=(RTransaction&&) = default;
     ~RTransaction();
 
     // reindexer part of transaction
@@ -199,6 +199,7 @@ void RPCNotifyBlockChange(bool ibd, const CBlockIndex * pindex)
         std::lock_guard<std::mutex> lock(cs_blockchange);
         latestblock.hash = pindex->GetBlockHash();
         latestblock.height = pindex->nHeight;
+        rpcResponseCache.SetTip(latestblock.hash);
     }
     cond_blockchange.notify_all();
 }
@@ -2616,12 +2617,12 @@ UniValue scantxoutset(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
-    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      {}, false },
+    { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      {}, false, true },
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        {"nblocks", "blockhash"} },
     { "blockchain",         "getblockstats",          &getblockstats,          {"hash_or_height", "stats"} },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       {} },
     { "blockchain",         "getblockcount",          &getblockcount,          {} },
-    { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"}, false },
+    { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"}, false, true },
     { "blockchain",         "getblockhash",           &getblockhash,           {"height"} },
     { "blockchain",         "getblockheader",         &getblockheader,         {"blockhash","verbose"} },
     { "blockchain",         "getchaintips",           &getchaintips,           {} },
@@ -2640,10 +2641,10 @@ static const CRPCCommand commands[] =
     { "blockchain",         "preciousblock",          &preciousblock,          {"blockhash"} },
     { "blockchain",         "scantxoutset",           &scantxoutset,           {"action", "scanobjects"} },
 
-	{ "blockchain",         "getaddressinfo",         &getaddressinfo,         {"address"}, false },
-	{ "blockchain",         "gettransactions",        &gettransactions,        {"transactions"}, false },
-	{ "blockchain",         "getlastblocks",          &getlastblocks,          {"count","last_height","verbose"}, false },
-	{ "blockchain",         "checkstringtype",        &checkstringtype,        {"value"}, false },
+	{ "blockchain",         "getaddressinfo",         &getaddressinfo,         {"address"}, false, true },
+	{ "blockchain",         "gettransactions",        &gettransactions,        {"transactions"}, false, true },
+	{ "blockchain",         "getlastblocks",          &getlastblocks,          {"count","last_height","verbose"}, false, true },
+	{ "blockchain",         "checkstringtype",        &checkstringtype,        {"value"}, false, true },
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        {"blockhash"} },
@@ -147,6 +147,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
         {"bumpfee",                       1, "options"},
         {"logging",                       0, "include"},
         {"logging",                       1, "exclude"},
+        {"getrpcstat",                    0, "depth"},
         {"disconnectnode",                1, "nodeid"},
         {"addwitnessaddress",             1, "p2sh"},
         // Echo with conversion (For testing only)
@@ -9,6 +9,7 @@
 #include <core_io.h>
 #include <crypto/ripemd160.h>
 #include <httpserver.h>
+#include <init.h>
 #include <key_io.h>
 #include <net.h>
 #include <netbase.h>
@@ -283,6 +284,34 @@ static std::string RPCMallocInfo()
 }
 #endif
 
+static UniValue getrpcstat(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1)
+        throw std::runtime_error(
+            "getrpcstat (depth)\n"
+            "Returns RPC statistic: latency and payload per method, HTTP work queue depths and wait times.\n"
+            "Arguments:\n"
+            "1. depth    (numeric, optional) Window in seconds, default -statdepth\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"General\": {...},       (json object) Chain and peers\n"
+            "  \"RPC\": {...},           (json object) Totals over all methods\n"
+            "  \"Cache\": {...},         (json object) Items, size and hits of response cache\n"
+            "  \"Methods\": {...},       (json object) Count, times and queue wait in ms per method\n"
+            "  \"Queues\": {...}         (json object) Depth and wait in ms per HTTP work queue\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getrpcstat", "300") + HelpExampleRpc("getrpcstat", "300"));
+
+    int64_t depth = gArgs.GetArg("-statdepth", 60);
+    if (!request.params[0].isNull())
+        depth = request.params[0].get_int64();
+    if (depth <= 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Depth must be positive");
+
+    return gStatEngineInstance.CompileStatsAsJsonSince(gStatEngineInstance.GetCurrentSystemTime() - std::chrono::seconds(depth));
+}
+
 static UniValue getmemoryinfo(const JSONRPCRequest& request)
 {
     /* Please, avoid using the word "pool" here in the RPC interface or help,
@@ -490,9 +519,9 @@ static UniValue getnodeinfo(const JSONRPCRequest& request)
     oblock.pushKV("ntx", (int)pindex->nTx);
     entry.pushKV("lastblock", oblock);
 
-    if (!WSConnections.empty()) {
+    if (!WSConnections.Empty()) {
         UniValue proxies(UniValue::VARR);
-        for (auto& it : WSConnections) {
+        for (auto& it : WSConnections.Snapshot()) {
             if (it.second.Service) {
                 UniValue proxy(UniValue::VOBJ);
                 proxy.pushKV("address", it.second.Address);
@@ -505,6 +534,13 @@ static UniValue getnodeinfo(const JSONRPCRequest& request)
         entry.pushKV("proxies", proxies);
     }
 
+    WSConnectionRegistry::Stats wsStats = WSConnections.GetStats();
+    UniValue ows(UniValue::VOBJ);
+    ows.pushKV("connections", (uint64_t)wsStats.connections);
+    ows.pushKV("pending", wsStats.pending);
+    ows.pushKV("dropped", wsStats.dropped);
+    entry.pushKV("websocket", ows);
+
     return entry;
 }
 
@@ -524,6 +560,7 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
     { "control",            "logging",                &logging,                {"include", "exclude"}},
+    { "control",            "getrpcstat",             &getrpcstat,             {"depth"}},
     { "util",               "validateaddress",        &validateaddress,        {"address"} },
     { "util",               "createmultisig",         &createmultisig,         {"nrequired","keys"} },
     { "util",               "verifymessage",          &verifymessage,          {"address","signature","message"} },
@@ -534,8 +571,8 @@ static const CRPCCommand commands[] =
     { "hidden",             "echo",                   &echo,                   {"arg0","arg1","arg2","arg3","arg4","arg5","arg6","arg7","arg8","arg9"}},
     { "hidden",             "echojson",               &echo,                   {"arg0","arg1","arg2","arg3","arg4","arg5","arg6","arg7","arg8","arg9"}},
 
-    { "util",               "getnodeinfo",            &getnodeinfo,            {}, false},
-    { "util",               "getemission",            &getemission,            {"height"}, false},
+    { "util",               "getnodeinfo",            &getnodeinfo,            {}, false, true},
+    { "util",               "getemission",            &getemission,            {"height"}, false, true},
 
     /* For ReindexerDB */
     { "hidden",             "getristat",              &getristat,              {"table"}},
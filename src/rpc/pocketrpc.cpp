@@ -3374,272 +3374,53 @@ UniValue gethierarchicalstrip(const JSONRPCRequest& request)
         }
     }
 
-    // Do not show posts from users with reputation < Limit::bad_reputation
-    {
-        int64_t _bad_reputation_limit = GetActualLimit(Limit::bad_reputation, chainActive.Height());
-        reindexer::QueryResults queryResultsBadReputation;
-        reindexer::Error errorBadReputation = g_pocketdb->DB()->Select(reindexer::Query("UsersView").Where("reputation", CondLe, _bad_reputation_limit), queryResultsBadReputation);
-
-        for (auto it : queryResultsBadReputation) {
-            reindexer::Item itm(it.GetItem());
-            adrsExcluded.push_back(itm["address"].As<string>());
-            uvAdrsExcluded.push_back(itm["address"].As<string>());
-        }
-    }
-
-    enum PostRanks {LAST5, LAST5R, BOOST, UREP, UREPR, DREP, PREP, PREPR, DPOST, POSTRF};
-    int cntBlocksForResult = 300;
-    int cntPrevPosts = 5;
-    int durationBlocksForPrevPosts = 30 * 24 * 60; // about 1 month
-    double dekayRep = 0.82;//0.7;
-    double dekayPost = 0.96;
-    if (contentTypes.size() == 1 && contentTypes[0] == getcontenttype("video"))
-        dekayPost = 0.99;
-
-    std::vector<std::string> txidsOut;
-    std::vector<std::string> txidsHierarchical;
-
-    std::map<std::string, std::map<PostRanks, double>> postsRanks;
-    /*
-    enum scoreDetail {ADDRESS, VALUE, TXID}; // DEBUGINFO
-    std::map<std::string, std::vector<std::map<scoreDetail, std::string>>> postScoresDetails; // DEBUGINFO
-    std::map<std::string, std::vector<std::map<scoreDetail, std::string>>> postPrevScoresDetails; // DEBUGINFO
-     */
-
-    reindexer::Error err;
-    reindexer::Query query;
-    reindexer::QueryResults queryResults;
-
-    query = reindexer::Query("Posts");
-    query = query.Where("block", CondLe, nHeight);
-    query = query.Where("block", CondGt, nHeight - cntBlocksForResult);
-    query = query.Where("time", CondLe, GetAdjustedTime());
-    query = query.Where("txidRepost", CondEq, "");
-    if (!lang.empty()) {
-        query = query.Where("lang", CondEq, lang);
-    }
-    if (!tags.empty()) {
-        query = query.Where("tags", CondSet, tags);
-    }
-    if (!contentTypes.empty()) {
-        query = query.Where("type", CondSet, contentTypes);
-    }
-    if (!txidsExcluded.empty()) {
-        query = query.Not().Where("txid", CondSet, txidsExcluded);
-    }
-    if (!adrsExcluded.empty()) {
-        query = query.Not().Where("address", CondSet, adrsExcluded);
-    }
-    query = query.LeftJoin("txid", "posttxid", CondEq, reindexer::Query("PostRatings").Where("block", CondLe, nHeight).Sort("block", true).Limit(1));
-    query = query.LeftJoin("address", "address", CondEq, reindexer::Query("UserRatings").Where("block", CondLe, nHeight).Sort("block", true).Limit(1));
-    query = query.LeftJoin("txid", "txid", CondEq, reindexer::Query("PostsHistory").Where("block", CondLe, nHeight).Sort("block", false).Limit(1));
-    query = query.Sort("block", true).Sort("time", true);
-
-    err = g_pocketdb->DB()->Select(query, queryResults);
-    if (err.ok()) {
-        for (auto it : queryResults) {
-            reindexer::Item itm(it.GetItem());
-            double postRep = 0.0;
-            double userRep = 0.0;
-            if (it.GetJoined().size() > 0 && it.GetJoined()[0].Count() > 0) {
-                postRep = it.GetJoined()[0][0].GetItem()["reputation"].As<int>();
-            }
-            if (it.GetJoined().size() > 1 && it.GetJoined()[1].Count() > 0) {
-                userRep = it.GetJoined()[1][0].GetItem()["reputation"].As<int>() / 10.0;
-            }
-
-            reindexer::Query queryPrevsPosts;
-            reindexer::QueryResults queryPrevsPostsResult;
-
-            int cntPositiveScores = 0;
-            std::string posttxid = itm["txid"].As<string>();
-            std::string postaddress = itm["address"].As<string>();
-            int postblock = itm["block"].As<int>();
-            int postblockOrig = postblock;
-            if (it.GetJoined().size() > 2 && it.GetJoined()[2].Count() > 0) {
-                postblockOrig = it.GetJoined()[2][0].GetItem()["block"].As<int>();
-            }
-            uvTxidsExcluded.push_back(posttxid);
-
-            /*
-            // DEBUGINFO
-            if (postRep != 0) {
-                reindexer::QueryResults postRepQueryResult;
-                if (g_pocketdb->DB()->Select(reindexer::Query("Scores").Where("posttxid", CondEq, posttxid).Where("block", CondLe, nHeight), postRepQueryResult).ok()) {
-                    for (auto itPostRep : postRepQueryResult) {
-                        reindexer::Item itmPR(itPostRep.GetItem());
-                        if (g_antibot->AllowModifyReputationOverPost(itmPR["address"].As<string>(), postaddress, itmPR["block"].As<int>(), itmPR["time"].As<int64_t>(), posttxid, false)) {
-                            std::map<scoreDetail, std::string> postScoresDetail;           // DEBUGINFO
-                            postScoresDetail[ADDRESS] = itmPR["address"].As<string>(); // DEBUGINFO
-                            postScoresDetail[VALUE] = itmPR["value"].As<string>();     // DEBUGINFO
-                            postScoresDetails[posttxid].push_back(postScoresDetail);       // DEBUGINFO
-                        }
-                    }
-                }
-            }
-             */
-
-            queryPrevsPosts = reindexer::Query("Posts", 0, cntPrevPosts)
-                                     .Where("address", CondEq, postaddress)
-                                     .Where("block", CondLt, postblockOrig)
-                                     .Where("block", CondGe, postblockOrig - durationBlocksForPrevPosts);
-            err = g_pocketdb->DB()->Select(queryPrevsPosts, queryPrevsPostsResult);
-            if (err.ok()) {
-                std::vector<std::string> prevPostsIds;
-                for (auto itPrevPost : queryPrevsPostsResult) {
-                    reindexer::Item itmPP(itPrevPost.GetItem());
-                    prevPostsIds.push_back(itmPP["txid"].As<string>());
-                }
-                std::vector<int> scores = {1, 5};
-                reindexer::Query queryScores;
-                reindexer::QueryResults queryScoresResult;
-                queryScores = reindexer::Query("Scores");
-                queryScores = queryScores.Where("posttxid", CondSet, prevPostsIds);
-                queryScores = queryScores.Where("block", CondLe, postblock);
-                queryScores = queryScores.Where("value", CondSet, scores);
-                reindexer::Error errSc = g_pocketdb->DB()->Select(queryScores, queryScoresResult);
-                if (errSc.ok()) {
-                    std::vector<string> addressesRated;
-                    for (auto itScore : queryScoresResult) {
-                        reindexer::Item itmScore(itScore.GetItem());
-                        if (g_antibot->AllowModifyReputationOverPost(itmScore["address"].As<string>(), postaddress, itmScore["block"].As<int>(), itmScore["time"].As<int64_t>(), itmScore["txid"].As<string>(), false)) {
-                            if(std::find(addressesRated.begin(), addressesRated.end(), itmScore["address"].As<string>()) == addressesRated.end()) {
-                                addressesRated.push_back(itmScore["address"].As<string>());
-                                cntPositiveScores += itmScore["value"].As<int>() == 5 ? 1 : -1;
-                                /*
-                                std::map<scoreDetail, std::string> postPrevScoresDetail; // DEBUGINFO
-                                postPrevScoresDetail[ADDRESS] = itmScore["address"].As<string>(); // DEBUGINFO
-                                postPrevScoresDetail[VALUE] = itmScore["value"].As<string>(); // DEBUGINFO
-                                postPrevScoresDetail[TXID] = itmScore["posttxid"].As<string>(); // DEBUGINFO
-                                postPrevScoresDetails[posttxid].push_back(postPrevScoresDetail); // DEBUGINFO
-                                 */
-                            }
-                        }
-                    }
-                }
-            }
-            postsRanks[posttxid][LAST5] = 1.0 * cntPositiveScores;
-            postsRanks[posttxid][UREP] = userRep;
-            postsRanks[posttxid][PREP] = postRep;
-            postsRanks[posttxid][DREP] = pow(dekayRep, (nHeight - postblockOrig));
-            postsRanks[posttxid][DPOST] = pow(dekayPost, (nHeight - postblockOrig));
-        }
-
-        std::map<PostRanks, int> count;
-        int nElements = postsRanks.size();
-        for (auto iPostRank : postsRanks) {
-            count[LAST5R] = 0;
-            count[UREPR] = 0;
-            count[PREPR] = 0;
-            double boost = 0;
-            if (nElements > 1) {
-                for (auto jPostRank : postsRanks) {
-                    if (iPostRank.second[LAST5] > jPostRank.second[LAST5]) {
-                        count[LAST5R] += 1;
-                    }
-                    if (iPostRank.second[UREP] > jPostRank.second[UREP]) {
-                        count[UREPR] += 1;
-                    }
-                    if (iPostRank.second[PREP] > jPostRank.second[PREP]) {
-                        count[PREPR] += 1;
-                    }
-                }
-                postsRanks[iPostRank.first][LAST5R] = 1.0 * (count[LAST5R] * 100) / (nElements - 1);
-                postsRanks[iPostRank.first][UREPR] = std::min(postsRanks[iPostRank.first][UREP], 1.0 * (count[UREPR] * 100) / (nElements - 1)) * (postsRanks[iPostRank.first][UREP] < 0 ? 2.0 : 1.0);
-                postsRanks[iPostRank.first][PREPR] = std::min(postsRanks[iPostRank.first][PREP], 1.0 * (count[PREPR] * 100) / (nElements - 1)) * (postsRanks[iPostRank.first][PREP] < 0 ? 2.0 : 1.0);
-            }
-            else {
-                postsRanks[iPostRank.first][LAST5R] = 100;
-                postsRanks[iPostRank.first][UREPR] = 100;
-                postsRanks[iPostRank.first][PREPR] = 100;
-            }
-            postsRanks[iPostRank.first][POSTRF] = 0.4 *
-                                                      (0.75 *
-                                                              (postsRanks[iPostRank.first][LAST5R] + boost) +
-                                                          0.25 * postsRanks[iPostRank.first][UREPR]) *
-                                                      postsRanks[iPostRank.first][DREP] +
-                                                  0.6 * postsRanks[iPostRank.first][PREPR] * postsRanks[iPostRank.first][DPOST];
-        }
-
-        std::vector<std::pair<double, string>> postsRaited;
-
-        UniValue oPost(UniValue::VOBJ);
-        for (auto iPostRank : postsRanks) {
-            postsRaited.push_back(std::make_pair(iPostRank.second[POSTRF], iPostRank.first));
-        }
-
-        std::sort(postsRaited.begin(), postsRaited.end(), std::greater{});
-
-        for (auto v : postsRaited) {
-            txidsHierarchical.push_back(v.second);
-        }
-    }
-
     UniValue contents(UniValue::VARR);
 
-    if(!txidsHierarchical.empty())
-    {
-        std::vector<std::string>::iterator itVec;
-        if (!start_txid.empty()) {
-            if ((itVec = std::find(txidsHierarchical.begin(), txidsHierarchical.end(), start_txid)) != txidsHierarchical.end()) {
-                ++itVec;
+    // Ranking is materialized after each block, other heights are ranked on request
+    HierarchicalStripResult ranked;
+    bool hasRanked = false;
+    if (g_hierarchicalstrip) {
+        hasRanked = g_hierarchicalstrip->Get(nHeight, lang, contentTypes, ranked) ||
+                    g_hierarchicalstrip->Compute(nHeight, lang, contentTypes, ranked);
+    }
+
+    if (hasRanked) {
+        for (const auto& adr : *ranked.badAddresses) {
+            uvAdrsExcluded.push_back(adr);
+        }
+
+        // Filters are applied while paging so page is filled up to countOut.
+        // Page starts after start_txid in ranked list, even if start_txid itself is filtered.
+        bool paging = start_txid.empty();
+        std::set<std::string> txidsExcludedSet(txidsExcluded.begin(), txidsExcluded.end());
+        std::set<std::string> adrsExcludedSet(adrsExcluded.begin(), adrsExcluded.end());
+        std::set<std::string> tagsSet(tags.begin(), tags.end());
+        int64_t nTime = GetAdjustedTime();
+        for (const auto& postRef : *ranked.posts) {
+            const StripPost& post = *postRef;
+            if (!paging && post.txid == start_txid) {
+                paging = true;
                 start_txid.clear();
+                continue;
             }
-        }
-        else {
-            itVec = txidsHierarchical.begin();
-        }
 
-        for(; itVec != txidsHierarchical.end() && countOut > 0; ++itVec, countOut--) {
+            if (post.time > nTime) continue;
+            if (txidsExcludedSet.count(post.txid) || adrsExcludedSet.count(post.address)) continue;
+            if (!tagsSet.empty() && std::none_of(post.tags.begin(), post.tags.end(), [&tagsSet](const std::string& tag) { return tagsSet.count(tag) > 0; })) continue;
+
+            // Historical strip must not repeat any ranked post
+            uvTxidsExcluded.push_back(post.txid);
+            if (!paging || countOut <= 0) continue;
+
             reindexer::Item postItm;
-            reindexer::Error errS = g_pocketdb->SelectOne(reindexer::Query("Posts").Where("txid", CondEq, *itVec), postItm);
-            UniValue entry(UniValue::VOBJ);
-            entry = getPostData(postItm, "");
-            /*
-            if(postsRanks.find(*itVec) != postsRanks.end()) {
-                UniValue entryRanks(UniValue::VOBJ); // DEBUGINFO
-                entryRanks.pushKV("LAST5", postsRanks[*itVec][LAST5]); // DEBUGINFO
-                entryRanks.pushKV("LAST5R", postsRanks[*itVec][LAST5R]); // DEBUGINFO
-
-                UniValue entrtyPrevScoresAdrs(UniValue::VARR); // DEBUGINFO
-                for(auto pPrevScoreDetail : postPrevScoresDetails[*itVec]) // DEBUGINFO
-                {
-                    UniValue entryScoreAdr(UniValue::VOBJ); // DEBUGINFO
-                    entryScoreAdr.pushKV("address", pPrevScoreDetail[ADDRESS]); // DEBUGINFO
-                    entryScoreAdr.pushKV("value", pPrevScoreDetail[VALUE]); // DEBUGINFO
-                    entryScoreAdr.pushKV("posttxid", pPrevScoreDetail[TXID]); // DEBUGINFO
-                    entrtyPrevScoresAdrs.push_back(entryScoreAdr); // DEBUGINFO
-                }
-                entryRanks.pushKV("LAST5RADRS", entrtyPrevScoresAdrs); // DEBUGINFO
-
-                entryRanks.pushKV("BOOST", postsRanks[*itVec][BOOST]); // DEBUGINFO
-                entryRanks.pushKV("UREP", postsRanks[*itVec][UREP]); // DEBUGINFO
-                entryRanks.pushKV("UREPR", postsRanks[*itVec][UREPR]); // DEBUGINFO
-                entryRanks.pushKV("DREP", postsRanks[*itVec][DREP]); // DEBUGINFO
-                entryRanks.pushKV("PREP", postsRanks[*itVec][PREP]); // DEBUGINFO
-
-                UniValue entrtyScoresAdrs(UniValue::VARR); // DEBUGINFO
-                for(auto pScoreDetail : postScoresDetails[*itVec]) // DEBUGINFO
-                {
-                    UniValue entryScoreAdr(UniValue::VOBJ); // DEBUGINFO
-                    entryScoreAdr.pushKV("address", pScoreDetail[ADDRESS]); // DEBUGINFO
-                    entryScoreAdr.pushKV("value", pScoreDetail[VALUE]); // DEBUGINFO
-                    entrtyScoresAdrs.push_back(entryScoreAdr); // DEBUGINFO
-                }
-                entryRanks.pushKV("PREPRADRS", entrtyScoresAdrs); // DEBUGINFO
+            if (!g_pocketdb->SelectOne(reindexer::Query("Posts").Where("txid", CondEq, post.txid), postItm).ok()) continue;
 
-                entryRanks.pushKV("PREPR", postsRanks[*itVec][PREPR]); // DEBUGINFO
-                entryRanks.pushKV("DPOST", postsRanks[*itVec][DPOST]); // DEBUGINFO
-                entryRanks.pushKV("POSTRF", postsRanks[*itVec][POSTRF]); // DEBUGINFO
-                entry.pushKV("ranks", entryRanks); // DEBUGINFO
-            }
-             */
-            contents.push_back(entry);
-            uvTxidsExcluded.push_back(*itVec);
+            contents.push_back(getPostData(postItm, ""));
+            countOut--;
         }
     }
 
-    if (txidsHierarchical.empty() || countOut > 0) {
+    if (countOut > 0) {
         JSONRPCRequest new_request;
         new_request = request;
         UniValue new_params(UniValue::VARR);
@@ -3833,42 +3614,42 @@ UniValue getrecomendedsubscriptionsforuser(const JSONRPCRequest& request)
 
 static const CRPCCommand commands[] =
 {
-    {"pocketnetrpc", "getrawtransactionwithmessage",      &getrawtransactionwithmessage,      {"address_from", "address_to", "start_txid", "count", "lang", "tags", "contenttypes"}, false},
-    {"pocketnetrpc", "getrawtransactionwithmessage2",     &getrawtransactionwithmessage2,     {"address_from", "address_to", "start_txid", "count"},                                 false},
-    {"pocketnetrpc", "getrawtransactionwithmessagebyid",  &getrawtransactionwithmessagebyid,  {"txs", "address"},                                                                    false},
-    {"pocketnetrpc", "getrawtransactionwithmessagebyid2", &getrawtransactionwithmessagebyid2, {"txs", "address"},                                                                    false},
-    {"pocketnetrpc", "getuserprofile",                    &getuserprofile,                    {"addresses", "short"},                                                                false},
-    {"pocketnetrpc", "getmissedinfo",                     &getmissedinfo,                     {"address", "blocknumber"},                                                            false},
-    {"pocketnetrpc", "getmissedinfo2",                    &getmissedinfo2,                    {"address", "blocknumber"},                                                            false},
-    {"pocketnetrpc", "txunspent",                         &txunspent,                         {"addresses", "minconf", "maxconf", "include_unsafe", "query_options"},                false},
-    {"pocketnetrpc", "getaddressregistration",            &getaddressregistration,            {"addresses"},                                                                         false},
-    {"pocketnetrpc", "getuserstate",                      &getuserstate,                      {"address"},                                                                           false},
-    {"pocketnetrpc", "gettime",                           &gettime,                           {},                                                                                    false},
-    {"pocketnetrpc", "getrecommendedposts",               &getrecommendedposts,               {"address", "count", "height", "lang", "contenttypes"},                                false},
-    {"pocketnetrpc", "getrecommendedposts2",              &getrecommendedposts2,              {"address", "count"},                                                                  false},
-    {"pocketnetrpc", "searchtags",                        &searchtags,                        {"search_string", "count"},                                                            false},
-    {"pocketnetrpc", "search",                            &search,                            {"search_string", "type", "count"},                                                    false},
-    {"pocketnetrpc", "search2",                           &search2,                           {"search_string", "type", "count"},                                                    false},
-    {"pocketnetrpc", "gethotposts",                       &gethotposts,                       {"count", "depth", "height", "lang", "contenttypes"},                                  false},
-    {"pocketnetrpc", "gethotposts2",                      &gethotposts2,                      {"count", "depth"},                                                                    false},
-    {"pocketnetrpc", "getuseraddress",                    &getuseraddress,                    {"name", "count"},                                                                     false},
-    {"pocketnetrpc", "getreputations",                    &getreputations,                    {},                                                                                    false},
-    {"pocketnetrpc", "getcontents",                       &getcontents,                       {"address"},                                                                           false},
-    {"pocketnetrpc", "gettags",                           &gettags,                           {"address", "count"},                                                                  false},
-    {"pocketnetrpc", "getlastcomments2",                  &getlastcomments,                   {"count", "address"},                                                                  false},
-    {"pocketnetrpc", "getlastcomments",                   &getlastcomments,                   {"count", "address"},                                                                  false},
-    {"pocketnetrpc", "getcomments2",                      &getcomments,                       {"postid", "parentid", "address", "ids"},                                              false},
-    {"pocketnetrpc", "getcomments",                       &getcomments,                       {"postid", "parentid", "address", "ids"},                                              false},
-    {"pocketnetrpc", "getaddressscores",                  &getaddressscores,                  {"address", "txs"},                                                                    false},
-    {"pocketnetrpc", "getpostscores",                     &getpostscores,                     {"txs", "address"},                                                                    false},
-    {"pocketnetrpc", "getpagescores",                     &getpagescores,                     {"txs", "address", "cmntids"},                                                         false},
-    {"pocketnetrpc", "getaddressid",                      &getaddressid,                      {"address"},                                                                           false},
-    {"pocketnetrpc", "converttxidaddress",                &converttxidaddress,                {"txid", "address"},                                                                   false},
-    {"pocketnetrpc", "gethistoricalstrip",                &gethistoricalstrip,                {"height", "start_txid", "count", "lang", "tags", "contenttypes", "txids_exclude", "adrs_exclude"}, false},
-    {"pocketnetrpc", "gethierarchicalstrip",              &gethierarchicalstrip,              {"height", "start_txid", "count", "lang", "tags", "contenttypes", "txids_exclude", "adrs_exclude"}, false},
-
-    {"pocketnetrpc", "getusercontents",                   &getusercontents,                   {"address", "height", "start_txid", "count", "lang", "tags", "contenttypes"},          false},
-    {"pocketnetrpc", "getrecomendedsubscriptionsforuser", &getrecomendedsubscriptionsforuser, {"address", "count"},                                                                  false},
+    {"pocketnetrpc", "getrawtransactionwithmessage",      &getrawtransactionwithmessage,      {"address_from", "address_to", "start_txid", "count", "lang", "tags", "contenttypes"}, false, true, false, true},
+    {"pocketnetrpc", "getrawtransactionwithmessage2",     &getrawtransactionwithmessage2,     {"address_from", "address_to", "start_txid", "count"},                                 false, true, false, true},
+    {"pocketnetrpc", "getrawtransactionwithmessagebyid",  &getrawtransactionwithmessagebyid,  {"txs", "address"},                                                                    false, true},
+    {"pocketnetrpc", "getrawtransactionwithmessagebyid2", &getrawtransactionwithmessagebyid2, {"txs", "address"},                                                                    false, true},
+    {"pocketnetrpc", "getuserprofile",                    &getuserprofile,                    {"addresses", "short"},                                                                false, true},
+    {"pocketnetrpc", "getmissedinfo",                     &getmissedinfo,                     {"address", "blocknumber"},                                                            false, true},
+    {"pocketnetrpc", "getmissedinfo2",                    &getmissedinfo2,                    {"address", "blocknumber"},                                                            false, true},
+    {"pocketnetrpc", "txunspent",                         &txunspent,                         {"addresses", "minconf", "maxconf", "include_unsafe", "query_options"},                false, true},
+    {"pocketnetrpc", "getaddressregistration",            &getaddressregistration,            {"addresses"},                                                                         false, true},
+    {"pocketnetrpc", "getuserstate",                      &getuserstate,                      {"address"},                                                                           false, true},
+    {"pocketnetrpc", "gettime",                           &gettime,                           {},                                                                                    false, true},
+    {"pocketnetrpc", "getrecommendedposts",               &getrecommendedposts,               {"address", "count", "height", "lang", "contenttypes"},                                false, true, false, true},
+    {"pocketnetrpc", "getrecommendedposts2",              &getrecommendedposts2,              {"address", "count"},                                                                  false, true, false, true},
+    {"pocketnetrpc", "searchtags",                        &searchtags,                        {"search_string", "count"},                                                            false, true, false, true},
+    {"pocketnetrpc", "search",                            &search,                            {"search_string", "type", "count"},                                                    false, true, false, true},
+    {"pocketnetrpc", "search2",                           &search2,                           {"search_string", "type", "count"},                                                    false, true, false, true},
+    {"pocketnetrpc", "gethotposts",                       &gethotposts,                       {"count", "depth", "height", "lang", "contenttypes"},                                  false, true, true, true},
+    {"pocketnetrpc", "gethotposts2",                      &gethotposts2,                      {"count", "depth"},                                                                    false, true, true, true},
+    {"pocketnetrpc", "getuseraddress",                    &getuseraddress,                    {"name", "count"},                                                                     false, true},
+    {"pocketnetrpc", "getreputations",                    &getreputations,                    {},                                                                                    false, true},
+    {"pocketnetrpc", "getcontents",                       &getcontents,                       {"address"},                                                                           false, true, true},
+    {"pocketnetrpc", "gettags",                           &gettags,                           {"address", "count"},                                                                  false, true},
+    {"pocketnetrpc", "getlastcomments2",                  &getlastcomments,                   {"count", "address"},                                                                  false, true, true},
+    {"pocketnetrpc", "getlastcomments",                   &getlastcomments,                   {"count", "address"},                                                                  false, true, true},
+    {"pocketnetrpc", "getcomments2",                      &getcomments,                       {"postid", "parentid", "address", "ids"},                                              false, true},
+    {"pocketnetrpc", "getcomments",                       &getcomments,                       {"postid", "parentid", "address", "ids"},                                              false, true},
+    {"pocketnetrpc", "getaddressscores",                  &getaddressscores,                  {"address", "txs"},                                                                    false, true},
+    {"pocketnetrpc", "getpostscores",                     &getpostscores,                     {"txs", "address"},                                                                    false, true},
+    {"pocketnetrpc", "getpagescores",                     &getpagescores,                     {"txs", "address", "cmntids"},                                                         false, true},
+    {"pocketnetrpc", "getaddressid",                      &getaddressid,                      {"address"},                                                                           false, true},
+    {"pocketnetrpc", "converttxidaddress",                &converttxidaddress,                {"txid", "address"},                                                                   false, true},
+    {"pocketnetrpc", "gethistoricalstrip",                &gethistoricalstrip,                {"height", "start_txid", "count", "lang", "tags", "contenttypes", "txids_exclude", "adrs_exclude"}, false, true, true, true},
+    {"pocketnetrpc", "gethierarchicalstrip",              &gethierarchicalstrip,              {"height", "start_txid", "count", "lang", "tags", "contenttypes", "txids_exclude", "adrs_exclude"}, false, true, true, true},
+
+    {"pocketnetrpc", "getusercontents",                   &getusercontents,                   {"address", "height", "start_txid", "count", "lang", "tags", "contenttypes"},          false, true},
+    {"pocketnetrpc", "getrecomendedsubscriptionsforuser", &getrecomendedsubscriptionsforuser, {"address", "count"},                                                                  false, true, false, true},
 
     // Pocketnet transactions
     {"pocketnetrpc", "sendrawtransactionwithmessage",     &sendrawtransactionwithmessage,     {"hexstring", "message", "type"}, false},
@@ -5,6 +5,7 @@
 
 #include <txmempool.h>
 #include "index/addrindex.h"
+#include "index/hierarchicalstrip.h"
 #include "antibot/antibot.h"
 #include "rpc/server.h"
 #include "rpc/rawtransaction.h"
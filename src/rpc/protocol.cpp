@@ -50,6 +50,16 @@ std::string JSONRPCReply(const UniValue& result, const UniValue& error, const Un
     return reply.write() + "\n";
 }
 
+std::string JSONRPCReplyObjSerialized(const std::string& result, const UniValue& id)
+{
+    return "{\"result\":" + result + ",\"error\":null,\"id\":" + id.write() + "}";
+}
+
+std::string JSONRPCReplySerialized(const std::string& result, const UniValue& id)
+{
+    return JSONRPCReplyObjSerialized(result, id) + "\n";
+}
+
 UniValue JSONRPCError(int code, const std::string& message)
 {
     UniValue error(UniValue::VOBJ);
@@ -1765,7 +1765,7 @@ static UniValue getaddressbalance(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                                    actor (function)                    argNames
   //  --------------------- ------------------------                -----------------------             ----------
-    { "rawtransactions",    "getrawtransaction",                    &getrawtransaction,                 {"txid","verbose","blockhash"}, false },
+    { "rawtransactions",    "getrawtransaction",                    &getrawtransaction,                 {"txid","verbose","blockhash"}, false, true },
     { "rawtransactions",    "createrawtransaction",                 &createrawtransaction,              {"inputs","outputs","locktime","replaceable"} },
     { "rawtransactions",    "decoderawtransaction",                 &decoderawtransaction,              {"hexstring","iswitness"} },
     { "rawtransactions",    "decodescript",                         &decodescript,                      {"hexstring"} },
@@ -19,7 +19,12 @@
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <memory> // for unique_ptr
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 
 #include <chrono>
@@ -34,6 +39,74 @@ static RPCTimerInterface* timerInterface = nullptr;
 /* Map of name to timer. */
 static std::map<std::string, std::unique_ptr<RPCTimerBase> > deadlineTimers;
 
+/*
+    Fixed pool of threads for read-only elements of JSON-RPC batches.
+    Shared by all batches, task is rejected when all threads are busy
+    and enough tasks are waiting - batch caller executes it then.
+*/
+class RPCBatchExecutor
+{
+private:
+    std::mutex cs;
+    std::condition_variable cond;
+    std::deque<std::function<void()>> tasks;
+    std::vector<std::thread> threads;
+    bool running = false;
+
+    void worker()
+    {
+        RenameThread("pocketcoin-rpcbatch");
+        std::unique_lock<std::mutex> lock(cs);
+        while (true) {
+            cond.wait(lock, [this] { return !running || !tasks.empty(); });
+            if (!running)
+                return;
+
+            auto task = std::move(tasks.front());
+            tasks.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+public:
+    void Start(int threadCount)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        running = true;
+        for (int i = 0; i < threadCount; i++)
+            threads.emplace_back(&RPCBatchExecutor::worker, this);
+    }
+
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            running = false;
+            tasks.clear();
+        }
+        cond.notify_all();
+        for (auto& thread : threads)
+            thread.join();
+        threads.clear();
+    }
+
+    bool TrySubmit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            if (!running || tasks.size() >= threads.size())
+                return false;
+            tasks.push_back(std::move(task));
+        }
+        cond.notify_one();
+        return true;
+    }
+};
+
+static RPCBatchExecutor rpcBatchExecutor;
+
 static struct CRPCSignals
 {
     boost::signals2::signal<void ()> Started;
@@ -306,6 +379,8 @@ bool CRPCTable::appendCommand(const std::string& name, const CRPCCommand* pcmd)
 void StartRPC()
 {
     LogPrint(BCLog::RPC, "Starting RPC\n");
+    rpcResponseCache.SetMaxSize(std::max<int64_t>(0, gArgs.GetArg("-rpccachesize", DEFAULT_RPC_CACHE_SIZE)) << 20);
+    rpcBatchExecutor.Start(std::max<int64_t>(0, gArgs.GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS)));
     fRPCRunning = true;
     g_rpcSignals.Started();
 }
@@ -321,6 +396,7 @@ void StopRPC()
 {
     LogPrint(BCLog::RPC, "Stopping RPC\n");
     deadlineTimers.clear();
+    rpcBatchExecutor.Stop();
     DeleteAuthCookie();
     g_rpcSignals.Stopped();
 }
@@ -393,36 +469,107 @@ bool IsDeprecatedRPCEnabled(const std::string& method)
     return find(enabled_methods.begin(), enabled_methods.end(), method) != enabled_methods.end();
 }
 
-static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
+static std::string JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
 {
-    UniValue rpc_result(UniValue::VOBJ);
-
     try {
         jreq.parse(req);
 
-        UniValue result = tableRPC.execute(jreq);
-        rpc_result = JSONRPCReplyObj(result, NullUniValue, jreq.id);
+        return JSONRPCReplyObjSerialized(tableRPC.executeCached(jreq), jreq.id);
     }
     catch (const UniValue& objError)
     {
-        rpc_result = JSONRPCReplyObj(NullUniValue, objError, jreq.id);
+        return JSONRPCReplyObj(NullUniValue, objError, jreq.id).write();
     }
     catch (const std::exception& e)
     {
-        rpc_result = JSONRPCReplyObj(NullUniValue,
-                                     JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        return JSONRPCReplyObj(NullUniValue,
+                               JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id).write();
     }
+}
 
-    return rpc_result;
+/* Serialized replies joined to JSON array */
+static std::string JSONRPCBatchReply(const std::vector<std::string>& replies)
+{
+    std::string ret = "[";
+    for (size_t i = 0; i < replies.size(); i++) {
+        if (i > 0) ret += ",";
+        ret += replies[i];
+    }
+    return ret + "]\n";
 }
 
+bool JSONRPCIsReadOnly(const UniValue& req)
+{
+    if (!req.isObject())
+        return true;
+
+    const UniValue& method = find_value(req, "method");
+    if (!method.isStr())
+        return true;
+
+    // Unknown methods only fail
+    const CRPCCommand* pcmd = tableRPC[method.get_str()];
+    return !pcmd || pcmd->readOnly;
+}
+
+/* Elements of batch shared by caller and executor lanes */
+struct RPCBatch {
+    JSONRPCRequest jreq;
+    UniValue vReq;
+    std::vector<std::string> results;
+    std::atomic<size_t> next{0};
+    size_t done = 0;
+    std::mutex cs;
+    std::condition_variable cond;
+
+    // Execute elements until none left
+    void Run()
+    {
+        for (size_t i = next++; i < results.size(); i = next++) {
+            std::string result = JSONRPCExecOne(jreq, vReq[i]);
+
+            std::lock_guard<std::mutex> lock(cs);
+            results[i] = std::move(result);
+            if (++done == results.size())
+                cond.notify_all();
+        }
+    }
+};
+
 std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
 {
-    UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    // Batches with state changing calls keep sequential order
+    int parallel = std::min<int64_t>(vReq.size(), gArgs.GetArg("-rpcbatchparallel", DEFAULT_RPC_BATCH_PARALLEL));
+    for (unsigned int reqIdx = 0; parallel > 1 && reqIdx < vReq.size(); reqIdx++)
+        if (!JSONRPCIsReadOnly(vReq[reqIdx]))
+            parallel = 1;
+
+    if (parallel <= 1) {
+        std::vector<std::string> replies;
+        for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
+            replies.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+
+        return JSONRPCBatchReply(replies);
+    }
+
+    // Lanes may start after batch is finished and must not refer to caller stack
+    auto batch = std::make_shared<RPCBatch>();
+    batch->jreq = jreq;
+    batch->vReq = vReq;
+    batch->results.resize(vReq.size());
+
+    for (int lane = 1; lane < parallel; lane++)
+        if (!rpcBatchExecutor.TrySubmit([batch] { batch->Run(); }))
+            break;
+
+    batch->Run();
+
+    {
+        std::unique_lock<std::mutex> lock(batch->cs);
+        batch->cond.wait(lock, [&batch] { return batch->done == batch->results.size(); });
+    }
 
-    return ret.write() + "\n";
+    return JSONRPCBatchReply(batch->results);
 }
 
 /**
@@ -506,6 +653,25 @@ UniValue CRPCTable::execute(const JSONRPCRequest &request) const
     }
 }
 
+std::string CRPCTable::executeCached(const JSONRPCRequest &request) const
+{
+    // Hot read-only methods are served from cache until next block
+    const CRPCCommand* pcmd = tableRPC[request.strMethod];
+    if (!pcmd || !pcmd->cacheable || !rpcResponseCache.IsEnabled())
+        return execute(request).write();
+
+    std::string key = CRPCResponseCache::Key(request);
+    uint256 tip = rpcResponseCache.GetTip();
+
+    std::string result;
+    if (!rpcResponseCache.Get(tip, key, result)) {
+        result = execute(request).write();
+        rpcResponseCache.Put(tip, key, result);
+    }
+
+    return result;
+}
+
 std::vector<std::string> CRPCTable::listCommands() const
 {
     std::vector<std::string> commandList;
@@ -562,4 +728,88 @@ int RPCSerializationFlags()
     return flag;
 }
 
+std::string CRPCResponseCache::Key(const JSONRPCRequest& request)
+{
+    return request.strMethod + '\0' + request.params.write();
+}
+
+void CRPCResponseCache::clear()
+{
+    entries.clear();
+    index.clear();
+    memoryUsage = 0;
+}
+
+void CRPCResponseCache::evict(size_t maxUsage)
+{
+    while (memoryUsage > maxUsage && !entries.empty()) {
+        auto& entry = entries.back();
+        memoryUsage -= entry.first.size() + entry.second.size();
+        index.erase(entry.first);
+        entries.pop_back();
+    }
+}
+
+void CRPCResponseCache::SetMaxSize(size_t bytes)
+{
+    LOCK(cs);
+    maxMemoryUsage = bytes;
+    evict(maxMemoryUsage);
+}
+
+bool CRPCResponseCache::IsEnabled()
+{
+    LOCK(cs);
+    return maxMemoryUsage > 0;
+}
+
+uint256 CRPCResponseCache::GetTip()
+{
+    LOCK(cs);
+    return tip;
+}
+
+void CRPCResponseCache::SetTip(const uint256& hash)
+{
+    LOCK(cs);
+    if (tip == hash) return;
+    tip = hash;
+    clear();
+}
+
+bool CRPCResponseCache::Get(const uint256& hash, const std::string& key, std::string& result)
+{
+    LOCK(cs);
+    auto it = index.find(key);
+    if (hash != tip || it == index.end()) {
+        misses += 1;
+        return false;
+    }
+
+    hits += 1;
+    entries.splice(entries.begin(), entries, it->second);
+    result = it->second->second;
+    return true;
+}
+
+void CRPCResponseCache::Put(const uint256& hash, const std::string& key, const std::string& result)
+{
+    LOCK(cs);
+    size_t usage = key.size() + result.size();
+    if (hash != tip || usage > maxMemoryUsage || index.count(key))
+        return;
+
+    evict(maxMemoryUsage - usage);
+    entries.emplace_front(key, result);
+    index.emplace(key, entries.begin());
+    memoryUsage += usage;
+}
+
+CRPCResponseCache::Stats CRPCResponseCache::GetStats()
+{
+    LOCK(cs);
+    return Stats{entries.size(), memoryUsage, hits, misses};
+}
+
 CRPCTable tableRPC;
+CRPCResponseCache rpcResponseCache;
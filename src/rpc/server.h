@@ -8,16 +8,24 @@
 
 #include <amount.h>
 #include <rpc/protocol.h>
+#include <sync.h>
 #include <uint256.h>
 
 #include <list>
 #include <map>
 #include <stdint.h>
 #include <string>
+#include <unordered_map>
 
 #include <univalue.h>
 
 static const unsigned int DEFAULT_RPC_SERIALIZE_VERSION = 1;
+/** Threads executing read-only elements of JSON-RPC batches */
+static const int DEFAULT_RPC_BATCH_THREADS = 8;
+/** Max elements of one batch executed at once */
+static const int DEFAULT_RPC_BATCH_PARALLEL = 4;
+/** Memory for cached replies of cacheable RPC methods in MiB, 0 disables */
+static const int64_t DEFAULT_RPC_CACHE_SIZE = 32;
 
 class CRPCCommand;
 
@@ -136,6 +144,56 @@ public:
     rpcfn_type actor;
     std::vector<std::string> argNames;
     bool pwdRequied = true;
+    /** Does not change node state, may run in parallel with other elements of batch */
+    bool readOnly = false;
+    /** Result depends only on params and chain tip, may be served from rpcResponseCache */
+    bool cacheable = false;
+    /** Ranks, searches or scans many rows, charged RPC_COST_HEAVY from PUBLIC client balance */
+    bool heavy = false;
+};
+
+/**
+ * Serialized results of cacheable RPC methods keyed by method and params.
+ * All entries belong to one chain tip and are dropped when tip changes.
+ * Least recently used entries are evicted above the memory limit.
+ */
+class CRPCResponseCache
+{
+public:
+    struct Stats {
+        size_t items;
+        size_t memoryUsage;
+        uint64_t hits;
+        uint64_t misses;
+    };
+
+private:
+    typedef std::pair<std::string, std::string> Entry;
+
+    CCriticalSection cs;
+    uint256 tip;
+    std::list<Entry> entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t memoryUsage = 0;
+    size_t maxMemoryUsage = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    void clear();
+    void evict(size_t maxUsage);
+
+public:
+    static std::string Key(const JSONRPCRequest& request);
+
+    void SetMaxSize(size_t bytes);
+    bool IsEnabled();
+    /** Tip of cached entries, pass it back to Get and Put */
+    uint256 GetTip();
+    void SetTip(const uint256& hash);
+    bool Get(const uint256& hash, const std::string& key, std::string& result);
+    /** Ignored if tip changed since result was computed */
+    void Put(const uint256& hash, const std::string& key, const std::string& result);
+    Stats GetStats();
 };
 
 /**
@@ -158,6 +216,13 @@ public:
      */
     UniValue execute(const JSONRPCRequest &request) const;
 
+    /**
+     * Execute a method and serialize result.
+     * Results of cacheable methods are served from rpcResponseCache until next block.
+     * @throws an exception (UniValue) when an error happens.
+     */
+    std::string executeCached(const JSONRPCRequest &request) const;
+
     /**
     * Returns a list of registered commands
     * @returns List of registered commands.
@@ -185,6 +250,7 @@ public:
 bool IsDeprecatedRPCEnabled(const std::string& method);
 
 extern CRPCTable tableRPC;
+extern CRPCResponseCache rpcResponseCache;
 
 /**
  * Utilities: convert hex-encoded Values
@@ -203,6 +269,8 @@ void StartRPC();
 void InterruptRPC();
 void StopRPC();
 std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq);
+/** Batch element does not change node state and may run in parallel with others */
+bool JSONRPCIsReadOnly(const UniValue& req);
 
 // Retrieves any serialization flags requested in command line argument
 int RPCSerializationFlags();
@@ -7,6 +7,7 @@
 #include <miner.h>
 #include <net.h>
 #include <pos.h>
+#include <pow.h>
 #include <validation.h>
 #include <wallet/wallet.h>
 #include <script/sign.h>
@@ -107,6 +108,15 @@ void Staker::worker(
     if (!wallet) { return; }
     wallet->GetScriptForMining(coinbaseScript);
 
+    // Slot and tip of last kernel search
+    int64_t nLastKernelSearchTime = 0;
+    CBlockIndex* pindexLastKernelSearch = nullptr;
+
+    // Template kept for retries at the same tip
+    std::unique_ptr<CBlockTemplate> blocktemplate;
+    uint64_t nTemplateFees = 0;
+    int64_t nTemplateTime = 0;
+
     try {
 
         if (!coinbaseScript || coinbaseScript->reserveScript.empty())
@@ -149,20 +159,47 @@ void Staker::worker(
                 MilliSleep(30000);
             }
 
-            uint64_t nFees = 0;
-            auto assembler = BlockAssembler(chainparams);
-            auto blocktemplate = assembler.CreateNewBlock(
-                coinbaseScript->reserveScript, true, true, &nFees
-            );
+            // Search kernel for current time slot first, block is assembled only when it exists
+            CBlockIndex* pindexPrev = chainActive.Tip();
+            int64_t nSearchTime = GetAdjustedTime() & ~STAKE_TIMESTAMP_MASK;
+            if (nSearchTime == nLastKernelSearchTime && pindexPrev == pindexLastKernelSearch) {
+                MilliSleep(minerSleep);
+                continue;
+            }
+
+            CBlockHeader header;
+            header.nTime = nSearchTime;
+            unsigned int nBits = GetNextWorkRequired(pindexPrev, &header, chainparams.GetConsensus());
+            bool fKernelFound = wallet->HasStakeKernel(pindexPrev, nBits, nSearchTime, 1);
+
+            if (nLastKernelSearchTime > 0)
+                lastCoinStakeSearchInterval = nSearchTime - nLastKernelSearchTime;
+            nLastKernelSearchTime = nSearchTime;
+            pindexLastKernelSearch = pindexPrev;
+
+            if (!fKernelFound) {
+                MilliSleep(minerSleep);
+                continue;
+            }
+
+            if (!blocktemplate || blocktemplate->block.hashPrevBlock != chainActive.Tip()->GetBlockHash() ||
+                GetTime() - nTemplateTime > STAKER_TEMPLATE_MAX_AGE) {
+                nTemplateFees = 0;
+                auto assembler = BlockAssembler(chainparams);
+                blocktemplate = assembler.CreateNewBlock(
+                    coinbaseScript->reserveScript, true, true, &nTemplateFees
+                );
+                nTemplateTime = GetTime();
 
-            // Write ReindexerDB current state to coinbase transaction
-            if (chainActive.Tip()->nHeight >= Params().GetConsensus().nHeight_version_1_0_0) {
-                g_addrindex->WriteRHash(blocktemplate->block, chainActive.Tip());
+                // Write ReindexerDB current state to coinbase transaction
+                if (chainActive.Tip()->nHeight >= Params().GetConsensus().nHeight_version_1_0_0) {
+                    g_addrindex->WriteRHash(blocktemplate->block, chainActive.Tip());
+                }
             }
             
             std::shared_ptr<CBlock> block = std::make_shared<CBlock>(blocktemplate->block);
 
-            if (signBlock(block, wallet, nFees)) {
+            if (signBlock(block, wallet, nTemplateFees, nSearchTime)) {
                 CheckStake(block, wallet, chainparams);
                 MilliSleep(500);
             }
@@ -184,7 +221,7 @@ void Staker::worker(
 }
 
 bool Staker::signBlock(
-    std::shared_ptr<CBlock> block, std::shared_ptr<CWallet> wallet, int64_t nFees
+    std::shared_ptr<CBlock> block, std::shared_ptr<CWallet> wallet, int64_t nFees, int64_t nSearchTime
 ) {
 #ifdef ENABLE_WALLET
     std::vector<CTransactionRef> vtx = block->vtx;
@@ -201,75 +238,62 @@ bool Staker::signBlock(
         return true;
     }
 
-    static int64_t nLastCoinStakeSearchTime = GetAdjustedTime();
-
     CKey key;
     CMutableTransaction txCoinStake;
     CTransaction txNew;
-    int nBestHeight = chainActive.Tip()->nHeight;
-
-    txCoinStake.nTime = GetAdjustedTime();
-    txCoinStake.nTime &= ~STAKE_TIMESTAMP_MASK;
 
-    int64_t nSearchTime = txCoinStake.nTime;
-
-    if (nSearchTime > nLastCoinStakeSearchTime)
-    {
-        int64_t nSearchInterval = nBestHeight + 1 > 0 ? 1 : nSearchTime - nLastCoinStakeSearchTime;
-        if (wallet->CreateCoinStake(*wallet.get(), block->nBits, nSearchInterval, nFees, txCoinStake, key)) {
-            if (txCoinStake.nTime >= chainActive.Tip()->GetPastTimeLimit() + 1) {
-                // make sure coinstake would meet timestamp protocol
-                // as it would be the same as the block timestamp
-                CMutableTransaction txn(*block->vtx[0].get());
-                txn.nTime = block->nTime = txCoinStake.nTime;
-                block->vtx[0] = MakeTransactionRef(std::move(txn));
-
-                // We have to make sure that we have no future timestamps in
-                // our transactions set
-                for (auto it = vtx.begin(); it != vtx.end();) {
-                    auto tx = *it;
-                    if (tx->nTime > block->nTime) {
-                        it = vtx.erase(it);
-                    }
-                    else {
-                        ++it;
-                    }
+    // Kernel was found by worker for this slot
+    txCoinStake.nTime = nSearchTime;
+
+    if (wallet->CreateCoinStake(*wallet.get(), block->nBits, 1, nFees, txCoinStake, key)) {
+        if (txCoinStake.nTime >= chainActive.Tip()->GetPastTimeLimit() + 1) {
+            // make sure coinstake would meet timestamp protocol
+            // as it would be the same as the block timestamp
+            CMutableTransaction txn(*block->vtx[0].get());
+            txn.nTime = block->nTime = txCoinStake.nTime;
+            block->vtx[0] = MakeTransactionRef(std::move(txn));
+
+            // We have to make sure that we have no future timestamps in
+            // our transactions set
+            for (auto it = vtx.begin(); it != vtx.end();) {
+                auto tx = *it;
+                if (tx->nTime > block->nTime) {
+                    it = vtx.erase(it);
+                }
+                else {
+                    ++it;
                 }
+            }
 
-                txCoinStake.nVersion = CTransaction::CURRENT_VERSION;
+            txCoinStake.nVersion = CTransaction::CURRENT_VERSION;
 
-                // After the changes, we need to resign inputs.
-                CMutableTransaction txNewConst(txCoinStake);
+            // After the changes, we need to resign inputs.
+            CMutableTransaction txNewConst(txCoinStake);
 
-                for (unsigned int i = 0; i < txCoinStake.vin.size(); i++) {
-                    bool signSuccess;
-                    uint256 prevHash = txCoinStake.vin[i].prevout.hash;
-                    uint32_t n = txCoinStake.vin[i].prevout.n;
-                    assert(wallet->mapWallet.count(prevHash));
-                    auto prevTx = wallet->GetWalletTx(prevHash);
-                    const CScript& scriptPubKey = prevTx->tx->vout[n].scriptPubKey;
-                    SignatureData sigdata;
-                    signSuccess = ProduceSignature(*wallet.get(), MutableTransactionSignatureCreator(&txNewConst, i, prevTx->tx->vout[n].nValue, SIGHASH_ALL), scriptPubKey, sigdata);
+            for (unsigned int i = 0; i < txCoinStake.vin.size(); i++) {
+                bool signSuccess;
+                uint256 prevHash = txCoinStake.vin[i].prevout.hash;
+                uint32_t n = txCoinStake.vin[i].prevout.n;
+                assert(wallet->mapWallet.count(prevHash));
+                auto prevTx = wallet->GetWalletTx(prevHash);
+                const CScript& scriptPubKey = prevTx->tx->vout[n].scriptPubKey;
+                SignatureData sigdata;
+                signSuccess = ProduceSignature(*wallet.get(), MutableTransactionSignatureCreator(&txNewConst, i, prevTx->tx->vout[n].nValue, SIGHASH_ALL), scriptPubKey, sigdata);
 
-                    if (!signSuccess) {
-                        return false;
-                    }
-                    else {
-                        UpdateInput(txCoinStake.vin[i], sigdata);
-                    }
+                if (!signSuccess) {
+                    return false;
+                }
+                else {
+                    UpdateInput(txCoinStake.vin[i], sigdata);
                 }
+            }
 
-                CTransactionRef txNew = MakeTransactionRef(std::move(txCoinStake));
-                block->vtx.insert(block->vtx.begin() + 1, txNew);
-                block->hashMerkleRoot = BlockMerkleRoot(*block);
+            CTransactionRef txNew = MakeTransactionRef(std::move(txCoinStake));
+            block->vtx.insert(block->vtx.begin() + 1, txNew);
+            block->hashMerkleRoot = BlockMerkleRoot(*block);
 
-                return key.Sign(block->GetHash(), block->vchBlockSig);
-            }
+            return key.Sign(block->GetHash(), block->vchBlockSig);
         }
-        lastCoinStakeSearchInterval = nSearchTime - nLastCoinStakeSearchTime;
-        nLastCoinStakeSearchTime = nSearchTime;
-    }
-    else {
     }
 #endif
     return false;
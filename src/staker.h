@@ -12,6 +12,9 @@
 
 class CWallet;
 
+/** Seconds the staking block template is reused at the same tip */
+static const int64_t STAKER_TEMPLATE_MAX_AGE = 60;
+
 class Staker {
 public:
   static Staker * getInstance();
@@ -25,7 +28,8 @@ public:
   );
   void run(CChainParams const &, boost::thread_group &);
   void worker(CChainParams const &, std::string const & walletName);
-  bool signBlock(std::shared_ptr<CBlock>, std::shared_ptr<CWallet>, int64_t);
+  // Sign block with coinstake found for search time slot
+  bool signBlock(std::shared_ptr<CBlock>, std::shared_ptr<CWallet>, int64_t nFees, int64_t nSearchTime);
 
 private:
   Staker();
@@ -5,13 +5,19 @@
 #include "chainparams.h"
 #include "validation.h"
 #include <boost/thread.hpp>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <ctime>
+#include <functional>
+#include <map>
 #include <net.h>
-#include <numeric>
-#include <set>
+#include <thread>
+#include "httpserver.h"
 #include "pocketdb/pocketdb.h"
+#include "rpc/server.h"
 
 namespace Statistic
 {
@@ -29,149 +35,276 @@ namespace Statistic
         RequestIP SourceIP;
         RequestPayloadSize InputSize;
         RequestPayloadSize OutputSize;
+        // Time spent in HTTP work queue before execution
+        RequestTime QueueWait{};
+        std::string Queue;
     };
 
-    class RequestStatEngine
+    // Log-linear latency histogram in milliseconds.
+    // Values below SUB_COUNT are exact, every next power of two
+    // is split into SUB_COUNT bins - relative error is below 1/SUB_COUNT
+    class LatencyHistogram
     {
     public:
-        RequestStatEngine() = default;
-        RequestStatEngine(const RequestStatEngine&) = delete;
-        RequestStatEngine(RequestStatEngine&&) = default;
+        static constexpr int SUB_BITS = 3;
+        static constexpr int SUB_COUNT = 1 << SUB_BITS;
+        static constexpr int MAX_BITS = 24;
+        static constexpr int BINS = SUB_COUNT * (MAX_BITS - SUB_BITS + 1);
 
-        void AddSample(const RequestSample& sample)
+        void Add(uint64_t value)
         {
-            if (sample.TimestampEnd < sample.TimestampBegin)
-                return;
-
-            LOCK(_samplesLock);
-            _samples.push_back(sample);
+            _bins[BinOf(value)]++;
+            _count++;
+            _sum += value;
+            _max = std::max(_max, value);
         }
 
-        std::size_t GetNumSamples()
+        void Merge(const LatencyHistogram& other)
         {
-            LOCK(_samplesLock);
-            return _samples.size();
-        }
+            for (int i = 0; i < BINS; i++)
+                _bins[i] += other._bins[i];
 
-        std::size_t GetNumSamplesBetween(RequestTime begin, RequestTime end)
-        {
-            LOCK(_samplesLock);
-            return std::count_if(
-                _samples.begin(),
-                _samples.end(),
-                [=](const RequestSample& sample)
-                {
-                    return sample.TimestampBegin >= begin && sample.TimestampEnd <= end;
-                });
+            _count += other._count;
+            _sum += other._sum;
+            _max = std::max(_max, other._max);
         }
 
-        std::size_t GetNumSamplesBefore(RequestTime time)
-        {
-            return GetNumSamplesBetween(RequestTime::min(), time);
-        }
+        uint64_t Count() const { return _count; }
+        uint64_t Max() const { return _max; }
+        uint64_t Sum() const { return _sum; }
+        uint64_t Avg() const { return _count ? _sum / _count : 0; }
 
-        std::size_t GetNumSamplesSince(RequestTime time)
+        uint64_t Percentile(double p) const
         {
-            return GetNumSamplesBetween(time, RequestTime::max());
+            if (_count == 0) return 0;
+
+            auto target = (uint64_t) std::ceil(p * _count);
+            uint64_t seen = 0;
+            for (int i = 0; i < BINS; i++)
+            {
+                seen += _bins[i];
+                if (seen >= target)
+                    return std::min(BinUpper(i), _max);
+            }
+
+            return _max;
         }
 
-        RequestTime GetAvgRequestTimeSince(RequestTime since)
+    private:
+        std::array<uint32_t, BINS> _bins{};
+        uint64_t _count = 0;
+        uint64_t _sum = 0;
+        uint64_t _max = 0;
+
+        static int BinOf(uint64_t value)
         {
-            LOCK(_samplesLock);
+            value = std::min<uint64_t>(value, (1ull << MAX_BITS) - 1);
+            if (value < SUB_COUNT) return (int) value;
 
-            if (_samples.empty())
-                return {};
+            int msb = SUB_BITS;
+            while ((value >> (msb + 1)) != 0) msb++;
 
-            RequestTime sum{};
-            std::size_t count{};
+            int shift = msb - SUB_BITS;
+            return SUB_COUNT * (shift + 1) + (int) ((value >> shift) & (SUB_COUNT - 1));
+        }
 
-            for (auto& sample : _samples)
-            {
-                if (sample.TimestampBegin >= since && sample.Key != "WorkQueue::Enqueue")
-                {
-                    sum += sample.TimestampEnd - sample.TimestampBegin;
-                    count++;
-                }
-            }
+        static uint64_t BinUpper(int bin)
+        {
+            if (bin < SUB_COUNT) return bin;
 
-            if (count <= 0) return {};
-            return sum / count;
+            int shift = bin / SUB_COUNT - 1;
+            uint64_t low = (uint64_t) (SUB_COUNT + bin % SUB_COUNT) << shift;
+            return low + (1ull << shift) - 1;
         }
+    };
 
-        int GetWorkQueueAvgCount(RequestTime since)
-        {
-            LOCK(_samplesLock);
+    // Cardinality estimate of unique strings in fixed 1KiB
+    class HyperLogLog
+    {
+    public:
+        static constexpr int P = 10;
+        static constexpr int M = 1 << P;
 
-            if (_samples.empty())
-                return {};
+        void Add(const std::string& value)
+        {
+            uint64_t hash = Mix(std::hash<std::string>{}(value));
+            auto index = (size_t) (hash >> (64 - P));
 
-            int count = 0;
-            for (auto& sample : _samples)
+            uint8_t rank = 1;
+            uint64_t rest = hash << P;
+            while (rank <= 64 - P && (rest & (1ull << 63)) == 0)
             {
-                if (sample.TimestampBegin >= since && sample.Key == "WorkQueue::Enqueue")
-                    count++;
+                rank++;
+                rest <<= 1;
             }
 
-            return count;
+            _registers[index] = std::max(_registers[index], rank);
         }
 
-        RequestTime GetAvgRequestTime()
+        void Merge(const HyperLogLog& other)
         {
-            return GetAvgRequestTimeSince(RequestTime::min());
+            for (int i = 0; i < M; i++)
+                _registers[i] = std::max(_registers[i], other._registers[i]);
         }
 
-        std::vector<RequestSample> GetTopHeavyTimeSamplesSince(std::size_t limit, RequestTime since)
+        double Estimate() const
         {
-            return GetTopTimeSamplesImpl(limit, since);
+            double sum = 0;
+            int zeros = 0;
+            for (auto reg : _registers)
+            {
+                sum += std::ldexp(1.0, -reg);
+                if (reg == 0) zeros++;
+            }
+
+            double estimate = (0.7213 / (1 + 1.079 / M)) * M * M / sum;
+            if (estimate <= 2.5 * M && zeros > 0)
+                estimate = M * std::log((double) M / zeros);
+
+            return estimate;
         }
 
-        std::vector<RequestSample> GetTopHeavyTimeSamples(std::size_t limit)
+    private:
+        std::array<uint8_t, M> _registers{};
+
+        static uint64_t Mix(uint64_t x)
         {
-            return GetTopHeavyTimeSamplesSince(limit, RequestTime::min());
+            x ^= x >> 30;
+            x *= 0xbf58476d1ce4e5b9ull;
+            x ^= x >> 27;
+            x *= 0x94d049bb133111ebull;
+            x ^= x >> 31;
+            return x;
         }
+    };
+
+    struct RequestKeyStat
+    {
+        LatencyHistogram Time;
+        LatencyHistogram QueueWait;
+        uint64_t InputSize = 0;
+        uint64_t OutputSize = 0;
 
-        std::vector<RequestSample> GetTopHeavyInputSamplesSince(std::size_t limit, RequestTime since)
+        void Merge(const RequestKeyStat& other)
         {
-            return GetTopSizeSamplesImpl(limit, &RequestSample::InputSize, since);
+            Time.Merge(other.Time);
+            QueueWait.Merge(other.QueueWait);
+            InputSize += other.InputSize;
+            OutputSize += other.OutputSize;
         }
+    };
 
-        std::vector<RequestSample> GetTopHeavyInputSamples(std::size_t limit)
+    // Aggregated samples of one time slot
+    struct RequestStatBucket
+    {
+        int64_t Slot = -1;
+        std::map<RequestKey, RequestKeyStat> Keys;
+        // Queue wait by HTTP work queue name
+        std::map<std::string, LatencyHistogram> Queues;
+        HyperLogLog SourceIPs;
+        bool HasSamples = false;
+        RequestSample TopTime;
+        RequestSample TopInput;
+        RequestSample TopOutput;
+
+        void Add(const RequestSample& sample)
         {
-            return GetTopHeavyInputSamplesSince(limit, RequestTime::min());
+            auto& key = Keys[sample.Key];
+            key.Time.Add((sample.TimestampEnd - sample.TimestampBegin).count());
+            key.QueueWait.Add(sample.QueueWait.count());
+            if (!sample.Queue.empty())
+                Queues[sample.Queue].Add(sample.QueueWait.count());
+            key.InputSize += sample.InputSize;
+            key.OutputSize += sample.OutputSize;
+            SourceIPs.Add(sample.SourceIP);
+            AddTop(sample);
         }
 
-        std::vector<RequestSample> GetTopHeavyOutputSamplesSince(std::size_t limit, RequestTime since)
+        void Merge(const RequestStatBucket& other)
         {
-            return GetTopSizeSamplesImpl(limit, &RequestSample::OutputSize, since);
+            for (auto& key : other.Keys)
+                Keys[key.first].Merge(key.second);
+            for (auto& queue : other.Queues)
+                Queues[queue.first].Merge(queue.second);
+
+            SourceIPs.Merge(other.SourceIPs);
+            if (other.HasSamples)
+            {
+                AddTop(other.TopTime);
+                AddTop(other.TopInput);
+                AddTop(other.TopOutput);
+            }
         }
 
-        std::vector<RequestSample> GetTopHeavyOutputSamples(std::size_t limit)
+    private:
+        void AddTop(const RequestSample& sample)
         {
-            return GetTopHeavyOutputSamplesSince(limit, RequestTime::min());
+            if (!HasSamples || sample.TimestampEnd - sample.TimestampBegin > TopTime.TimestampEnd - TopTime.TimestampBegin)
+                TopTime = sample;
+            if (!HasSamples || sample.InputSize > TopInput.InputSize)
+                TopInput = sample;
+            if (!HasSamples || sample.OutputSize > TopOutput.OutputSize)
+                TopOutput = sample;
+            HasSamples = true;
         }
+    };
 
-        std::set<RequestIP> GetUniqueSourceIPsSince(RequestTime since)
+    class RequestStatEngine
+    {
+    public:
+        // Samples are aggregated into slots of BUCKET_TIME,
+        // history is limited to BUCKET_COUNT last slots
+        static constexpr int64_t BUCKET_TIME = 5000;
+        static constexpr int BUCKET_COUNT = 128;
+        // Writers are spread over shards by thread
+        static constexpr int SHARD_COUNT = 8;
+
+        RequestStatEngine() = default;
+        RequestStatEngine(const RequestStatEngine&) = delete;
+
+        void AddSample(const RequestSample& sample)
         {
-            std::set<RequestIP> result{};
+            if (sample.TimestampEnd < sample.TimestampBegin || sample.QueueWait.count() < 0)
+                return;
 
-            LOCK(_samplesLock);
-            for (auto& sample : _samples)
-                if (sample.TimestampBegin >= since)
-                    result.insert(sample.SourceIP);
+            int64_t slot = sample.TimestampBegin.count() / BUCKET_TIME;
+            auto& shard = _shards[std::hash<std::thread::id>{}(std::this_thread::get_id()) % SHARD_COUNT];
 
-            return result;
+            LOCK(shard.Lock);
+            auto& bucket = shard.Buckets[slot % BUCKET_COUNT];
+            if (bucket.Slot != slot)
+            {
+                bucket = RequestStatBucket();
+                bucket.Slot = slot;
+            }
+
+            bucket.Add(sample);
         }
 
-        std::set<RequestIP> GetUniqueSourceIPs()
+        // Merge all slots starting from `since` into one bucket
+        RequestStatBucket AggregateSince(RequestTime since)
         {
-            return GetUniqueSourceIPsSince(RequestTime::min());
+            int64_t sinceSlot = since.count() / BUCKET_TIME;
+            int64_t nowSlot = GetCurrentSystemTime().count() / BUCKET_TIME;
+
+            RequestStatBucket result;
+            for (auto& shard : _shards)
+            {
+                LOCK(shard.Lock);
+                for (auto& bucket : shard.Buckets)
+                {
+                    if (bucket.Slot >= sinceSlot && bucket.Slot > nowSlot - BUCKET_COUNT)
+                        result.Merge(bucket);
+                }
+            }
+
+            return result;
         }
 
         UniValue CompileStatsAsJsonSince(RequestTime since)
         {
             UniValue result{UniValue::VOBJ};
 
-            constexpr auto top_limit = 1;
             const auto sample_to_json = [](const RequestSample& sample)
             {
                 UniValue value{UniValue::VOBJ};
@@ -183,34 +316,21 @@ namespace Statistic
                 value.pushKV("SourceIP", sample.SourceIP);
                 value.pushKV("InputSize", (int) sample.InputSize);
                 value.pushKV("OutputSize", (int) sample.OutputSize);
+                value.pushKV("QueueWait", sample.QueueWait.count());
 
                 return value;
             };
 
-            UniValue unique_ips_json{UniValue::VARR};
-            UniValue top_tm_json{UniValue::VARR};
-            UniValue top_in_json{UniValue::VARR};
-            UniValue top_out_json{UniValue::VARR};
+            auto stat = AggregateSince(since);
 
-            auto unique_ips = GetUniqueSourceIPsSince(since);
-            auto unique_ips_count = unique_ips.size();
-            if (g_logger->WillLogCategory(BCLog::STATDETAIL))
+            // Work queue samples measure waiting, not request processing
+            RequestKeyStat requests;
+            uint64_t requestsCount = 0;
+            for (auto& key : stat.Keys)
             {
-                auto top_tm = GetTopHeavyTimeSamplesSince(top_limit, since);
-                auto top_in = GetTopHeavyInputSamplesSince(top_limit, since);
-                auto top_out = GetTopHeavyOutputSamplesSince(top_limit, since);
-
-                for (auto& ip : unique_ips)
-                    unique_ips_json.push_back(ip);
-
-                for (auto& sample : top_tm)
-                    top_tm_json.push_back(sample_to_json(sample));
-
-                for (auto& sample : top_in)
-                    top_in_json.push_back(sample_to_json(sample));
-
-                for (auto& sample : top_out)
-                    top_out_json.push_back(sample_to_json(sample));
+                requestsCount += key.second.Time.Count();
+                if (key.first != "WorkQueue::Enqueue")
+                    requests.Merge(key.second);
             }
 
             UniValue chainStat(UniValue::VOBJ);
@@ -223,25 +343,166 @@ namespace Statistic
             result.pushKV("General", chainStat);
 
             UniValue sync(UniValue::VOBJ);
-            sync.pushKV("CacheItems", (int64_t) POCKETNET_DATA.size());
-            int64_t cacheSize = 0;
-            for (auto& it : POCKETNET_DATA) cacheSize += it.first.size() + it.second.size();
-            sync.pushKV("CacheSize", cacheSize);
+            auto pocketData = POCKETNET_DATA.GetStats();
+            sync.pushKV("CacheItems", (int64_t) pocketData.items);
+            sync.pushKV("CacheSize", (int64_t) pocketData.memory_usage);
+            sync.pushKV("CacheSpilledItems", (int64_t) pocketData.spilled_items);
+            sync.pushKV("CacheHits", (int64_t) pocketData.hits);
+            sync.pushKV("CacheMisses", (int64_t) pocketData.misses);
+            sync.pushKV("CacheSpills", (int64_t) pocketData.spills);
             result.pushKV("Sync", sync);
 
             UniValue rpcStat(UniValue::VOBJ);
-            rpcStat.pushKV("Requests", (int) GetNumSamplesSince(since));
-            rpcStat.pushKV("AvgReqTime", GetAvgRequestTimeSince(since).count());
-            rpcStat.pushKV("UniqueIPs", (int) unique_ips_count);
+            rpcStat.pushKV("Requests", (int64_t) requestsCount);
+            rpcStat.pushKV("AvgReqTime", (int64_t) requests.Time.Avg());
+            rpcStat.pushKV("P50ReqTime", (int64_t) requests.Time.Percentile(0.5));
+            rpcStat.pushKV("P90ReqTime", (int64_t) requests.Time.Percentile(0.9));
+            rpcStat.pushKV("P99ReqTime", (int64_t) requests.Time.Percentile(0.99));
+            rpcStat.pushKV("MaxReqTime", (int64_t) requests.Time.Max());
+            rpcStat.pushKV("InputSize", (int64_t) requests.InputSize);
+            rpcStat.pushKV("OutputSize", (int64_t) requests.OutputSize);
+            rpcStat.pushKV("UniqueIPs", (int64_t) std::llround(stat.SourceIPs.Estimate()));
             if (g_logger->WillLogCategory(BCLog::STATDETAIL))
             {
-                rpcStat.pushKV("UniqueIps", unique_ips_json);
+                UniValue top_tm_json{UniValue::VARR};
+                UniValue top_in_json{UniValue::VARR};
+                UniValue top_out_json{UniValue::VARR};
+
+                if (stat.HasSamples)
+                {
+                    top_tm_json.push_back(sample_to_json(stat.TopTime));
+                    top_in_json.push_back(sample_to_json(stat.TopInput));
+                    top_out_json.push_back(sample_to_json(stat.TopOutput));
+                }
+
                 rpcStat.pushKV("TopTime", top_tm_json);
                 rpcStat.pushKV("TopInputSize", top_in_json);
                 rpcStat.pushKV("TopOutputSize", top_out_json);
             }
             result.pushKV("RPC", rpcStat);
 
+            UniValue cacheStat(UniValue::VOBJ);
+            auto rpcCache = rpcResponseCache.GetStats();
+            cacheStat.pushKV("Items", (int64_t) rpcCache.items);
+            cacheStat.pushKV("Size", (int64_t) rpcCache.memoryUsage);
+            cacheStat.pushKV("Hits", (int64_t) rpcCache.hits);
+            cacheStat.pushKV("Misses", (int64_t) rpcCache.misses);
+            result.pushKV("Cache", cacheStat);
+
+            UniValue methods(UniValue::VOBJ);
+            for (auto& key : stat.Keys)
+            {
+                auto& time = key.second.Time;
+                auto& wait = key.second.QueueWait;
+
+                UniValue method(UniValue::VOBJ);
+                method.pushKV("Count", (int64_t) time.Count());
+                method.pushKV("AvgTime", (int64_t) time.Avg());
+                method.pushKV("P50Time", (int64_t) time.Percentile(0.5));
+                method.pushKV("P90Time", (int64_t) time.Percentile(0.9));
+                method.pushKV("P99Time", (int64_t) time.Percentile(0.99));
+                method.pushKV("MaxTime", (int64_t) time.Max());
+                method.pushKV("AvgQueueWait", (int64_t) wait.Avg());
+                method.pushKV("P90QueueWait", (int64_t) wait.Percentile(0.9));
+                method.pushKV("P99QueueWait", (int64_t) wait.Percentile(0.99));
+                method.pushKV("InputSize", (int64_t) key.second.InputSize);
+                method.pushKV("OutputSize", (int64_t) key.second.OutputSize);
+                methods.pushKV(key.first, method);
+            }
+            result.pushKV("Methods", methods);
+
+            UniValue queues(UniValue::VOBJ);
+            for (auto& depth : GetHTTPWorkQueueDepths())
+            {
+                auto& wait = stat.Queues[depth.name];
+
+                UniValue queue(UniValue::VOBJ);
+                queue.pushKV("Depth", (int64_t) depth.depth);
+                queue.pushKV("MaxDepth", (int64_t) depth.maxDepth);
+                queue.pushKV("Requests", (int64_t) wait.Count());
+                queue.pushKV("AvgWait", (int64_t) wait.Avg());
+                queue.pushKV("P90Wait", (int64_t) wait.Percentile(0.9));
+                queue.pushKV("P99Wait", (int64_t) wait.Percentile(0.99));
+                queue.pushKV("MaxWait", (int64_t) wait.Max());
+                queues.pushKV(depth.name, queue);
+            }
+            result.pushKV("Queues", queues);
+
+            return result;
+        }
+
+        // Prometheus text exposition format (version 0.0.4).
+        // Values are gauges over the window starting at `since`
+        std::string CompileStatsAsPrometheusSince(RequestTime since)
+        {
+            auto stat = AggregateSince(since);
+            std::string result;
+
+            const auto header = [&result](const std::string& name, const std::string& help)
+            {
+                result += "# HELP " + name + " " + help + "\n";
+                result += "# TYPE " + name + " gauge\n";
+            };
+
+            const auto quantiles = [&result](const std::string& name, const std::string& labels, const LatencyHistogram& hist)
+            {
+                for (double q : {0.5, 0.9, 0.99})
+                    result += strprintf("%s{%s,quantile=\"%g\"} %d\n", name, labels, q, hist.Percentile(q));
+                result += strprintf("%s_sum{%s} %d\n", name, labels, hist.Sum());
+                result += strprintf("%s_count{%s} %d\n", name, labels, hist.Count());
+            };
+
+            header("pocketnet_rpc_requests", "RPC requests executed in window");
+            for (auto& key : stat.Keys)
+                result += strprintf("pocketnet_rpc_requests{method=\"%s\"} %d\n", key.first, key.second.Time.Count());
+
+            result += "# HELP pocketnet_rpc_time_ms RPC execution time in window\n";
+            result += "# TYPE pocketnet_rpc_time_ms summary\n";
+            for (auto& key : stat.Keys)
+                quantiles("pocketnet_rpc_time_ms", strprintf("method=\"%s\"", key.first), key.second.Time);
+
+            result += "# HELP pocketnet_rpc_queue_wait_ms Time in HTTP work queue before execution in window\n";
+            result += "# TYPE pocketnet_rpc_queue_wait_ms summary\n";
+            for (auto& key : stat.Keys)
+                quantiles("pocketnet_rpc_queue_wait_ms", strprintf("method=\"%s\"", key.first), key.second.QueueWait);
+
+            header("pocketnet_rpc_input_bytes", "RPC request payload in window");
+            for (auto& key : stat.Keys)
+                result += strprintf("pocketnet_rpc_input_bytes{method=\"%s\"} %d\n", key.first, key.second.InputSize);
+
+            header("pocketnet_rpc_output_bytes", "RPC response payload in window");
+            for (auto& key : stat.Keys)
+                result += strprintf("pocketnet_rpc_output_bytes{method=\"%s\"} %d\n", key.first, key.second.OutputSize);
+
+            header("pocketnet_rpc_unique_ips", "Estimated unique client addresses in window");
+            result += strprintf("pocketnet_rpc_unique_ips %d\n", std::llround(stat.SourceIPs.Estimate()));
+
+            auto rpcCache = rpcResponseCache.GetStats();
+            header("pocketnet_rpc_cache_items", "Replies in RPC response cache");
+            result += strprintf("pocketnet_rpc_cache_items %d\n", rpcCache.items);
+            header("pocketnet_rpc_cache_bytes", "Memory used by RPC response cache");
+            result += strprintf("pocketnet_rpc_cache_bytes %d\n", rpcCache.memoryUsage);
+            result += "# HELP pocketnet_rpc_cache_hits_total Cacheable RPC requests served from cache\n";
+            result += "# TYPE pocketnet_rpc_cache_hits_total counter\n";
+            result += strprintf("pocketnet_rpc_cache_hits_total %d\n", rpcCache.hits);
+            result += "# HELP pocketnet_rpc_cache_misses_total Cacheable RPC requests executed\n";
+            result += "# TYPE pocketnet_rpc_cache_misses_total counter\n";
+            result += strprintf("pocketnet_rpc_cache_misses_total %d\n", rpcCache.misses);
+
+            auto depths = GetHTTPWorkQueueDepths();
+            header("pocketnet_http_queue_depth", "Requests waiting in HTTP work queue");
+            for (auto& depth : depths)
+                result += strprintf("pocketnet_http_queue_depth{queue=\"%s\"} %d\n", depth.name, depth.depth);
+
+            header("pocketnet_http_queue_max_depth", "Capacity of HTTP work queue");
+            for (auto& depth : depths)
+                result += strprintf("pocketnet_http_queue_max_depth{queue=\"%s\"} %d\n", depth.name, depth.maxDepth);
+
+            result += "# HELP pocketnet_http_queue_wait_ms Time in HTTP work queue in window\n";
+            result += "# TYPE pocketnet_http_queue_wait_ms summary\n";
+            for (auto& depth : depths)
+                quantiles("pocketnet_http_queue_wait_ms", strprintf("queue=\"%s\"", depth.name), stat.Queues[depth.name]);
+
             return result;
         }
 
@@ -281,92 +542,19 @@ namespace Statistic
                 LogPrint(BCLog::STATDETAIL, msg.c_str(), statLoggerSleep / 1000,
                     CompileStatsAsJsonSince(chunkSize).write(1));
 
-                RemoveSamplesBefore(chunkSize);
                 MilliSleep(statLoggerSleep);
             }
         }
 
     private:
-        std::vector<RequestSample> _samples;
-        Mutex _samplesLock;
-        bool shutdown = false;
-
-        void RemoveSamplesBefore(RequestTime time)
+        struct Shard
         {
-            LOCK(_samplesLock);
-            int64_t sizeBefore = _samples.size();
-
-            _samples.erase(
-                std::remove_if(
-                    _samples.begin(),
-                    _samples.end(),
-                    [time](const RequestSample& sample)
-                    {
-                        return sample.TimestampBegin < time;
-                    }),
-                _samples.end());
-
-            LogPrint(BCLog::STAT, "Clear statistic cache: %d -> %d items after.\n", sizeBefore, _samples.size());
-        }
+            Mutex Lock;
+            std::array<RequestStatBucket, BUCKET_COUNT> Buckets;
+        };
 
-        std::vector<RequestSample>
-        GetTopSizeSamplesImpl(std::size_t limit, RequestPayloadSize RequestSample::*size_field, RequestTime since)
-        {
-            LOCK(_samplesLock);
-            auto samples_copy = _samples;
-
-            samples_copy.erase(
-                std::remove_if(
-                    samples_copy.begin(),
-                    samples_copy.end(),
-                    [since](const RequestSample& sample)
-                    {
-                        return sample.TimestampBegin < since;
-                    }),
-                samples_copy.end());
-
-            std::sort(
-                samples_copy.begin(),
-                samples_copy.end(),
-                [limit, size_field](const RequestSample& left, const RequestSample& right)
-                {
-                    return left.*size_field > right.*size_field;
-                });
-
-            if (samples_copy.size() > limit)
-                samples_copy.resize(limit);
-
-            return samples_copy;
-        }
-
-        std::vector<RequestSample> GetTopTimeSamplesImpl(std::size_t limit, RequestTime since)
-        {
-            LOCK(_samplesLock);
-            auto samples_copy = _samples;
-
-            samples_copy.erase(
-                std::remove_if(
-                    samples_copy.begin(),
-                    samples_copy.end(),
-                    [since](const RequestSample& sample)
-                    {
-                        return sample.TimestampBegin < since;
-                    }),
-                samples_copy.end());
-
-            std::sort(
-                samples_copy.begin(),
-                samples_copy.end(),
-                [limit](const RequestSample& left, const RequestSample& right)
-                {
-                    return left.TimestampEnd - left.TimestampBegin > right.TimestampEnd - right.TimestampBegin;
-                });
-
-            if (samples_copy.size() > limit)
-                samples_copy.resize(limit);
-
-            return samples_copy;
-        }
+        std::array<Shard, SHARD_COUNT> _shards;
+        std::atomic<bool> shutdown{false};
     };
 
-} // namespace Statistic
\ No newline at end of file
+} // namespace Statistic
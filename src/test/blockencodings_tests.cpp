@@ -344,4 +344,44 @@ BOOST_AUTO_TEST_CASE(TransactionsRequestSerializationTest) {
     BOOST_CHECK_EQUAL(req1.indexes[3], req2.indexes[3]);
 }
 
+BOOST_AUTO_TEST_CASE(TransactionsRequestPocketIndexesSerializationTest) {
+    BlockTransactionsRequest req1;
+    req1.blockhash = InsecureRand256();
+    req1.indexes = {0, 2, 7};
+    req1.pocketIndexes = {1, 3, 4, 300};
+
+    // Pocket indexes are sent since POCKET_COMPACT_DATA_VERSION
+    CDataStream stream(SER_NETWORK, POCKET_COMPACT_DATA_VERSION);
+    stream << req1;
+
+    BlockTransactionsRequest req2;
+    stream >> req2;
+
+    BOOST_CHECK(stream.empty());
+    BOOST_CHECK_EQUAL(req1.blockhash.ToString(), req2.blockhash.ToString());
+    BOOST_CHECK(req1.indexes == req2.indexes);
+    BOOST_CHECK(req1.pocketIndexes == req2.pocketIndexes);
+
+    // Older peers get only indexes, message is same as before
+    CDataStream streamOld(SER_NETWORK, POCKET_COMPACT_DATA_VERSION - 1);
+    streamOld << req1;
+
+    BlockTransactionsRequest reqPlain;
+    reqPlain.blockhash = req1.blockhash;
+    reqPlain.indexes = req1.indexes;
+    CDataStream streamPlain(SER_NETWORK, POCKET_COMPACT_DATA_VERSION);
+    streamPlain << reqPlain;
+    streamPlain.resize(streamPlain.size() - 1); // empty pocketIndexes
+
+    BOOST_CHECK(std::vector<char>(streamOld.begin(), streamOld.end()) == std::vector<char>(streamPlain.begin(), streamPlain.end()));
+
+    BlockTransactionsRequest req3;
+    streamOld >> req3;
+
+    BOOST_CHECK(streamOld.empty());
+    BOOST_CHECK_EQUAL(req1.blockhash.ToString(), req3.blockhash.ToString());
+    BOOST_CHECK(req1.indexes == req3.indexes);
+    BOOST_CHECK(req3.pocketIndexes.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,197 @@
+// Copyright (c) 2018 PocketNet developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <pocketdb/pocketdata.h>
+#include <streams.h>
+#include <test/test_pocketcoin.h>
+#include <univalue.h>
+#include <utilstrencodings.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+
+BOOST_FIXTURE_TEST_SUITE(pocketdata_tests, BasicTestingSetup)
+
+static PocketTxData MakeTxData(const std::string& table, const std::string& data)
+{
+    PocketTxData tx_data;
+    tx_data.table = table;
+    tx_data.data = data;
+    return tx_data;
+}
+
+static PocketBlockData MakeBlockData()
+{
+    PocketBlockData data;
+    data.emplace(uint256S("01"), MakeTxData("Posts", "{\"txid\":\"01\",\"caption\":\"\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82\"}"));
+    data.emplace(uint256S("02"), MakeTxData("Scores", "{\"txid\":\"02\",\"value\":5}"));
+    return data;
+}
+
+static bool Equal(const PocketTxData& a, const PocketTxData& b)
+{
+    return a.table == b.table && a.data == b.data;
+}
+
+static bool Equal(const PocketBlockData& a, const PocketBlockData& b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const PocketBlockData::value_type& x, const PocketBlockData::value_type& y) {
+        return x.first == y.first && Equal(x.second, y.second);
+    });
+}
+
+BOOST_AUTO_TEST_CASE(legacy_tx_roundtrip)
+{
+    const char raw[] = "{\"msg\":\"a\\nb\"}\0\xff";
+    PocketTxData data = MakeTxData("Comment", std::string(raw, sizeof(raw) - 1));
+
+    PocketTxData decoded;
+    BOOST_CHECK(DecodePocketDataLegacy(EncodePocketDataLegacy(data), decoded));
+    BOOST_CHECK(Equal(decoded, data));
+
+    BOOST_CHECK_EQUAL(EncodePocketDataLegacy(PocketTxData()), "");
+}
+
+BOOST_AUTO_TEST_CASE(legacy_block_roundtrip)
+{
+    PocketBlockData data = MakeBlockData();
+
+    PocketBlockData decoded;
+    BOOST_CHECK(DecodePocketDataLegacy(EncodePocketDataLegacy(data), decoded));
+    BOOST_CHECK(Equal(decoded, data));
+
+    BOOST_CHECK_EQUAL(EncodePocketDataLegacy(PocketBlockData()), "");
+}
+
+BOOST_AUTO_TEST_CASE(legacy_decode_invalid)
+{
+    PocketTxData tx_data;
+    BOOST_CHECK(!DecodePocketDataLegacy("", tx_data));
+    BOOST_CHECK(!DecodePocketDataLegacy("not json", tx_data));
+    BOOST_CHECK(!DecodePocketDataLegacy("[\"Posts\"]", tx_data));
+    BOOST_CHECK(!DecodePocketDataLegacy("{\"t\":\"Posts\"}", tx_data));
+    BOOST_CHECK(!DecodePocketDataLegacy("{\"t\":1,\"d\":\"\"}", tx_data));
+
+    PocketBlockData block_data;
+    BOOST_CHECK(!DecodePocketDataLegacy("{\"01\":1}", block_data));
+    BOOST_CHECK(!DecodePocketDataLegacy("{\"01\":\"not json\"}", block_data));
+}
+
+/* Old nodes relay items of RIMempool wrapped in "Mempool" table */
+BOOST_AUTO_TEST_CASE(legacy_mempool_unwrap)
+{
+    std::string item = "{\"txid\":\"01\",\"score\":5}";
+
+    UniValue mempool(UniValue::VOBJ);
+    mempool.pushKV("table", "Scores");
+    mempool.pushKV("data", EncodeBase64(item));
+
+    UniValue wrapped(UniValue::VOBJ);
+    wrapped.pushKV("t", "Mempool");
+    wrapped.pushKV("d", EncodeBase64(mempool.write()));
+
+    PocketTxData tx_data;
+    BOOST_CHECK(DecodePocketDataLegacy(wrapped.write(), tx_data));
+    BOOST_CHECK(Equal(tx_data, MakeTxData("Scores", item)));
+
+    // Wrapper of block item is unwrapped too
+    UniValue block(UniValue::VOBJ);
+    block.pushKV(uint256S("01").GetHex(), wrapped.write());
+
+    PocketBlockData block_data;
+    BOOST_CHECK(DecodePocketDataLegacy(block.write(), block_data));
+    BOOST_CHECK_EQUAL(block_data.size(), 1U);
+    BOOST_CHECK(Equal(block_data[uint256S("01")], MakeTxData("Scores", item)));
+
+    // Wrapper without table or data
+    UniValue broken(UniValue::VOBJ);
+    broken.pushKV("t", "Mempool");
+    broken.pushKV("d", EncodeBase64("{\"data\":\"\"}"));
+    BOOST_CHECK(!DecodePocketDataLegacy(broken.write(), tx_data));
+}
+
+BOOST_AUTO_TEST_CASE(wire_legacy_below_binary_version)
+{
+    const int version = POCKET_DATA_BINARY_VERSION - 1;
+    PocketBlockData data = MakeBlockData();
+
+    CDataStream ss(SER_NETWORK, version);
+    ss << PocketDataWire<PocketBlockData>(data, version);
+
+    // Legacy peers get base64 JSON string
+    CDataStream copy(ss);
+    std::string legacy;
+    copy >> legacy;
+    BOOST_CHECK_EQUAL(legacy, EncodePocketDataLegacy(data));
+    BOOST_CHECK(copy.empty());
+
+    PocketBlockData read;
+    BOOST_CHECK(ReadPocketDataWire(ss, version, read));
+    BOOST_CHECK(Equal(read, data));
+
+    // Transaction data
+    PocketTxData tx_data = MakeTxData("Posts", "{}");
+    CDataStream ss_tx(SER_NETWORK, version);
+    ss_tx << PocketDataWire<PocketTxData>(tx_data, version);
+
+    PocketTxData read_tx;
+    BOOST_CHECK(ReadPocketDataWire(ss_tx, version, read_tx));
+    BOOST_CHECK(Equal(read_tx, tx_data));
+}
+
+BOOST_AUTO_TEST_CASE(wire_binary_since_binary_version)
+{
+    for (int version : {POCKET_DATA_BINARY_VERSION, PROTOCOL_VERSION}) {
+        PocketBlockData data = MakeBlockData();
+
+        CDataStream ss(SER_NETWORK, version);
+        ss << PocketDataWire<PocketBlockData>(data, version);
+
+        // Structure serialized as is
+        CDataStream expected(SER_NETWORK, version);
+        expected << data;
+        BOOST_CHECK(ss.str() == expected.str());
+
+        PocketBlockData read;
+        BOOST_CHECK(ReadPocketDataWire(ss, version, read));
+        BOOST_CHECK(Equal(read, data));
+        BOOST_CHECK(ss.empty());
+
+        PocketTxData tx_data = MakeTxData("Posts", std::string("\0\x01", 2));
+        CDataStream ss_tx(SER_NETWORK, version);
+        ss_tx << PocketDataWire<PocketTxData>(tx_data, version);
+
+        PocketTxData read_tx;
+        BOOST_CHECK(ReadPocketDataWire(ss_tx, version, read_tx));
+        BOOST_CHECK(Equal(read_tx, tx_data));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(wire_read_empty_and_invalid)
+{
+    // Message without pocket data
+    CDataStream empty(SER_NETWORK, PROTOCOL_VERSION);
+    PocketBlockData read = MakeBlockData();
+    BOOST_CHECK(ReadPocketDataWire(empty, PROTOCOL_VERSION, read));
+    BOOST_CHECK(Equal(read, MakeBlockData()));
+
+    // Empty legacy string
+    const int version = POCKET_DATA_BINARY_VERSION - 1;
+    CDataStream ss_empty(SER_NETWORK, version);
+    ss_empty << std::string();
+    PocketBlockData read_empty;
+    BOOST_CHECK(ReadPocketDataWire(ss_empty, version, read_empty));
+    BOOST_CHECK(read_empty.empty());
+
+    // Undecodable legacy string leaves no partial data
+    CDataStream ss_invalid(SER_NETWORK, version);
+    ss_invalid << std::string("{\"01\":\"not json\"}");
+    PocketBlockData read_invalid = MakeBlockData();
+    BOOST_CHECK(!ReadPocketDataWire(ss_invalid, version, read_invalid));
+    BOOST_CHECK(read_invalid.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
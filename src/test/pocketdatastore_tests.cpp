@@ -0,0 +1,258 @@
+// Copyright (c) 2018 PocketNet developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <pocketdb/pocketdata.h>
+#include <test/test_pocketcoin.h>
+#include <tinyformat.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pocketdatastore_tests, BasicTestingSetup)
+
+static uint256 BlockHash(int n)
+{
+    return uint256S(strprintf("b%x", n));
+}
+
+static uint256 TxHash(int n)
+{
+    return uint256S(strprintf("%x", n));
+}
+
+/* Blocks of same shape have same memory usage */
+static PocketBlockData MakeBlock(int n, int txs = 4)
+{
+    PocketBlockData data;
+    for (int i = 0; i < txs; i++) {
+        PocketTxData tx_data;
+        tx_data.table = "Posts";
+        tx_data.data = std::string(1000, 'a' + (n + i) % 26);
+        data.emplace(TxHash(n * 100 + i), tx_data);
+    }
+    return data;
+}
+
+static bool Equal(const std::shared_ptr<const PocketBlockData>& a, const PocketBlockData& b)
+{
+    if (!a || a->size() != b.size()) return false;
+    for (const auto& it : b) {
+        auto found = a->find(it.first);
+        if (found == a->end() || found->second.table != it.second.table || found->second.data != it.second.data) return false;
+    }
+    return true;
+}
+
+/* Memory usage of one block from MakeBlock */
+static size_t BlockUsage(const fs::path& path)
+{
+    PocketDataStore store;
+    store.Init(path, 1 << 20, 1 << 20);
+    store.Put(BlockHash(0), MakeBlock(0));
+    size_t usage = store.GetStats().memory_usage;
+    store.Close();
+    return usage;
+}
+
+BOOST_AUTO_TEST_CASE(lru_spill_and_get)
+{
+    fs::path ph = SetDataDir("pocketdatastore_lru");
+    size_t usage = BlockUsage(ph / "usage");
+    BOOST_CHECK(usage > 0);
+
+    PocketDataStore store;
+    store.Init(ph / "store", usage * 5 / 2, usage * 10);
+
+    store.Put(BlockHash(1), MakeBlock(1));
+    store.Put(BlockHash(2), MakeBlock(2));
+    BOOST_CHECK(Equal(store.Get(BlockHash(1)), MakeBlock(1)));
+
+    // Block 2 is least recently used
+    store.Put(BlockHash(3), MakeBlock(3));
+    PocketDataStats stats = store.GetStats();
+    BOOST_CHECK_EQUAL(stats.items, 3U);
+    BOOST_CHECK_EQUAL(stats.spilled_items, 1U);
+    BOOST_CHECK_EQUAL(stats.spills, 1U);
+    BOOST_CHECK_EQUAL(stats.memory_usage, usage * 2);
+    BOOST_CHECK_EQUAL(stats.spilled_usage, usage);
+
+    // Spilled block is loaded back, block 1 is least recently used now
+    BOOST_CHECK(Equal(store.Get(BlockHash(2)), MakeBlock(2)));
+    stats = store.GetStats();
+    BOOST_CHECK_EQUAL(stats.items, 3U);
+    BOOST_CHECK_EQUAL(stats.spilled_items, 1U);
+    BOOST_CHECK_EQUAL(stats.spills, 2U);
+    BOOST_CHECK_EQUAL(stats.memory_usage, usage * 2);
+
+    for (int n = 1; n <= 3; n++)
+        BOOST_CHECK(Equal(store.Get(BlockHash(n)), MakeBlock(n)));
+
+    BOOST_CHECK(!store.Get(BlockHash(4)));
+    stats = store.GetStats();
+    BOOST_CHECK_EQUAL(stats.hits, 5U);
+    BOOST_CHECK_EQUAL(stats.misses, 1U);
+    BOOST_CHECK_EQUAL(stats.drops, 0U);
+
+    store.Close();
+}
+
+BOOST_AUTO_TEST_CASE(most_recent_kept_over_limit)
+{
+    fs::path ph = SetDataDir("pocketdatastore_recent");
+
+    PocketDataStore store;
+    store.Init(ph, 0, 1 << 20);
+
+    store.Put(BlockHash(1), MakeBlock(1));
+    BOOST_CHECK_EQUAL(store.GetStats().spilled_items, 0U);
+    BOOST_CHECK(Equal(store.Get(BlockHash(1)), MakeBlock(1)));
+
+    store.Put(BlockHash(2), MakeBlock(2));
+    PocketDataStats stats = store.GetStats();
+    BOOST_CHECK_EQUAL(stats.items, 2U);
+    BOOST_CHECK_EQUAL(stats.spilled_items, 1U);
+    BOOST_CHECK(Equal(store.Get(BlockHash(1)), MakeBlock(1)));
+    BOOST_CHECK(Equal(store.Get(BlockHash(2)), MakeBlock(2)));
+
+    store.Close();
+}
+
+BOOST_AUTO_TEST_CASE(erase_after_spill)
+{
+    fs::path ph = SetDataDir("pocketdatastore_erase");
+    size_t usage = BlockUsage(ph / "usage");
+
+    PocketDataStore store;
+    store.Init(ph / "store", usage * 3 / 2, usage * 10);
+
+    store.Put(BlockHash(1), MakeBlock(1));
+    store.Put(BlockHash(2), MakeBlock(2));
+    BOOST_CHECK_EQUAL(store.GetStats().spilled_items, 1U);
+
+    // Spilled block
+    store.Erase(BlockHash(1));
+    PocketDataStats stats = store.GetStats();
+    BOOST_CHECK_EQUAL(stats.items, 1U);
+    BOOST_CHECK_EQUAL(stats.spilled_items, 0U);
+    BOOST_CHECK_EQUAL(stats.spilled_usage, 0U);
+    BOOST_CHECK(!store.Get(BlockHash(1)));
+
+    // Block in memory
+    store.Erase(BlockHash(2));
+    stats = store.GetStats();
+    BOOST_CHECK_EQUAL(stats.items, 0U);
+    BOOST_CHECK_EQUAL(stats.memory_usage, 0U);
+    BOOST_CHECK(!store.Get(BlockHash(2)));
+
+    // Erased block can be staged again
+    store.Put(BlockHash(1), MakeBlock(1));
+    BOOST_CHECK(Equal(store.Get(BlockHash(1)), MakeBlock(1)));
+
+    store.Close();
+}
+
+BOOST_AUTO_TEST_CASE(spill_limit_drops_oldest)
+{
+    fs::path ph = SetDataDir("pocketdatastore_drop");
+    size_t usage = BlockUsage(ph / "usage");
+
+    PocketDataStore store;
+    store.Init(ph / "store", usage * 3 / 2, usage * 5 / 2);
+
+    // Blocks 1 and 2 spilled, spilling block 3 drops block 1
+    for (int n = 1; n <= 4; n++)
+        store.Put(BlockHash(n), MakeBlock(n));
+
+    PocketDataStats stats = store.GetStats();
+    BOOST_CHECK_EQUAL(stats.items, 3U);
+    BOOST_CHECK_EQUAL(stats.spilled_items, 2U);
+    BOOST_CHECK_EQUAL(stats.spills, 3U);
+    BOOST_CHECK_EQUAL(stats.drops, 1U);
+    BOOST_CHECK(stats.spilled_usage <= usage * 5 / 2);
+
+    BOOST_CHECK(!store.Get(BlockHash(1)));
+    for (int n = 2; n <= 4; n++)
+        BOOST_CHECK(Equal(store.Get(BlockHash(n)), MakeBlock(n)));
+
+    store.Close();
+}
+
+BOOST_AUTO_TEST_CASE(spill_limit_drops_large_block)
+{
+    fs::path ph = SetDataDir("pocketdatastore_large");
+    size_t usage = BlockUsage(ph / "usage");
+
+    PocketDataStore store;
+    store.Init(ph / "store", usage * 3 / 2, usage / 2);
+
+    // Block does not fit spill limit at all
+    store.Put(BlockHash(1), MakeBlock(1));
+    store.Put(BlockHash(2), MakeBlock(2));
+
+    PocketDataStats stats = store.GetStats();
+    BOOST_CHECK_EQUAL(stats.items, 1U);
+    BOOST_CHECK_EQUAL(stats.spilled_items, 0U);
+    BOOST_CHECK_EQUAL(stats.drops, 1U);
+    BOOST_CHECK(!store.Get(BlockHash(1)));
+    BOOST_CHECK(Equal(store.Get(BlockHash(2)), MakeBlock(2)));
+
+    store.Close();
+}
+
+BOOST_AUTO_TEST_CASE(put_merges_staged)
+{
+    fs::path ph = SetDataDir("pocketdatastore_merge");
+
+    PocketDataStore store;
+    store.Init(ph, 1 << 20, 1 << 20);
+
+    PocketBlockData first = MakeBlock(1, 2);
+    store.Put(BlockHash(1), PocketBlockData(first));
+
+    // Only known transactions - staged data kept
+    PocketBlockData changed = first;
+    changed.begin()->second.data = "changed";
+    store.Put(BlockHash(1), std::move(changed));
+    BOOST_CHECK(Equal(store.Get(BlockHash(1)), first));
+
+    // New transactions complete staged data
+    PocketBlockData second = MakeBlock(2, 2);
+    store.Put(BlockHash(1), PocketBlockData(second));
+
+    PocketBlockData merged = first;
+    merged.insert(second.begin(), second.end());
+    BOOST_CHECK(Equal(store.Get(BlockHash(1)), merged));
+    BOOST_CHECK_EQUAL(store.GetStats().items, 1U);
+
+    store.Close();
+}
+
+BOOST_AUTO_TEST_CASE(put_merges_spilled)
+{
+    fs::path ph = SetDataDir("pocketdatastore_merge_spilled");
+    size_t usage = BlockUsage(ph / "usage");
+
+    PocketDataStore store;
+    store.Init(ph / "store", usage * 3 / 2, usage * 10);
+
+    store.Put(BlockHash(1), MakeBlock(1));
+    store.Put(BlockHash(2), MakeBlock(2));
+    BOOST_CHECK_EQUAL(store.GetStats().spilled_items, 1U);
+
+    // Data of spilled block completed with new transactions
+    PocketBlockData more = MakeBlock(3, 1);
+    store.Put(BlockHash(1), PocketBlockData(more));
+
+    PocketBlockData merged = MakeBlock(1);
+    merged.insert(more.begin(), more.end());
+    BOOST_CHECK(Equal(store.Get(BlockHash(1)), merged));
+
+    PocketDataStats stats = store.GetStats();
+    BOOST_CHECK_EQUAL(stats.items, 2U);
+    BOOST_CHECK_EQUAL(stats.spilled_items, 1U);
+    BOOST_CHECK(Equal(store.Get(BlockHash(2)), MakeBlock(2)));
+
+    store.Close();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
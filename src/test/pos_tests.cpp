@@ -0,0 +1,60 @@
+// Copyright (c) 2018 PocketNet developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <pos.h>
+#include <streams.h>
+#include <test/test_pocketcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pos_tests, BasicTestingSetup)
+
+static CDataStream LotterySource()
+{
+    CDataStream source(SER_GETHASH, 0);
+    source << std::string("pocketnet lottery");
+    return source;
+}
+
+/* Order of winners is consensus - must not change for same candidates */
+BOOST_AUTO_TEST_CASE(lottery_winners_order)
+{
+    std::map<std::string, int> ratings = {
+        {"PAddressA", 1}, {"PAddressB", 2}, {"PAddressC", 3},
+        {"PAddressD", 1}, {"PAddressE", 5}, {"PAddressF", 2},
+    };
+
+    std::vector<std::string> winners;
+    SelectLotteryWinners(ratings, LotterySource(), winners);
+
+    std::vector<std::string> expected = {"PAddressC", "PAddressF", "PAddressE", "PAddressB", "PAddressD", "PAddressA"};
+    BOOST_CHECK(winners == expected);
+
+    // Same candidates, same winners
+    std::vector<std::string> again;
+    SelectLotteryWinners(ratings, LotterySource(), again);
+    BOOST_CHECK(again == winners);
+}
+
+BOOST_AUTO_TEST_CASE(lottery_winners_limit)
+{
+    std::map<std::string, int> ratings;
+    for (int i = 0; i < 30; i++)
+        ratings[strprintf("PAddress%02d", i)] = (i % 4) + 1;
+
+    std::vector<std::string> winners;
+    SelectLotteryWinners(ratings, LotterySource(), winners);
+    BOOST_CHECK_EQUAL(winners.size(), 25U);
+
+    BOOST_CHECK_EQUAL(winners.front(), "PAddress01");
+    BOOST_CHECK_EQUAL(winners.back(), "PAddress21");
+    for (const char* loser : {"PAddress25", "PAddress20", "PAddress08", "PAddress24", "PAddress04"})
+        BOOST_CHECK(std::find(winners.begin(), winners.end(), loser) == winners.end());
+
+    std::vector<std::string> none;
+    SelectLotteryWinners({}, LotterySource(), none);
+    BOOST_CHECK(none.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
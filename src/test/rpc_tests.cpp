@@ -16,6 +16,10 @@
 
 #include <univalue.h>
 
+#include <mutex>
+#include <set>
+#include <thread>
+
 #include <rpc/blockchain.h>
 
 UniValue CallRPC(std::string args)
@@ -416,4 +420,176 @@ BOOST_AUTO_TEST_CASE(rpc_getblockstats_calculate_percentiles_by_weight)
     }
 }
 
+BOOST_AUTO_TEST_CASE(rpc_response_cache_tip)
+{
+    CRPCResponseCache cache;
+    BOOST_CHECK(!cache.IsEnabled());
+    cache.SetMaxSize(1 << 20);
+    BOOST_CHECK(cache.IsEnabled());
+
+    JSONRPCRequest request;
+    request.strMethod = "gethotposts";
+    request.params = UniValue(UniValue::VARR);
+    request.params.push_back(10);
+    std::string key = CRPCResponseCache::Key(request);
+
+    uint256 tip1 = InsecureRand256();
+    uint256 tip2 = InsecureRand256();
+    cache.SetTip(tip1);
+    BOOST_CHECK(cache.GetTip() == tip1);
+
+    std::string result;
+    BOOST_CHECK(!cache.Get(tip1, key, result));
+    cache.Put(tip1, key, "[1]");
+    BOOST_CHECK(cache.Get(tip1, key, result));
+    BOOST_CHECK_EQUAL(result, "[1]");
+
+    // Other params are other entry
+    request.params.push_back(20);
+    BOOST_CHECK(!cache.Get(tip1, CRPCResponseCache::Key(request), result));
+
+    // Same tip keeps entries
+    cache.SetTip(tip1);
+    BOOST_CHECK(cache.Get(tip1, key, result));
+
+    // New tip drops all entries
+    cache.SetTip(tip2);
+    BOOST_CHECK(cache.GetTip() == tip2);
+    BOOST_CHECK(!cache.Get(tip2, key, result));
+    BOOST_CHECK(!cache.Get(tip1, key, result));
+    BOOST_CHECK_EQUAL(cache.GetStats().items, 0U);
+    BOOST_CHECK_EQUAL(cache.GetStats().memoryUsage, 0U);
+
+    // Result computed at old tip is not cached
+    cache.Put(tip1, key, "[1]");
+    BOOST_CHECK(!cache.Get(tip2, key, result));
+    BOOST_CHECK_EQUAL(cache.GetStats().items, 0U);
+
+    cache.Put(tip2, key, "[2]");
+    BOOST_CHECK(cache.Get(tip2, key, result));
+    BOOST_CHECK_EQUAL(result, "[2]");
+
+    // Disabled cache keeps nothing
+    cache.SetMaxSize(0);
+    BOOST_CHECK(!cache.IsEnabled());
+    BOOST_CHECK_EQUAL(cache.GetStats().items, 0U);
+    cache.Put(tip2, key, "[2]");
+    BOOST_CHECK(!cache.Get(tip2, key, result));
+}
+
+static UniValue BatchElement(const std::string& method, int id)
+{
+    UniValue req(UniValue::VOBJ);
+    req.pushKV("method", method);
+    req.pushKV("params", UniValue(UniValue::VARR));
+    req.pushKV("id", id);
+    return req;
+}
+
+static std::mutex cs_batch_threads;
+static std::set<std::thread::id> batch_threads;
+
+// Read-only element slow enough for executor lanes to take part in batch
+static UniValue testbatchelement(const JSONRPCRequest& request)
+{
+    {
+        std::lock_guard<std::mutex> lock(cs_batch_threads);
+        batch_threads.insert(std::this_thread::get_id());
+    }
+    MilliSleep(20);
+    return request.id;
+}
+
+static const CRPCCommand testBatchCommand = {"test", "testbatchelement", &testbatchelement, {}, false, true};
+
+BOOST_AUTO_TEST_CASE(rpc_batch_readonly)
+{
+    BOOST_CHECK(JSONRPCIsReadOnly(BatchElement("gettime", 0)));
+    BOOST_CHECK(!JSONRPCIsReadOnly(BatchElement("sendrawtransactionwithmessage", 0)));
+    BOOST_CHECK(!JSONRPCIsReadOnly(BatchElement("setmocktime", 0)));
+
+    // Malformed and unknown elements only fail
+    BOOST_CHECK(JSONRPCIsReadOnly(BatchElement("nosuchmethod", 0)));
+    BOOST_CHECK(JSONRPCIsReadOnly(UniValue(UniValue::VOBJ)));
+    BOOST_CHECK(JSONRPCIsReadOnly(UniValue(1)));
+
+    // Results of parallel batch keep order of requests, DEFAULT_RPC_BATCH_PARALLEL > 1
+    JSONRPCRequest jreq;
+    UniValue batch(UniValue::VARR);
+    for (int i = 0; i < 8; i++)
+        batch.push_back(BatchElement("nosuchmethod", i));
+
+    UniValue reply;
+    BOOST_CHECK(reply.read(JSONRPCExecBatch(jreq, batch)));
+    BOOST_CHECK_EQUAL(reply.size(), 8U);
+    for (int i = 0; i < 8; i++) {
+        BOOST_CHECK_EQUAL(find_value(reply[i], "id").get_int(), i);
+        BOOST_CHECK_EQUAL(find_value(find_value(reply[i], "error"), "code").get_int(), RPC_METHOD_NOT_FOUND);
+    }
+
+    // Batch with state changing element runs in order
+    batch.push_back(BatchElement("setmocktime", 8));
+    BOOST_CHECK(!JSONRPCIsReadOnly(batch[8]));
+    BOOST_CHECK(reply.read(JSONRPCExecBatch(jreq, batch)));
+    BOOST_CHECK_EQUAL(reply.size(), 9U);
+    for (int i = 0; i < 9; i++)
+        BOOST_CHECK_EQUAL(find_value(reply[i], "id").get_int(), i);
+
+    // Elements executed on executor lanes are returned in order
+    tableRPC.appendCommand(testBatchCommand.name, &testBatchCommand);
+    BOOST_CHECK(JSONRPCIsReadOnly(BatchElement("testbatchelement", 0)));
+
+    StartRPC();
+    batch = UniValue(UniValue::VARR);
+    for (int i = 0; i < 16; i++)
+        batch.push_back(BatchElement("testbatchelement", i));
+
+    batch_threads.clear();
+    BOOST_CHECK(reply.read(JSONRPCExecBatch(jreq, batch)));
+    InterruptRPC();
+    StopRPC();
+
+    BOOST_CHECK_EQUAL(reply.size(), 16U);
+    for (int i = 0; i < 16; i++) {
+        BOOST_CHECK(find_value(reply[i], "error").isNull());
+        BOOST_CHECK_EQUAL(find_value(reply[i], "result").get_int(), i);
+    }
+
+    // Caller and at least one lane
+    BOOST_CHECK(batch_threads.size() > 1);
+    BOOST_CHECK(batch_threads.count(std::this_thread::get_id()));
+}
+
+BOOST_AUTO_TEST_CASE(rpc_batch_cached)
+{
+    // Cacheable element of batch is served from cache, not executed
+    JSONRPCRequest request;
+    request.strMethod = "gethotposts";
+    request.params = UniValue(UniValue::VARR);
+
+    rpcResponseCache.SetMaxSize(1 << 20);
+    uint256 tip = rpcResponseCache.GetTip();
+    rpcResponseCache.Put(tip, CRPCResponseCache::Key(request), "[\"cached\"]");
+    uint64_t hits = rpcResponseCache.GetStats().hits;
+
+    JSONRPCRequest jreq;
+    UniValue batch(UniValue::VARR);
+    batch.push_back(BatchElement("gethotposts", 0));
+    batch.push_back(BatchElement("nosuchmethod", 1));
+
+    UniValue reply;
+    BOOST_CHECK(reply.read(JSONRPCExecBatch(jreq, batch)));
+    BOOST_CHECK_EQUAL(reply.size(), 2U);
+    BOOST_CHECK_EQUAL(find_value(reply[0], "id").get_int(), 0);
+    BOOST_CHECK(find_value(reply[0], "error").isNull());
+    BOOST_CHECK_EQUAL(find_value(reply[0], "result")[0].get_str(), "cached");
+    BOOST_CHECK_EQUAL(find_value(find_value(reply[1], "error"), "code").get_int(), RPC_METHOD_NOT_FOUND);
+    BOOST_CHECK_EQUAL(rpcResponseCache.GetStats().hits, hits + 1);
+
+    // Same reply as singleton request
+    BOOST_CHECK_EQUAL(tableRPC.executeCached(request), "[\"cached\"]");
+
+    rpcResponseCache.SetMaxSize(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
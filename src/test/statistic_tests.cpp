@@ -0,0 +1,157 @@
+// Copyright (c) 2018 PocketNet developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <statistic.hpp>
+#include <random.h>
+#include <test/test_pocketcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using Statistic::HyperLogLog;
+using Statistic::LatencyHistogram;
+
+BOOST_FIXTURE_TEST_SUITE(statistic_tests, BasicTestingSetup)
+
+static const std::vector<double> PERCENTILES = {0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 0.999, 1.0};
+
+/* Percentile of histogram is not below exact value and exceeds it by less than 1/SUB_COUNT */
+static void CheckPercentiles(const LatencyHistogram& hist, std::vector<uint64_t> values)
+{
+    std::sort(values.begin(), values.end());
+    for (double p : PERCENTILES) {
+        uint64_t exact = values[std::max<size_t>((size_t) std::ceil(p * values.size()), 1) - 1];
+        uint64_t value = hist.Percentile(p);
+        BOOST_CHECK_MESSAGE(value >= exact, "p" << p << " " << value << " < " << exact);
+        BOOST_CHECK_MESSAGE((value - exact) * LatencyHistogram::SUB_COUNT <= exact, "p" << p << " " << value << " too far from " << exact);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(latency_histogram_empty)
+{
+    LatencyHistogram hist;
+    BOOST_CHECK_EQUAL(hist.Count(), 0U);
+    BOOST_CHECK_EQUAL(hist.Avg(), 0U);
+    BOOST_CHECK_EQUAL(hist.Max(), 0U);
+    BOOST_CHECK_EQUAL(hist.Percentile(0.5), 0U);
+    BOOST_CHECK_EQUAL(hist.Percentile(1.0), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(latency_histogram_small_values_exact)
+{
+    LatencyHistogram hist;
+    for (uint64_t v = 0; v < LatencyHistogram::SUB_COUNT; v++)
+        hist.Add(v);
+
+    for (uint64_t v = 0; v < LatencyHistogram::SUB_COUNT; v++)
+        BOOST_CHECK_EQUAL(hist.Percentile(1.0 * (v + 1) / LatencyHistogram::SUB_COUNT), v);
+
+    BOOST_CHECK_EQUAL(hist.Count(), (uint64_t) LatencyHistogram::SUB_COUNT);
+    BOOST_CHECK_EQUAL(hist.Max(), (uint64_t) LatencyHistogram::SUB_COUNT - 1);
+}
+
+BOOST_AUTO_TEST_CASE(latency_histogram_percentile_error)
+{
+    // Uniform range
+    LatencyHistogram uniform;
+    std::vector<uint64_t> uniformValues;
+    for (uint64_t v = 1; v <= 100000; v++) {
+        uniform.Add(v);
+        uniformValues.push_back(v);
+    }
+    CheckPercentiles(uniform, uniformValues);
+    BOOST_CHECK_EQUAL(uniform.Percentile(1.0), 100000U);
+
+    // Long tail over all bins
+    FastRandomContext rng(true);
+    LatencyHistogram tail;
+    std::vector<uint64_t> tailValues;
+    for (int i = 0; i < 20000; i++) {
+        uint64_t v = rng.randbits(rng.randrange(LatencyHistogram::MAX_BITS) + 1);
+        tail.Add(v);
+        tailValues.push_back(v);
+    }
+    CheckPercentiles(tail, tailValues);
+
+    uint64_t sum = 0;
+    for (auto v : tailValues)
+        sum += v;
+    BOOST_CHECK_EQUAL(tail.Count(), tailValues.size());
+    BOOST_CHECK_EQUAL(tail.Sum(), sum);
+    BOOST_CHECK_EQUAL(tail.Avg(), sum / tailValues.size());
+    BOOST_CHECK_EQUAL(tail.Max(), *std::max_element(tailValues.begin(), tailValues.end()));
+}
+
+BOOST_AUTO_TEST_CASE(latency_histogram_merge)
+{
+    FastRandomContext rng(true);
+    LatencyHistogram first, second, all;
+    std::vector<uint64_t> values;
+    for (int i = 0; i < 10000; i++) {
+        uint64_t v = rng.randrange(5000);
+        (i % 3 ? first : second).Add(v);
+        all.Add(v);
+        values.push_back(v);
+    }
+
+    first.Merge(second);
+    BOOST_CHECK_EQUAL(first.Count(), all.Count());
+    BOOST_CHECK_EQUAL(first.Sum(), all.Sum());
+    BOOST_CHECK_EQUAL(first.Max(), all.Max());
+    for (double p : PERCENTILES)
+        BOOST_CHECK_EQUAL(first.Percentile(p), all.Percentile(p));
+    CheckPercentiles(first, values);
+
+    // Merge into empty histogram
+    LatencyHistogram empty;
+    empty.Merge(all);
+    for (double p : PERCENTILES)
+        BOOST_CHECK_EQUAL(empty.Percentile(p), all.Percentile(p));
+}
+
+BOOST_AUTO_TEST_CASE(hyperloglog_estimate)
+{
+    HyperLogLog empty;
+    BOOST_CHECK_EQUAL(empty.Estimate(), 0.0);
+
+    // Standard error is 1.04 / sqrt(M), allow 4 of them
+    const double maxError = 4 * 1.04 / std::sqrt((double) HyperLogLog::M);
+    for (int cardinality : {10, 100, 1000, 10000, 100000}) {
+        HyperLogLog hll;
+        for (int i = 0; i < cardinality; i++)
+            hll.Add("192.168." + std::to_string(i));
+
+        double estimate = hll.Estimate();
+        BOOST_CHECK_MESSAGE(std::fabs(estimate - cardinality) <= maxError * cardinality,
+            "cardinality " << cardinality << " estimated " << estimate);
+
+        // Repeated values are not counted
+        for (int i = 0; i < cardinality; i++)
+            hll.Add("192.168." + std::to_string(i));
+        BOOST_CHECK_EQUAL(hll.Estimate(), estimate);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(hyperloglog_merge)
+{
+    HyperLogLog first, second, all;
+    for (int i = 0; i < 7500; i++) {
+        std::string value = "10.0." + std::to_string(i);
+        if (i < 5000) first.Add(value);
+        if (i >= 2500) second.Add(value);
+        all.Add(value);
+    }
+
+    // Merge is exactly the union
+    first.Merge(second);
+    BOOST_CHECK_EQUAL(first.Estimate(), all.Estimate());
+
+    const double maxError = 4 * 1.04 / std::sqrt((double) HyperLogLog::M);
+    BOOST_CHECK(std::fabs(first.Estimate() - 7500) <= maxError * 7500);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -17,13 +17,14 @@
 #include <util.h>
 #include <utilmoneystr.h>
 #include <utiltime.h>
+#include "pocketdb/pocketdata.h"
 #include "pocketdb/pocketnet.h"
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                                  int64_t _nTime, unsigned int _entryHeight,
                                  bool _spendsCoinbase, int64_t _sigOpsCost, LockPoints lp)
     : tx(_tx), nFee(_nFee), nTxWeight(GetTransactionWeight(*tx)), nUsageSize(RecursiveDynamicUsage(tx)), nTime(_nTime), entryHeight(_entryHeight),
-    spendsCoinbase(_spendsCoinbase), sigOpCost(_sigOpsCost), lockPoints(lp)
+    spendsCoinbase(_spendsCoinbase), sigOpCost(_sigOpsCost), lockPoints(lp), nPocketDataUsage(0)
 {
     nCountWithDescendants = 1;
     nSizeWithDescendants = GetTxSize();
@@ -49,6 +50,12 @@ void CTxMemPoolEntry::UpdateLockPoints(const LockPoints& lp)
     lockPoints = lp;
 }
 
+void CTxMemPoolEntry::UpdatePocketData(const std::shared_ptr<const PocketTxData>& data)
+{
+    pocketData = data;
+    nPocketDataUsage = data ? memusage::MallocUsage(sizeof(PocketTxData)) + memusage::MallocUsage(data->table.capacity()) + memusage::MallocUsage(data->data.capacity()) : 0;
+}
+
 size_t CTxMemPoolEntry::GetTxSize() const
 {
     return GetVirtualTransactionSize(nTxWeight, sigOpCost);
@@ -422,7 +429,7 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
         vTxHashes.clear();
 
     totalTxSize -= it->GetTxSize();
-    cachedInnerUsage -= it->DynamicMemoryUsage();
+    cachedInnerUsage -= it->DynamicMemoryUsage() + it->GetPocketDataUsage();
     cachedInnerUsage -= memusage::DynamicUsage(mapLinks[it].parents) + memusage::DynamicUsage(mapLinks[it].children);
     mapLinks.erase(it);
     mapTx.erase(it);
@@ -628,7 +635,7 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
     for (indexed_transaction_set::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
         unsigned int i = 0;
         checkTotal += it->GetTxSize();
-        innerUsage += it->DynamicMemoryUsage();
+        innerUsage += it->DynamicMemoryUsage() + it->GetPocketDataUsage();
         const CTransaction& tx = it->GetTx();
         txlinksMap::const_iterator linksiter = mapLinks.find(it);
         assert(linksiter != mapLinks.end());
@@ -782,7 +789,7 @@ void CTxMemPool::queryHashes(std::vector<uint256>& vtxid)
 }
 
 static TxMempoolInfo GetInfo(CTxMemPool::indexed_transaction_set::const_iterator it) {
-    return TxMempoolInfo{it->GetSharedTx(), it->GetTime(), CFeeRate(it->GetFee(), it->GetTxSize()), it->GetModifiedFee() - it->GetFee()};
+    return TxMempoolInfo{it->GetSharedTx(), it->GetTime(), CFeeRate(it->GetFee(), it->GetTxSize()), it->GetModifiedFee() - it->GetFee(), it->GetPocketData()};
 }
 
 std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
@@ -817,6 +824,17 @@ TxMempoolInfo CTxMemPool::info(const uint256& hash) const
     return GetInfo(i);
 }
 
+void CTxMemPool::SetPocketData(const uint256& hash, const std::shared_ptr<const PocketTxData>& data)
+{
+    LOCK(cs);
+    txiter it = mapTx.find(hash);
+    if (it == mapTx.end() || it->GetPocketData())
+        return;
+
+    mapTx.modify(it, update_pocket_data(data));
+    cachedInnerUsage += it->GetPocketDataUsage();
+}
+
 void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeDelta)
 {
     {
@@ -28,6 +28,7 @@
 #include <boost/signals2/signal.hpp>
 
 class CBlockIndex;
+struct PocketTxData;
 extern CCriticalSection cs_main;
 
 /** Fake height value used in Coin to signify they are only in the memory pool (since 0.8) */
@@ -75,6 +76,8 @@ private:
     const int64_t sigOpCost;        //!< Total sigop cost
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;     //!< Track the height and time at which tx was final
+    std::shared_ptr<const PocketTxData> pocketData; //!< PocketNET payload for relay, filled on first request
+    size_t nPocketDataUsage;   //!< ... and its memory usage
 
     // Information about descendants of this transaction that are in the
     // mempool; if we remove this transaction we must remove all of these
@@ -106,6 +109,8 @@ public:
     int64_t GetModifiedFee() const { return nFee + feeDelta; }
     size_t DynamicMemoryUsage() const { return nUsageSize; }
     const LockPoints& GetLockPoints() const { return lockPoints; }
+    const std::shared_ptr<const PocketTxData>& GetPocketData() const { return pocketData; }
+    size_t GetPocketDataUsage() const { return nPocketDataUsage; }
 
     // Adjusts the descendant state.
     void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
@@ -116,6 +121,8 @@ public:
     void UpdateFeeDelta(int64_t feeDelta);
     // Update the LockPoints after a reorg
     void UpdateLockPoints(const LockPoints& lp);
+    // Remember PocketNET payload for relay
+    void UpdatePocketData(const std::shared_ptr<const PocketTxData>& data);
 
     uint64_t GetCountWithDescendants() const { return nCountWithDescendants; }
     uint64_t GetSizeWithDescendants() const { return nSizeWithDescendants; }
@@ -173,6 +180,16 @@ private:
     int64_t feeDelta;
 };
 
+struct update_pocket_data
+{
+    explicit update_pocket_data(const std::shared_ptr<const PocketTxData>& _data) : data(_data) { }
+
+    void operator() (CTxMemPoolEntry &e) { e.UpdatePocketData(data); }
+
+private:
+    const std::shared_ptr<const PocketTxData>& data;
+};
+
 struct update_lock_points
 {
     explicit update_lock_points(const LockPoints& _lp) : lp(_lp) { }
@@ -337,6 +354,9 @@ struct TxMempoolInfo
 
     /** The fee delta. */
     int64_t nFeeDelta;
+
+    /** PocketNET payload for relay, if already known. */
+    std::shared_ptr<const PocketTxData> pocketData;
 };
 
 /** Reason why a transaction was removed from the mempool,
@@ -563,6 +583,8 @@ public:
 
     /** Affect CreateNewBlock prioritisation of transactions */
     void PrioritiseTransaction(const uint256& hash, const CAmount& nFeeDelta);
+    /** Keep PocketNET payload with transaction so relaying it to other peers needs no DB lookups */
+    void SetPocketData(const uint256& hash, const std::shared_ptr<const PocketTxData>& data);
     void ApplyDelta(const uint256 hash, CAmount &nFeeDelta) const;
     void ClearPrioritisation(const uint256 hash);
 
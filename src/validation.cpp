@@ -53,9 +53,8 @@
 
 #include <antibot/antibot.h>
 #include <index/addrindex.h>
+#include <websocket/notifier.h>
 
-using WsServer = SimpleWeb::SocketServer<SimpleWeb::WS>;
-std::map<std::string, WSUser> WSConnections;
 
 #if defined(NDEBUG)
 #error "Pocketcoin cannot be compiled without assertions."
@@ -162,8 +161,6 @@ private:
 	 */
     CCriticalSection m_cs_chainstate;
 
-    typedef std::map<std::string, std::string> custom_fields;
-
 public:
     CChain chainActive;
     BlockMap mapBlockIndex;
@@ -206,8 +203,6 @@ public:
 private:
     bool ActivateBestChainStep(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
-    void NotifyWSClients(const CBlock& block, CBlockIndex* blockIndex);
-    void PrepareWSMessage(std::map<std::string, std::vector<UniValue>>& messages, std::string msg_type, std::string addrTo, std::string txid, int64_t txtime, custom_fields cFields = custom_fields());
 
     CBlockIndex* AddToBlockIndex(const CBlockHeader& block) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Create a new block index entry for a given block hash */
@@ -2208,14 +2203,14 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         uint256 blockhash = block.GetHash();
 
         // Write received PocketNET data to RIDB
-        if (POCKETNET_DATA.find(blockhash) != POCKETNET_DATA.end()) {
-            std::string _pocket_data = POCKETNET_DATA[blockhash];
-            if (!g_addrindex->SetBlockRIData(block, _pocket_data, pindex->nHeight)) {
+        auto pocket_data = POCKETNET_DATA.Get(blockhash);
+        if (pocket_data) {
+            if (!g_addrindex->SetBlockRIData(block, *pocket_data, pindex->nHeight)) {
                 LogPrintf("--- Failed restore received data (%s) (AddrIndex::SetBlockRIData)\n", blockhash.GetHex());
                 return false;
             }
 
-            POCKETNET_DATA.erase(blockhash);
+            POCKETNET_DATA.Erase(blockhash);
         }
 
         // Get data from RIMempool and write to general RI tables
@@ -2518,7 +2513,7 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
     chainActive.SetTip(pindexDelete->pprev);
 
     // Fix RI tables - clear RI DB from best block height
-    if (g_addrindex->RollbackDB(chainActive.Height(), true)) {
+    if (g_addrindex->RollbackDB(chainActive.Height(), true, pindexDelete->nHeight)) {
         LogPrintf("RIDB rollback to block height %d success!\n", chainActive.Height());
     } else {
         LogPrintf("Error: RIDB rollback failed!\n");
@@ -2681,15 +2676,9 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime1) * MILLI, nTimeTotal * MICRO, nTimeTotal * MILLI / nBlocksTotal);
 
-    uint256 _block_hash = blockConnecting.GetHash();
-    std::string _block_hash_str = _block_hash.GetHex();
-
-    // Compute messages for sending by WebSocket
-    if (!WSConnections.empty()) {
-        //std::thread server_thread(&NotifyWSClients, blockConnecting);
-        //server_thread.detach();
-        NotifyWSClients(blockConnecting, pindexNew);
-    }
+    // Messages for WebSocket clients are computed by notifier thread
+    if (g_wsnotifier && !WSConnections.Empty())
+        g_wsnotifier->Submit(pthisBlock, pindexNew->nHeight);
     //-----------------------------------------------------
     LogPrint(BCLog::SYNC, "+++ Block connected to chain: %d BH:%s\n", pindexNew->nHeight, pindexNew->GetBlockHash().GetHex());
     //-----------------------------------------------------
@@ -2697,405 +2686,6 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     return true;
 }
 
-typedef std::map<std::string, std::string> custom_fields;
-
-void CChainState::NotifyWSClients(const CBlock& block, CBlockIndex* blockIndex)
-{
-    // <address, [messages]>
-    std::map<std::string, std::vector<UniValue>> messages;
-    uint256 _block_hash = block.GetHash();
-    int sharesCnt = 0;
-    //std::map<std::string, int> sharesCntLang;
-    std::map<std::string, std::map<std::string, int>> contentLangCnt;
-    std::string txidpocketnet = "";
-    std::string addrespocketnet = "PEj7QNjKdDPqE9kMDRboKoCtp8V6vZeZPd";
-
-    auto getNameFrom = [](std::string address) -> std::string {
-      reindexer::Item _itmU;
-      if(g_pocketdb->SelectOne(reindexer::Query("UsersView").Where("address", CondEq, address), _itmU).ok())
-          return _itmU["name"].As<string>();
-      return "";
-    };
-
-    for (const auto& tx : block.vtx) {
-        // std::vector<std::pair<std::string, std::pair<int,int64_t>>> addrs;
-        std::map<std::string, std::pair<int, int64_t>> addrs;
-        int64_t txtime = tx->nTime;
-        std::string txid = tx->GetHash().GetHex();
-        std::string optype = "";
-
-        // Get all addresses from tx outs and check OP_RETURN
-        for (int i = 0; i < tx->vout.size(); i++) {
-            const CTxOut& txout = tx->vout[i];
-            //-------------------------
-            if (txout.scriptPubKey[0] == OP_RETURN) {
-                std::string asmstr = ScriptToAsmStr(txout.scriptPubKey);
-                std::vector<std::string> spl;
-                boost::split(spl, asmstr, boost::is_any_of("\t "));
-                if (spl.size() >= 3) {
-                    if (spl[1] == OR_POST) {
-                        optype = "share";
-                        sharesCnt += 1;
-
-                        reindexer::Item shr_itm;
-                        if (g_pocketdb->SelectOne(reindexer::Query("Posts").Where("txid", CondEq, txid), shr_itm).ok()) {
-                            std::string lang = shr_itm["lang"].As<string>();
-//                            std::map<std::string, int>::iterator itl = sharesCntLang.find(lang);
-//                            if (itl != sharesCntLang.end())
-//                                itl->second += 1;
-//                            else
-//                                sharesCntLang.emplace(lang, 1);
-                            contentLangCnt[OR_POST][lang] += 1;
-                        }
-                    }
-                    else if (spl[1] == OR_VIDEO) {
-                        optype = "video";
-                        sharesCnt += 1;
-
-                        reindexer::Item shr_itm;
-                        if (g_pocketdb->SelectOne(reindexer::Query("Posts").Where("txid", CondEq, txid), shr_itm).ok()) {
-                            std::string lang = shr_itm["lang"].As<string>();
-//                            std::map<std::string, int>::iterator itl = sharesCntLang.find(lang);
-//                            if (itl != sharesCntLang.end())
-//                                itl->second += 1;
-//                            else
-//                                sharesCntLang.emplace(lang, 1);
-                            contentLangCnt[OR_VIDEO][lang] += 1;
-                        }
-                    }
-                    else if (spl[1] == OR_SCORE)
-                        optype = "upvoteShare";
-                    else if (spl[1] == OR_SUBSCRIBE)
-                        optype = "subscribe";
-                    else if (spl[1] == OR_SUBSCRIBEPRIVATE)
-                        optype = "subscribePrivate";
-                    else if (spl[1] == OR_USERINFO)
-                        optype = "userInfo";
-                    else if (spl[1] == OR_UNSUBSCRIBE)
-                        optype = "unsubscribe";
-                    else if (spl[1] == OR_COMMENT_SCORE)
-                        optype = "cScore";
-                    else if (spl[1] == OR_COMMENT)
-                        optype = "comment";
-                    else if (spl[1] == OR_COMMENT_EDIT)
-                        optype = "commentEdit";
-                    else if (spl[1] == OR_COMMENT_DELETE)
-                        optype = "commentDelete";
-                }
-            }
-            //-------------------------
-            CTxDestination destAddress;
-            bool fValidAddress = ExtractDestination(txout.scriptPubKey, destAddress);
-            if (fValidAddress) {
-                std::string encoded_address = EncodeDestination(destAddress);
-                if (addrs.find(encoded_address) == addrs.end())
-                    addrs.emplace(encoded_address, std::make_pair(i, (int64_t)txout.nValue));
-            }
-        }
-
-        for (auto const& addr : addrs) {
-            // Event for new transaction
-            custom_fields cTrFields{
-                {"nout", std::to_string(addr.second.first)},
-                {"amount", std::to_string(addr.second.second)},
-            };
-
-            if (optype != "") cTrFields.emplace("type", optype);
-            PrepareWSMessage(messages, "transaction", addr.first, txid, txtime, cTrFields);
-
-            // Event for new PocketNET transaction
-            if (optype == "share" || optype == "video") {
-                reindexer::Item _repost_itm;
-                if (addr.first == addrespocketnet && txidpocketnet.find(txid) == std::string::npos)
-                    txidpocketnet = txidpocketnet + txid + ",";
-                else if (g_pocketdb->SelectOne(reindexer::Query("Posts").InnerJoin("txid", "txidRepost", CondEq, reindexer::Query("Posts").Where("txid", CondEq, txid)), _repost_itm).ok()) {
-                    reindexer::Item _itmP;
-                    std::string addrFrom = "";
-
-                    if (g_pocketdb->SelectOne(reindexer::Query("Posts").Where("txid", CondEq, _repost_itm["txid"].As<string>()), _itmP).ok())
-                        addrFrom = _itmP["address"].As<string>();
-                    custom_fields cFields{
-                        {"mesType", "reshare"},
-                        {"txidRepost", _repost_itm["txid"].As<string>()},
-                        {"addrFrom", addrFrom},
-                        {"nameFrom", getNameFrom(addrFrom)}};
-
-                    PrepareWSMessage(messages, "event", _repost_itm["address"].As<string>(), txid, txtime, cFields);
-                }
-
-                reindexer::QueryResults postfromprivate;
-                g_pocketdb->DB()->Select(reindexer::Query("SubscribesView").Where("address_to", CondEq, addr.first).Where("private", CondEq, "true"), postfromprivate);
-                for (auto it : postfromprivate) {
-                    reindexer::Item _itm(it.GetItem());
-                    custom_fields cFields{
-                        {"mesType", "postfromprivate"},
-                        {"addrFrom", addr.first},
-                        {"nameFrom", getNameFrom(addr.first)}};
-                    PrepareWSMessage(messages, "event", _itm["address"].As<string>(), txid, txtime, cFields);
-                }
-
-            } else if (optype != "share") {
-                if (optype == "userInfo") {
-                    reindexer::Item _user_itm;
-                    if (g_pocketdb->SelectOne(reindexer::Query("UsersView").Where("txid", CondEq, txid), _user_itm).ok()) {
-                        if (_user_itm["time"].As<int64_t>() == _user_itm["regdate"].As<int64_t>()) {
-                            if (_user_itm["referrer"].As<string>() != "") {
-                                custom_fields cFields{
-                                    {"mesType", optype},
-                                    {"addrFrom", addr.first},
-                                    {"nameFrom", getNameFrom(addr.first)}};
-
-                                PrepareWSMessage(messages, "event", _user_itm["referrer"].As<string>(), txid, txtime, cFields);
-                            }
-                        }
-                    }
-                } else if (optype == "upvoteShare") {
-                    reindexer::QueryResults queryResS;
-                    reindexer::QueryResults queryResP;
-
-                    reindexer::Error errS = g_pocketdb->DB()->Select(
-                        reindexer::Query("Scores", 0, 1)
-                            .Where("txid", CondEq, txid),
-                        queryResS);
-
-                    if (errS.ok() && queryResS.Count() > 0) {
-                        reindexer::Item itmS(queryResS[0].GetItem());
-
-                        reindexer::Error errP = g_pocketdb->DB()->Select(
-                            reindexer::Query("Posts", 0, 1)
-                                .Where("txid", CondEq, itmS["posttxid"].As<string>()),
-                            queryResP);
-
-                        if (errP.ok() && queryResP.Count() > 0) {
-                            reindexer::Item itmP(queryResP[0].GetItem());
-
-                            custom_fields cFields{
-                                {"mesType", optype},
-                                {"addrFrom", addr.first},
-                                {"nameFrom", getNameFrom(addr.first)},
-                                {"posttxid", itmS["posttxid"].As<string>()},
-                                {"upvoteVal", itmS["value"].As<string>()}};
-
-                            PrepareWSMessage(messages, "event", itmP["address"].As<string>(), txid, txtime, cFields);
-                        }
-                    }
-                } else if (optype == "subscribe" || optype == "subscribePrivate" || optype == "unsubscribe") {
-                    reindexer::QueryResults queryRes;
-
-                    reindexer::Error err = g_pocketdb->DB()->Select(
-                        reindexer::Query("Subscribes", 0, 1)
-                            .Where("txid", CondEq, txid),
-                        queryRes);
-
-                    if (err.ok() && queryRes.Count() > 0) {
-                        reindexer::Item itm(queryRes[0].GetItem());
-
-                        custom_fields cFields{
-                            {"mesType", optype},
-                            {"addrFrom", addr.first},
-                            {"nameFrom", getNameFrom(addr.first)}
-                        };
-
-                        PrepareWSMessage(messages, "event", itm["address_to"].As<string>(), txid, txtime, cFields);
-                    }
-                } else if (optype == "cScore") {
-                    reindexer::QueryResults queryResS;
-                    reindexer::QueryResults queryResP;
-
-                    reindexer::Error errS = g_pocketdb->DB()->Select(
-                        reindexer::Query("CommentScores", 0, 1)
-                            .Where("txid", CondEq, txid),
-                        queryResS);
-
-                    if (errS.ok() && queryResS.Count() > 0) {
-                        reindexer::Item itmS(queryResS[0].GetItem());
-                        reindexer::Error errP = g_pocketdb->DB()->Select(
-                            reindexer::Query("Comment", 0, 1)
-                                .Where("otxid", CondEq, itmS["commentid"].As<string>())
-                                .Where("last", CondEq, true),
-                            queryResP);
-
-                        if (errP.ok() && queryResP.Count() > 0) {
-                            reindexer::Item itmP(queryResP[0].GetItem());
-
-                            custom_fields cFields{
-                                {"mesType", optype},
-                                {"addrFrom", addr.first},
-                                {"nameFrom", getNameFrom(addr.first)},
-                                {"commentid", itmS["commentid"].As<string>()},
-                                {"upvoteVal", itmS["value"].As<string>()}};
-
-                            PrepareWSMessage(messages, "event", itmP["address"].As<string>(), txid, txtime, cFields);
-                        }
-                    }
-                } else if (optype == "comment" || optype == "commentEdit" || optype == "commentDelete") {
-                    reindexer::QueryResults queryResS;
-                    reindexer::Error errS = g_pocketdb->DB()->Select(
-                        reindexer::Query("Comment", 0, 1)
-                            .Where("txid", CondEq, txid),
-                        queryResS);
-
-                    if (errS.ok() && queryResS.Count() > 0) {
-                        reindexer::Item itmS(queryResS[0].GetItem());
-
-                        // First send notification to autor of post
-                        {
-                            reindexer::QueryResults queryResP;
-                            reindexer::Error errP = g_pocketdb->DB()->Select(
-                                reindexer::Query("Posts", 0, 1)
-                                    .Where("txid", CondEq, itmS["postid"].As<string>()),
-                                queryResP);
-
-                            if (errP.ok() && queryResP.Count() > 0) {
-                                reindexer::Item itmP(queryResP[0].GetItem());
-
-                                custom_fields cFields{
-                                    {"mesType", optype},
-                                    {"addrFrom", addr.first},
-                                    {"nameFrom", getNameFrom(addr.first)},
-                                    {"posttxid", itmS["postid"].As<string>()},
-                                    {"parentid", itmS["parentid"].As<string>()},
-                                    {"answerid", itmS["answerid"].As<string>()},
-                                    {"reason", "post"},
-                                };
-
-                                PrepareWSMessage(messages, "event", itmP["address"].As<string>(), itmS["otxid"].As<string>(), txtime, cFields);
-                            }
-                        }
-
-                        // Second send notification to autor of comment if answerid not empty
-                        {
-                            reindexer::QueryResults queryResP;
-                            reindexer::Error errP = g_pocketdb->DB()->Select(
-                                reindexer::Query("Comment", 0, 1)
-                                    .Where("otxid", CondEq, itmS["answerid"].As<string>())
-                                    .Where("last", CondEq, true),
-                                queryResP);
-
-                            if (errP.ok() && queryResP.Count() > 0) {
-                                reindexer::Item itmP(queryResP[0].GetItem());
-
-                                custom_fields cFields{
-                                    {"mesType", optype},
-                                    {"addrFrom", addr.first},
-                                    {"nameFrom", getNameFrom(addr.first)},
-                                    {"posttxid", itmS["postid"].As<string>()},
-                                    {"parentid", itmS["parentid"].As<string>()},
-                                    {"answerid", itmS["answerid"].As<string>()},
-                                    {"reason", "answer"},
-                                };
-
-                                PrepareWSMessage(messages, "event", itmP["address"].As<string>(), itmS["otxid"].As<string>(), txtime, cFields);
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    // Send all WS clients messages
-//    UniValue sharesLang(UniValue::VOBJ);
-//    for (std::map<std::string, int>::iterator itl = sharesCntLang.begin(); itl != sharesCntLang.end(); ++itl) {
-//        sharesLang.pushKV(itl->first, itl->second);
-//    }
-    UniValue contentsLang(UniValue::VOBJ);
-    for (const auto& itemContent : contentLangCnt){
-        UniValue langContents(UniValue::VOBJ);
-        for (const auto& itemLang : itemContent.second) {
-            langContents.pushKV(itemLang.first, itemLang.second);
-        }
-        contentsLang.pushKV(getcontenttype(getcontenttype(itemContent.first)), langContents);
-    }
-    for (auto& connWS : WSConnections) {
-        UniValue msg(UniValue::VOBJ);
-        msg.pushKV("addr", connWS.second.Address);
-        msg.pushKV("msg", "new block");
-        msg.pushKV("blockhash", _block_hash.GetHex());
-        msg.pushKV("time", std::to_string(block.nTime));
-        msg.pushKV("height", blockIndex->nHeight);
-        msg.pushKV("shares", sharesCnt);
-        //msg.pushKV("sharesLang", sharesLang);
-        msg.pushKV("contentsLang", contentsLang);
-
-        reindexer::QueryResults queryResSubscribes;
-        reindexer::Error err = g_pocketdb->DB()->Select(
-            reindexer::Query("SubscribesView")
-                .Where("address", CondEq, connWS.second.Address),
-            queryResSubscribes);
-
-        if (err.ok() && queryResSubscribes.Count() > 0) {
-            std::vector<string> _addrs;
-            for (auto it : queryResSubscribes) {
-                reindexer::Item itm(it.GetItem());
-                _addrs.push_back(itm["address_to"].As<string>());
-            }
-
-            reindexer::QueryResults queryResShares;
-            reindexer::Error err = g_pocketdb->DB()->Select(
-                reindexer::Query("Posts")
-                    .Where("block", CondEq, blockIndex->nHeight)
-                    .Where("address", CondSet, _addrs),
-                queryResShares);
-            if (err.ok() && queryResShares.Count() > 0) {
-                msg.pushKV("sharesSubscr", (int)queryResShares.Count());
-            }
-        }
-
-        if (blockIndex->nHeight > connWS.second.Block) {
-            try {
-                connWS.second.Connection->send(msg.write(), [](const SimpleWeb::error_code& ec) {});
-            } catch (const std::exception& e) {
-                LogPrintf("Error: CChainState::NotifyWSClients (1) - %s\n", e.what());
-            }
-
-            if (txidpocketnet != "") {
-                try {
-                    UniValue m(UniValue::VOBJ);
-                    m.pushKV("msg", "sharepocketnet");
-                    m.pushKV("time", std::to_string(block.nTime));
-                    m.pushKV("txids", txidpocketnet.substr(0, txidpocketnet.size() - 1));
-                    connWS.second.Connection->send(m.write(), [](const SimpleWeb::error_code& ec) {});
-                } catch (const std::exception& e) {
-                    LogPrintf("Error: CChainState::NotifyWSClients (1) - %s\n", e.what());
-                }
-            }
-
-            if (messages.find(connWS.second.Address) != messages.end()) {
-                for (auto m : messages[connWS.second.Address]) {
-                    try {
-                        connWS.second.Connection->send(m.write(), [](const SimpleWeb::error_code& ec) {});
-                    } catch (const std::exception& e) {
-                        LogPrintf("Error: CChainState::NotifyWSClients (2) - %s\n", e.what());
-                    }
-                }
-            }
-
-            connWS.second.Block = blockIndex->nHeight;
-        }
-    }
-}
-
-void CChainState::PrepareWSMessage(std::map<std::string, std::vector<UniValue>>& messages, std::string msg_type, std::string addrTo, std::string txid, int64_t txtime, custom_fields cFields)
-{
-    UniValue msg(UniValue::VOBJ);
-    msg.pushKV("addr", addrTo);
-    msg.pushKV("msg", msg_type);
-    msg.pushKV("txid", txid);
-    msg.pushKV("time", txtime);
-
-    for (auto& it : cFields) {
-        msg.pushKV(it.first, it.second);
-    }
-
-    if (messages.find(addrTo) == messages.end()) {
-        std::vector<UniValue> _list;
-        messages.insert(std::make_pair(addrTo, _list));
-    }
-
-    messages[addrTo].push_back(msg);
-}
-
 /**
  * Return the tip of the chain with the most work in it, that isn't
  * known to be invalid (it's however far from certain to be valid).
@@ -3799,39 +3389,19 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
     return true;
 }
 
-bool FindRTransaction(UniValue& _txs_src, const CTransactionRef& tx, std::string ri_table, reindexer::Item& itm)
+bool FindRTransaction(const PocketBlockData& _txs_src, const CTransactionRef& tx, std::string ri_table, reindexer::Item& itm)
 {
     std::string txid = tx->GetHash().GetHex();
 
     // Maybe data received from another node?
-    if (_txs_src.exists(txid)) {
-        std::string _tx_src = _txs_src[txid].get_str();
-        UniValue _tx(UniValue::VOBJ);
-        if (!_tx.read(_tx_src)) {
-            LogPrintf("700001: Transaction RI data parse failed (%s): %s\n", txid, _tx_src);
+    auto _tx_src = _txs_src.find(tx->GetHash());
+    if (_tx_src != _txs_src.end()) {
+        itm = g_pocketdb->DB()->NewItem(_tx_src->second.table);
+        if (!itm.FromJSON(_tx_src->second.data).ok()) {
+            LogPrintf("700002: Transaction RI data parse failed (%s): %s\n", txid, _tx_src->second.data);
             return false;
         }
 
-        ri_table = _tx["t"].get_str();
-        itm = g_pocketdb->DB()->NewItem(ri_table);
-        _tx_src = DecodeBase64(_tx["d"].get_str());
-        if (!itm.FromJSON(_tx_src).ok()) {
-            LogPrintf("700002: Transaction RI data parse failed (%s): %s\n", txid, _tx_src);
-            return false;
-        }
-
-        if (ri_table == "Mempool") {
-            ri_table = itm["table"].As<string>();
-            std::string _data = itm["data"].As<string>();
-
-            itm = g_pocketdb->DB()->NewItem(ri_table);
-            _tx_src = DecodeBase64(_data);
-            if (!itm.FromJSON(_tx_src).ok()) {
-                LogPrintf("7000021: Transaction RI data parse failed (%s): %s\n", txid, _tx_src);
-                return false;
-            }
-        }
-
         return true;
     } else {
         if (ri_table == "Posts") {
@@ -3876,12 +3446,10 @@ bool CheckBlockAdditional(CBlockIndex* pindex, const CBlock& block, CValidationS
         //return state.DoS(200, error("Received block not consistent with ReindexerDB (%s)", blockhash.GetHex()), REJECT_INVALID, "bad-rhash");
         // }
 
-        // Read and parse received block data
-        UniValue _txs_src(UniValue::VOBJ);
-        if (POCKETNET_DATA.find(blockhash) != POCKETNET_DATA.end()) {
-            std::string _pocket_data = POCKETNET_DATA[blockhash];
-            _txs_src.read(_pocket_data);
-        }
+        // Received block data
+        static const PocketBlockData empty_data;
+        auto pocket_data = POCKETNET_DATA.Get(blockhash);
+        const PocketBlockData& _txs_src = (pocket_data ? *pocket_data : empty_data);
 
         // TODO (brangr): change UniValue to RTransaction
         BlockVTX blockVtx;
@@ -9,7 +9,7 @@
  * network protocol versioning
  */
 
-static const int PROTOCOL_VERSION = 70015;
+static const int PROTOCOL_VERSION = 70017;
 
 //! initial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -42,4 +42,10 @@ static const int SHORT_IDS_BLOCKS_VERSION = 70014;
 //! not banning for invalid compact blocks starts with this version
 static const int INVALID_CB_NO_BAN_VERSION = 70015;
 
+//! pocket data of blocks and transactions relayed in binary form starts with this version
+static const int POCKET_DATA_BINARY_VERSION = 70016;
+
+//! compact blocks carry pocket data only of transactions unknown to peer, missing pocket data is requested with getblocktxn, starts with this version
+static const int POCKET_COMPACT_DATA_VERSION = 70017;
+
 #endif // POCKETCOIN_VERSION_H
@@ -4542,6 +4542,81 @@ bool CWallet::SelectCoinsForStaking(int64_t nTargetValue, unsigned int nSpendTim
 }
 
 
+void CWallet::GetStakeCandidates(const std::set<CStakeCoin>& setCoins, std::vector<std::pair<CStakeCoin, CStakeCandidate>>& candidates)
+{
+	candidates.clear();
+
+	LOCK2(cs_main, cs_wallet);
+
+	std::set<COutPoint> selected;
+	for (auto & coin : setCoins) {
+		COutPoint prevout(coin.first->tx->GetHash(), coin.second);
+		selected.insert(prevout);
+
+		auto it = mapStakeCandidates.find(prevout);
+		if (it == mapStakeCandidates.end() || it->second.hashBlock != coin.first->hashBlock) {
+			auto blockIt = mapBlockIndex.find(coin.first->hashBlock);
+			if (blockIt == mapBlockIndex.end()) {
+				LogPrintf("GetStakeCandidates : Could not find block of previous transaction %s\n", prevout.hash.ToString());
+				continue;
+			}
+
+			it = mapStakeCandidates.emplace(prevout, CStakeCandidate{}).first;
+			it->second = CStakeCandidate{coin.first->tx, coin.first->hashBlock, blockIt->second};
+		}
+
+		candidates.emplace_back(coin, it->second);
+	}
+
+	// Spent or immature coins are not selected any more
+	for (auto it = mapStakeCandidates.begin(); it != mapStakeCandidates.end();) {
+		if (selected.count(it->first))
+			++it;
+		else
+			it = mapStakeCandidates.erase(it);
+	}
+}
+
+bool CWallet::HasStakeKernel(CBlockIndex* pindexPrev, unsigned int nBits, int64_t nTime, int64_t nSearchInterval)
+{
+	int64_t nBalance = GetBalance();
+	if (nBalance < Params().GetConsensus().nStakeMinimumThreshold) {
+		return false;
+	}
+
+	std::set<CStakeCoin> setCoins;
+	int64_t nValueIn = 0;
+	if (!SelectCoinsForStaking(nBalance, nTime, setCoins, nValueIn) || setCoins.empty()) {
+		return false;
+	}
+
+	std::vector<std::pair<CStakeCoin, CStakeCandidate>> candidates;
+	GetStakeCandidates(setCoins, candidates);
+
+	CDataStream hashProofOfStakeSource(SER_GETHASH, 0);
+	return FindStakeKernel(pindexPrev, nBits, nTime, nSearchInterval, candidates, hashProofOfStakeSource, [](const CStakeCoin& coin, unsigned int n) { return true; });
+}
+
+bool CWallet::FindStakeKernel(CBlockIndex* pindexPrev, unsigned int nBits, int64_t nTime, int64_t nSearchInterval,
+	const std::vector<std::pair<CStakeCoin, CStakeCandidate>>& candidates, CDataStream& hashProofOfStakeSource,
+	const std::function<bool(const CStakeCoin& coin, unsigned int n)>& fAccept) const
+{
+	for (unsigned int n = 0; n < std::min(nSearchInterval, MAX_STAKE_SEARCH_INTERVAL) && pindexPrev == chainActive.Tip(); n++) {
+		boost::this_thread::interruption_point();
+		for (auto & candidate : candidates) {
+			const CStakeCoin& pcoin = candidate.first;
+			COutPoint prevoutStake = COutPoint(pcoin.first->tx->GetHash(), pcoin.second);
+			if (!CheckKernel(pindexPrev, nBits, nTime - n, candidate.second.pindexFrom, candidate.second.txPrev, prevoutStake, hashProofOfStakeSource)) {
+				continue;
+			}
+
+			if (fAccept(pcoin, n)) return true;
+		}
+	}
+
+	return false;
+}
+
 bool CWallet::CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int64_t nSearchInterval, int64_t nFees, CMutableTransaction& txNew, CKey& key)
 {
     // We need create new coin after current chain
@@ -4585,70 +4660,59 @@ bool CWallet::CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int
 	int64_t nCredit = 0;
 	CScript scriptPubKeyKernel;
 	CDataStream hashProofOfStakeSource(SER_GETHASH, 0);
-	for (auto & pcoin : setCoins) {
-		static int nMaxStakeSearchInterval = 60;
-		bool fKernelFound = false;
-		for (unsigned int n = 0; n < fmin(nSearchInterval, (int64_t)nMaxStakeSearchInterval) && !fKernelFound && pindexPrev == chainActive.Tip(); n++) {
-			boost::this_thread::interruption_point();
-			// Search backward in time from the given txNew timestamp
-			// Search nSearchInterval seconds back up to nMaxStakeSearchInterval
-			COutPoint prevoutStake = COutPoint(pcoin.first->tx->GetHash(), pcoin.second);
-			int64_t nBlockTime;
-			if (CheckKernel(pindexPrev, nBits, txNew.nTime - n, prevoutStake, &nBlockTime, this, hashProofOfStakeSource)) {
-				// Found a kernel
-				// LogPrintf("CreateCoinStake : kernel found\n");
-				std::vector<std::vector<unsigned char>> vSolutions;
-				CScript scriptPubKeyOut;
-				scriptPubKeyKernel = pcoin.first->tx->vout[pcoin.second].scriptPubKey;
-				txnouttype whichType = Solver(scriptPubKeyKernel, vSolutions);
-				if (whichType == TX_NONSTANDARD) {
-					LogPrintf("CreateCoinStake : failed to parse kernel\n");
-					break;
-				}
-				// LogPrintf("CreateCoinStake : parsed kernel type=%d\n", whichType);
-				if (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH) {
-					LogPrintf("CreateCoinStake : no support for kernel type=%d\n", whichType);
-					break;  // only support pay to public key and pay to address
-				}
-				if (whichType == TX_PUBKEYHASH) {
-					// convert to pay to public key type
-					if (!keystore.GetKey(CKeyID(uint160(vSolutions[0])), key)) {
-						LogPrintf("CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
-						break;  // unable to find corresponding public key
-					}
-					scriptPubKeyOut << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
-				}
-				if (whichType == TX_PUBKEY) {
-					std::vector<unsigned char>& vchPubKey = vSolutions[0];
-					if (!keystore.GetKey(CKeyID(Hash160(vchPubKey)), key)) {
-						LogPrintf("CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
-						break;  // unable to find corresponding public key
-					}
 
-					if (key.GetPubKey() != CPubKey(vchPubKey)) {
-						LogPrintf("CreateCoinStake : invalid key for kernel type=%d\n", whichType);
-						break; // keys mismatch
-					}
-
-					scriptPubKeyOut = scriptPubKeyKernel;
-				}
-
-				txNew.nTime -= n;
-				txNew.vin.push_back(CTxIn(pcoin.first->tx->GetHash(), pcoin.second));
-				nCredit += pcoin.first->tx->vout[pcoin.second].nValue;
-				vwtxPrev.insert(std::make_pair(pcoin.first, pcoin.second));
-				txNew.vout.push_back(CTxOut(0, scriptPubKeyOut));
-
-				// LogPrintf("CreateCoinStake : added kernel type=%d\n", whichType);
-				fKernelFound = true;
-				break;
+	std::vector<std::pair<CStakeCoin, CStakeCandidate>> candidates;
+	GetStakeCandidates(setCoins, candidates);
+
+	// Kernel is accepted only if coin script can be signed by wallet key
+	FindStakeKernel(pindexPrev, nBits, txNew.nTime, nSearchInterval, candidates, hashProofOfStakeSource, [&](const CStakeCoin& pcoin, unsigned int n) {
+		// Found a kernel
+		// LogPrintf("CreateCoinStake : kernel found\n");
+		std::vector<std::vector<unsigned char>> vSolutions;
+		CScript scriptPubKeyOut;
+		scriptPubKeyKernel = pcoin.first->tx->vout[pcoin.second].scriptPubKey;
+		txnouttype whichType = Solver(scriptPubKeyKernel, vSolutions);
+		if (whichType == TX_NONSTANDARD) {
+			LogPrintf("CreateCoinStake : failed to parse kernel\n");
+			return false;
+		}
+		// LogPrintf("CreateCoinStake : parsed kernel type=%d\n", whichType);
+		if (whichType != TX_PUBKEY && whichType != TX_PUBKEYHASH) {
+			LogPrintf("CreateCoinStake : no support for kernel type=%d\n", whichType);
+			return false;  // only support pay to public key and pay to address
+		}
+		if (whichType == TX_PUBKEYHASH) {
+			// convert to pay to public key type
+			if (!keystore.GetKey(CKeyID(uint160(vSolutions[0])), key)) {
+				LogPrintf("CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
+				return false;  // unable to find corresponding public key
 			}
+			scriptPubKeyOut << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
 		}
+		if (whichType == TX_PUBKEY) {
+			std::vector<unsigned char>& vchPubKey = vSolutions[0];
+			if (!keystore.GetKey(CKeyID(Hash160(vchPubKey)), key)) {
+				LogPrintf("CreateCoinStake : failed to get key for kernel type=%d\n", whichType);
+				return false;  // unable to find corresponding public key
+			}
+
+			if (key.GetPubKey() != CPubKey(vchPubKey)) {
+				LogPrintf("CreateCoinStake : invalid key for kernel type=%d\n", whichType);
+				return false; // keys mismatch
+			}
 
-		if (fKernelFound) {
-			break; // if kernel is found stop searching
+			scriptPubKeyOut = scriptPubKeyKernel;
 		}
-	}
+
+		txNew.nTime -= n;
+		txNew.vin.push_back(CTxIn(pcoin.first->tx->GetHash(), pcoin.second));
+		nCredit += pcoin.first->tx->vout[pcoin.second].nValue;
+		vwtxPrev.insert(std::make_pair(pcoin.first, pcoin.second));
+		txNew.vout.push_back(CTxOut(0, scriptPubKeyOut));
+
+		// LogPrintf("CreateCoinStake : added kernel type=%d\n", whichType);
+		return true;
+	});
 
 	if (nCredit == 0 || nCredit > nBalance) {
 		return false;
@@ -24,6 +24,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
@@ -584,6 +585,19 @@ struct CoinSelectionParams
     CoinSelectionParams() {}
 };
 
+/** Kernel inputs of staking coin kept between stake searches */
+struct CStakeCandidate
+{
+    CTransactionRef txPrev;
+    uint256 hashBlock;
+    CBlockIndex* pindexFrom;
+};
+
+typedef std::pair<const CWalletTx*, unsigned int> CStakeCoin;
+
+/** Seconds back from slot time searched for stake kernel */
+static const int64_t MAX_STAKE_SEARCH_INTERVAL = 60;
+
 class WalletRescanReserver; //forward declarations for ScanForWalletTransactions/RescanFromTime
 /**
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
@@ -694,6 +708,13 @@ private:
      */
     const CBlockIndex* m_last_block_processed = nullptr;
 
+    /**
+     * Kernel inputs of coins selected for staking.
+     * Refreshed on every stake search: entries of spent coins are dropped,
+     * entries of coins moved to another block by reorg are resolved again.
+     */
+    std::map<COutPoint, CStakeCandidate> mapStakeCandidates GUARDED_BY(cs_wallet);
+
 public:
     /*
      * Main wallet lock.
@@ -718,6 +739,17 @@ public:
                     const CCoinControl& coin_control, CoinSelectionParams& coin_selection_params, bool& bnb_used) const;
     bool SelectCoinsForStaking(int64_t nTargetValue, unsigned int nSpendTime, std::set<std::pair<const CWalletTx*,unsigned int> >& setCoinsRet, int64_t& nValueRet) const;
     void AvailableCoinsForStaking(std::vector<COutput>& vCoins, unsigned int nSpendTime) const;
+    /** Kernel inputs of coins from stake candidates cache, coins without known block are skipped */
+    void GetStakeCandidates(const std::set<CStakeCoin>& setCoins, std::vector<std::pair<CStakeCoin, CStakeCandidate>>& candidates);
+    /**
+     * Search kernel backward in time from nTime up to MAX_STAKE_SEARCH_INTERVAL seconds,
+     * every second is checked for all candidates - kernel with latest timestamp wins.
+     * fAccept(coin, n) is called for kernel found at nTime - n, search goes on if it returns false.
+     * hashProofOfStakeSource holds source of last checked kernel.
+     */
+    bool FindStakeKernel(CBlockIndex* pindexPrev, unsigned int nBits, int64_t nTime, int64_t nSearchInterval,
+        const std::vector<std::pair<CStakeCoin, CStakeCandidate>>& candidates, CDataStream& hashProofOfStakeSource,
+        const std::function<bool(const CStakeCoin& coin, unsigned int n)>& fAccept) const;
 
     /** Get a name for this wallet for logging/debugging purposes.
      */
@@ -1136,6 +1168,8 @@ public:
     bool GetKeyOrigin(const CKeyID& keyid, KeyOriginInfo& info) const override;
     uint64_t GetStakeWeight() const;
     bool CreateCoinStake(const CKeyStore& keystore, unsigned int nBits, int64_t nSearchInterval, int64_t nFees, CMutableTransaction& txNew, CKey& key);
+    /** Cheap check before block assembly: has any staking coin kernel in search window back from nTime */
+    bool HasStakeKernel(CBlockIndex* pindexPrev, unsigned int nBits, int64_t nTime, int64_t nSearchInterval);
     int64_t GetStake() const;
     int64_t GetNewMint() const;
 };
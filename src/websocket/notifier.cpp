@@ -0,0 +1,475 @@
+// Copyright (c) 2018 PocketNet developers
+// Notifications of WebSocket clients about connected blocks
+//-----------------------------------------------------
+#include <websocket/notifier.h>
+#include <core_io.h>
+#include <key_io.h>
+#include <pocketdb/pocketdb.h>
+#include <pocketdb/pocketnet.h>
+#include <script/standard.h>
+#include <util.h>
+#include <validation.h>
+
+#include <boost/algorithm/string.hpp>
+//-----------------------------------------------------
+std::unique_ptr<WSNotifier> g_wsnotifier;
+//-----------------------------------------------------
+void WSNotifier::Submit(const std::shared_ptr<const CBlock>& block, int height)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (queue.size() >= WS_NOTIFY_QUEUE_BLOCKS) {
+            LogPrint(BCLog::SYNC, "WSNotifier: queue is full, notification of block %d dropped\n", queue.front().height);
+            queue.pop_front();
+        }
+
+        WSBlockDelta delta;
+        delta.block = block;
+        delta.height = height;
+        queue.push_back(std::move(delta));
+    }
+    cond.notify_one();
+}
+
+void WSNotifier::Thread()
+{
+    while (true) {
+        WSBlockDelta delta;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queue.empty())
+                cond.wait(lock); // Interruption point
+            delta = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        try {
+            notify(delta);
+        } catch (const std::exception& e) {
+            LogPrintf("Error: WSNotifier - %s\n", e.what());
+        }
+    }
+}
+
+void ThreadWSNotify()
+{
+    RenameThread("pocketcoin-wsnotify");
+    g_wsnotifier->Thread();
+}
+//-----------------------------------------------------
+void WSNotifier::prepareMessage(WSMessages& messages, std::string msg_type, std::string addrTo, std::string txid, int64_t txtime, custom_fields cFields)
+{
+    UniValue msg(UniValue::VOBJ);
+    msg.pushKV("addr", addrTo);
+    msg.pushKV("msg", msg_type);
+    msg.pushKV("txid", txid);
+    msg.pushKV("time", txtime);
+
+    for (auto& it : cFields) {
+        msg.pushKV(it.first, it.second);
+    }
+
+    messages[addrTo].push_back(msg);
+}
+
+void WSNotifier::prepareMessages(const CBlock& block, BlockMessages& result)
+{
+    WSMessages& messages = result.messages;
+    std::string addrespocketnet = "PEj7QNjKdDPqE9kMDRboKoCtp8V6vZeZPd";
+
+    auto getNameFrom = [](std::string address) -> std::string {
+        reindexer::Item _itmU;
+        if (g_pocketdb->SelectOne(reindexer::Query("UsersView").Where("address", CondEq, address), _itmU).ok())
+            return _itmU["name"].As<string>();
+        return "";
+    };
+
+    for (const auto& tx : block.vtx) {
+        std::map<std::string, std::pair<int, int64_t>> addrs;
+        int64_t txtime = tx->nTime;
+        std::string txid = tx->GetHash().GetHex();
+        std::string optype = "";
+
+        // Get all addresses from tx outs and check OP_RETURN
+        for (int i = 0; i < tx->vout.size(); i++) {
+            const CTxOut& txout = tx->vout[i];
+            //-------------------------
+            if (txout.scriptPubKey[0] == OP_RETURN) {
+                std::string asmstr = ScriptToAsmStr(txout.scriptPubKey);
+                std::vector<std::string> spl;
+                boost::split(spl, asmstr, boost::is_any_of("\t "));
+                if (spl.size() >= 3) {
+                    if (spl[1] == OR_POST || spl[1] == OR_VIDEO) {
+                        optype = spl[1] == OR_POST ? "share" : "video";
+                        result.sharesCnt += 1;
+
+                        reindexer::Item shr_itm;
+                        if (g_pocketdb->SelectOne(reindexer::Query("Posts").Where("txid", CondEq, txid), shr_itm).ok()) {
+                            std::string lang = shr_itm["lang"].As<string>();
+                            result.contentLangCnt[spl[1]][lang] += 1;
+                        }
+                    }
+                    else if (spl[1] == OR_SCORE)
+                        optype = "upvoteShare";
+                    else if (spl[1] == OR_SUBSCRIBE)
+                        optype = "subscribe";
+                    else if (spl[1] == OR_SUBSCRIBEPRIVATE)
+                        optype = "subscribePrivate";
+                    else if (spl[1] == OR_USERINFO)
+                        optype = "userInfo";
+                    else if (spl[1] == OR_UNSUBSCRIBE)
+                        optype = "unsubscribe";
+                    else if (spl[1] == OR_COMMENT_SCORE)
+                        optype = "cScore";
+                    else if (spl[1] == OR_COMMENT)
+                        optype = "comment";
+                    else if (spl[1] == OR_COMMENT_EDIT)
+                        optype = "commentEdit";
+                    else if (spl[1] == OR_COMMENT_DELETE)
+                        optype = "commentDelete";
+                }
+            }
+            //-------------------------
+            CTxDestination destAddress;
+            bool fValidAddress = ExtractDestination(txout.scriptPubKey, destAddress);
+            if (fValidAddress) {
+                std::string encoded_address = EncodeDestination(destAddress);
+                if (addrs.find(encoded_address) == addrs.end())
+                    addrs.emplace(encoded_address, std::make_pair(i, (int64_t)txout.nValue));
+            }
+        }
+
+        for (auto const& addr : addrs) {
+            // Event for new transaction
+            custom_fields cTrFields{
+                {"nout", std::to_string(addr.second.first)},
+                {"amount", std::to_string(addr.second.second)},
+            };
+
+            if (optype != "") cTrFields.emplace("type", optype);
+            prepareMessage(messages, "transaction", addr.first, txid, txtime, cTrFields);
+
+            // Event for new PocketNET transaction
+            if (optype == "share" || optype == "video") {
+                reindexer::Item _repost_itm;
+                if (addr.first == addrespocketnet && result.txidpocketnet.find(txid) == std::string::npos)
+                    result.txidpocketnet = result.txidpocketnet + txid + ",";
+                else if (g_pocketdb->SelectOne(reindexer::Query("Posts").InnerJoin("txid", "txidRepost", CondEq, reindexer::Query("Posts").Where("txid", CondEq, txid)), _repost_itm).ok()) {
+                    reindexer::Item _itmP;
+                    std::string addrFrom = "";
+
+                    if (g_pocketdb->SelectOne(reindexer::Query("Posts").Where("txid", CondEq, _repost_itm["txid"].As<string>()), _itmP).ok())
+                        addrFrom = _itmP["address"].As<string>();
+                    custom_fields cFields{
+                        {"mesType", "reshare"},
+                        {"txidRepost", _repost_itm["txid"].As<string>()},
+                        {"addrFrom", addrFrom},
+                        {"nameFrom", getNameFrom(addrFrom)}};
+
+                    prepareMessage(messages, "event", _repost_itm["address"].As<string>(), txid, txtime, cFields);
+                }
+
+                reindexer::QueryResults postfromprivate;
+                g_pocketdb->DB()->Select(reindexer::Query("SubscribesView").Where("address_to", CondEq, addr.first).Where("private", CondEq, "true"), postfromprivate);
+                for (auto it : postfromprivate) {
+                    reindexer::Item _itm(it.GetItem());
+                    custom_fields cFields{
+                        {"mesType", "postfromprivate"},
+                        {"addrFrom", addr.first},
+                        {"nameFrom", getNameFrom(addr.first)}};
+                    prepareMessage(messages, "event", _itm["address"].As<string>(), txid, txtime, cFields);
+                }
+
+            } else if (optype == "userInfo") {
+                reindexer::Item _user_itm;
+                if (g_pocketdb->SelectOne(reindexer::Query("UsersView").Where("txid", CondEq, txid), _user_itm).ok()) {
+                    if (_user_itm["time"].As<int64_t>() == _user_itm["regdate"].As<int64_t>()) {
+                        if (_user_itm["referrer"].As<string>() != "") {
+                            custom_fields cFields{
+                                {"mesType", optype},
+                                {"addrFrom", addr.first},
+                                {"nameFrom", getNameFrom(addr.first)}};
+
+                            prepareMessage(messages, "event", _user_itm["referrer"].As<string>(), txid, txtime, cFields);
+                        }
+                    }
+                }
+            } else if (optype == "upvoteShare") {
+                reindexer::QueryResults queryResS;
+                reindexer::QueryResults queryResP;
+
+                reindexer::Error errS = g_pocketdb->DB()->Select(
+                    reindexer::Query("Scores", 0, 1)
+                        .Where("txid", CondEq, txid),
+                    queryResS);
+
+                if (errS.ok() && queryResS.Count() > 0) {
+                    reindexer::Item itmS(queryResS[0].GetItem());
+
+                    reindexer::Error errP = g_pocketdb->DB()->Select(
+                        reindexer::Query("Posts", 0, 1)
+                            .Where("txid", CondEq, itmS["posttxid"].As<string>()),
+                        queryResP);
+
+                    if (errP.ok() && queryResP.Count() > 0) {
+                        reindexer::Item itmP(queryResP[0].GetItem());
+
+                        custom_fields cFields{
+                            {"mesType", optype},
+                            {"addrFrom", addr.first},
+                            {"nameFrom", getNameFrom(addr.first)},
+                            {"posttxid", itmS["posttxid"].As<string>()},
+                            {"upvoteVal", itmS["value"].As<string>()}};
+
+                        prepareMessage(messages, "event", itmP["address"].As<string>(), txid, txtime, cFields);
+                    }
+                }
+            } else if (optype == "subscribe" || optype == "subscribePrivate" || optype == "unsubscribe") {
+                reindexer::QueryResults queryRes;
+
+                reindexer::Error err = g_pocketdb->DB()->Select(
+                    reindexer::Query("Subscribes", 0, 1)
+                        .Where("txid", CondEq, txid),
+                    queryRes);
+
+                if (err.ok() && queryRes.Count() > 0) {
+                    reindexer::Item itm(queryRes[0].GetItem());
+
+                    custom_fields cFields{
+                        {"mesType", optype},
+                        {"addrFrom", addr.first},
+                        {"nameFrom", getNameFrom(addr.first)}
+                    };
+
+                    prepareMessage(messages, "event", itm["address_to"].As<string>(), txid, txtime, cFields);
+                }
+            } else if (optype == "cScore") {
+                reindexer::QueryResults queryResS;
+                reindexer::QueryResults queryResP;
+
+                reindexer::Error errS = g_pocketdb->DB()->Select(
+                    reindexer::Query("CommentScores", 0, 1)
+                        .Where("txid", CondEq, txid),
+                    queryResS);
+
+                if (errS.ok() && queryResS.Count() > 0) {
+                    reindexer::Item itmS(queryResS[0].GetItem());
+                    reindexer::Error errP = g_pocketdb->DB()->Select(
+                        reindexer::Query("Comment", 0, 1)
+                            .Where("otxid", CondEq, itmS["commentid"].As<string>())
+                            .Where("last", CondEq, true),
+                        queryResP);
+
+                    if (errP.ok() && queryResP.Count() > 0) {
+                        reindexer::Item itmP(queryResP[0].GetItem());
+
+                        custom_fields cFields{
+                            {"mesType", optype},
+                            {"addrFrom", addr.first},
+                            {"nameFrom", getNameFrom(addr.first)},
+                            {"commentid", itmS["commentid"].As<string>()},
+                            {"upvoteVal", itmS["value"].As<string>()}};
+
+                        prepareMessage(messages, "event", itmP["address"].As<string>(), txid, txtime, cFields);
+                    }
+                }
+            } else if (optype == "comment" || optype == "commentEdit" || optype == "commentDelete") {
+                reindexer::QueryResults queryResS;
+                reindexer::Error errS = g_pocketdb->DB()->Select(
+                    reindexer::Query("Comment", 0, 1)
+                        .Where("txid", CondEq, txid),
+                    queryResS);
+
+                if (errS.ok() && queryResS.Count() > 0) {
+                    reindexer::Item itmS(queryResS[0].GetItem());
+
+                    // First send notification to autor of post
+                    {
+                        reindexer::QueryResults queryResP;
+                        reindexer::Error errP = g_pocketdb->DB()->Select(
+                            reindexer::Query("Posts", 0, 1)
+                                .Where("txid", CondEq, itmS["postid"].As<string>()),
+                            queryResP);
+
+                        if (errP.ok() && queryResP.Count() > 0) {
+                            reindexer::Item itmP(queryResP[0].GetItem());
+
+                            custom_fields cFields{
+                                {"mesType", optype},
+                                {"addrFrom", addr.first},
+                                {"nameFrom", getNameFrom(addr.first)},
+                                {"posttxid", itmS["postid"].As<string>()},
+                                {"parentid", itmS["parentid"].As<string>()},
+                                {"answerid", itmS["answerid"].As<string>()},
+                                {"reason", "post"},
+                            };
+
+                            prepareMessage(messages, "event", itmP["address"].As<string>(), itmS["otxid"].As<string>(), txtime, cFields);
+                        }
+                    }
+
+                    // Second send notification to autor of comment if answerid not empty
+                    {
+                        reindexer::QueryResults queryResP;
+                        reindexer::Error errP = g_pocketdb->DB()->Select(
+                            reindexer::Query("Comment", 0, 1)
+                                .Where("otxid", CondEq, itmS["answerid"].As<string>())
+                                .Where("last", CondEq, true),
+                            queryResP);
+
+                        if (errP.ok() && queryResP.Count() > 0) {
+                            reindexer::Item itmP(queryResP[0].GetItem());
+
+                            custom_fields cFields{
+                                {"mesType", optype},
+                                {"addrFrom", addr.first},
+                                {"nameFrom", getNameFrom(addr.first)},
+                                {"posttxid", itmS["postid"].As<string>()},
+                                {"parentid", itmS["parentid"].As<string>()},
+                                {"answerid", itmS["answerid"].As<string>()},
+                                {"reason", "answer"},
+                            };
+
+                            prepareMessage(messages, "event", itmP["address"].As<string>(), itmS["otxid"].As<string>(), txtime, cFields);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+//-----------------------------------------------------
+void WSNotifier::loadSubscribers(const std::set<std::string>& addresses, std::map<std::string, std::set<std::string>>& subscribersByAuthor)
+{
+    if (addresses.empty())
+        return;
+
+    std::vector<std::string> _addrs(addresses.begin(), addresses.end());
+    reindexer::QueryResults queryRes;
+    reindexer::Error err = g_pocketdb->DB()->Select(
+        reindexer::Query("SubscribesView")
+            .Where("address", CondSet, _addrs),
+        queryRes);
+
+    if (!err.ok()) {
+        LogPrintf("Error: WSNotifier - load subscriptions: %s\n", err.what());
+        return;
+    }
+
+    for (auto it : queryRes) {
+        reindexer::Item itm(it.GetItem());
+        subscribersByAuthor[itm["address_to"].As<string>()].insert(itm["address"].As<string>());
+    }
+}
+
+void WSNotifier::countSubscribedShares(int height, const std::map<std::string, std::set<std::string>>& subscribersByAuthor, std::map<std::string, int>& shares)
+{
+    if (subscribersByAuthor.empty())
+        return;
+
+    reindexer::QueryResults queryRes;
+    reindexer::Error err = g_pocketdb->DB()->Select(
+        reindexer::Query("Posts")
+            .Where("block", CondEq, height),
+        queryRes);
+
+    if (!err.ok())
+        return;
+
+    for (auto it : queryRes) {
+        reindexer::Item itm(it.GetItem());
+        auto itA = subscribersByAuthor.find(itm["address"].As<string>());
+        if (itA == subscribersByAuthor.end())
+            continue;
+
+        for (const auto& subscriber : itA->second)
+            shares[subscriber] += 1;
+    }
+}
+//-----------------------------------------------------
+void WSNotifier::notify(const WSBlockDelta& delta)
+{
+    const CBlock& block = *delta.block;
+
+    // Block disconnected before notification - RIDB rows of it are gone
+    {
+        LOCK(cs_main);
+        CBlockIndex* pindex = chainActive[delta.height];
+        if (!pindex || pindex->GetBlockHash() != block.GetHash())
+            return;
+    }
+
+    // Connections not notified about this height yet
+    std::vector<WSConnection> clients = WSConnections.TakeForHeight(delta.height);
+    if (clients.empty())
+        return;
+
+    BlockMessages blockMessages;
+    prepareMessages(block, blockMessages);
+
+    // Subscriptions are read for every block, so clients always get
+    // counts by current subscriptions, whatever blocks were skipped
+    std::set<std::string> addresses;
+    for (const auto& client : clients)
+        addresses.insert(client.second.Address);
+
+    std::map<std::string, std::set<std::string>> subscribersByAuthor;
+    loadSubscribers(addresses, subscribersByAuthor);
+
+    std::map<std::string, int> sharesSubscr;
+    countSubscribedShares(delta.height, subscribersByAuthor, sharesSubscr);
+
+    UniValue contentsLang(UniValue::VOBJ);
+    for (const auto& itemContent : blockMessages.contentLangCnt) {
+        UniValue langContents(UniValue::VOBJ);
+        for (const auto& itemLang : itemContent.second) {
+            langContents.pushKV(itemLang.first, itemLang.second);
+        }
+        contentsLang.pushKV(getcontenttype(getcontenttype(itemContent.first)), langContents);
+    }
+
+    std::string msgPocketnet;
+    if (blockMessages.txidpocketnet != "") {
+        UniValue m(UniValue::VOBJ);
+        m.pushKV("msg", "sharepocketnet");
+        m.pushKV("time", std::to_string(block.nTime));
+        m.pushKV("txids", blockMessages.txidpocketnet.substr(0, blockMessages.txidpocketnet.size() - 1));
+        msgPocketnet = m.write();
+    }
+
+    std::string blockhash = block.GetHash().GetHex();
+    std::set<std::string> notified;
+    for (const auto& client : clients) {
+        const WSUser& wsUser = client.second;
+        notified.insert(client.first);
+
+        UniValue msg(UniValue::VOBJ);
+        msg.pushKV("addr", wsUser.Address);
+        msg.pushKV("msg", "new block");
+        msg.pushKV("blockhash", blockhash);
+        msg.pushKV("time", std::to_string(block.nTime));
+        msg.pushKV("height", delta.height);
+        msg.pushKV("shares", blockMessages.sharesCnt);
+        msg.pushKV("contentsLang", contentsLang);
+
+        auto itS = sharesSubscr.find(wsUser.Address);
+        if (itS != sharesSubscr.end())
+            msg.pushKV("sharesSubscr", itS->second);
+
+        WSConnections.Send(wsUser, msg.write());
+
+        if (!msgPocketnet.empty())
+            WSConnections.Send(wsUser, msgPocketnet);
+    }
+
+    // Events only for connections of their addresses
+    for (const auto& itM : blockMessages.messages) {
+        for (const auto& client : WSConnections.GetByAddress(itM.first)) {
+            if (!notified.count(client.first))
+                continue;
+
+            for (const auto& m : itM.second)
+                WSConnections.Send(client.second, m.write());
+        }
+    }
+}
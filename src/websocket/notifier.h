@@ -0,0 +1,82 @@
+// Copyright (c) 2018 PocketNet developers
+// Notifications of WebSocket clients about connected blocks
+//-----------------------------------------------------
+#ifndef WSNOTIFIER_H
+#define WSNOTIFIER_H
+//-----------------------------------------------------
+#include <primitives/block.h>
+#include <univalue.h>
+#include <websocket/registry.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+//-----------------------------------------------------
+// Connected blocks waiting for notification, oldest are dropped
+static const size_t WS_NOTIFY_QUEUE_BLOCKS = 64;
+//-----------------------------------------------------
+/* Connected block as seen by notifier */
+struct WSBlockDelta {
+    std::shared_ptr<const CBlock> block;
+    int height = 0;
+};
+//-----------------------------------------------------
+/*
+    Notifications of WebSocket clients about connected blocks.
+    ConnectTip only queues block, notifier thread prepares
+    messages from block transactions and sends them to clients.
+    Subscriptions of notified addresses are read with one select
+    into index author -> subscribers, so counts of subscribed
+    posts do not need queries per client. Blocks disconnected
+    before notification are skipped.
+    Connection with WS_SEND_QUEUE_MAX unsent messages skips
+    messages until its queue drains.
+    Events of address are sent only to its connections
+    found in WSConnections index.
+*/
+class WSNotifier
+{
+private:
+    typedef std::map<std::string, std::string> custom_fields;
+    typedef std::map<std::string, std::vector<UniValue>> WSMessages;
+
+    /* Messages of block independent of client */
+    struct BlockMessages {
+        // <address, [messages]>
+        WSMessages messages;
+        int sharesCnt = 0;
+        std::map<std::string, std::map<std::string, int>> contentLangCnt;
+        std::string txidpocketnet;
+    };
+
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::deque<WSBlockDelta> queue;
+
+    void prepareMessage(WSMessages& messages, std::string msg_type, std::string addrTo, std::string txid, int64_t txtime, custom_fields cFields = custom_fields());
+    void prepareMessages(const CBlock& block, BlockMessages& result);
+    /* <author, [subscribers]> for subscriptions of addresses, one select */
+    void loadSubscribers(const std::set<std::string>& addresses, std::map<std::string, std::set<std::string>>& subscribersByAuthor);
+    /* <subscriber, posts> for posts of block authors */
+    void countSubscribedShares(int height, const std::map<std::string, std::set<std::string>>& subscribersByAuthor, std::map<std::string, int>& shares);
+    void notify(const WSBlockDelta& delta);
+
+public:
+    /* Queue connected block for notification */
+    void Submit(const std::shared_ptr<const CBlock>& block, int height);
+
+    /* Worker thread */
+    void Thread();
+};
+
+// Worker for WSNotifier
+void ThreadWSNotify();
+
+extern std::unique_ptr<WSNotifier> g_wsnotifier;
+//-----------------------------------------------------
+#endif // WSNOTIFIER_H
@@ -0,0 +1,169 @@
+// Copyright (c) 2018 PocketNet developers
+// Registry of connected WebSocket clients
+//-----------------------------------------------------
+#include <websocket/registry.h>
+#include <util.h>
+
+#include <functional>
+//-----------------------------------------------------
+WSConnectionRegistry WSConnections;
+//-----------------------------------------------------
+WSConnectionRegistry::Shard& WSConnectionRegistry::shard(const std::string& id)
+{
+    return shards[std::hash<std::string>()(id) % WS_REGISTRY_SHARDS];
+}
+
+WSConnectionRegistry::IndexShard& WSConnectionRegistry::indexShard(const std::string& address)
+{
+    return indexShards[std::hash<std::string>()(address) % WS_REGISTRY_SHARDS];
+}
+
+void WSConnectionRegistry::index(const std::string& address, const std::string& id)
+{
+    IndexShard& s = indexShard(address);
+    LOCK(s.cs);
+    s.byAddress[address].insert(id);
+}
+
+void WSConnectionRegistry::unindex(const std::string& address, const std::string& id)
+{
+    IndexShard& s = indexShard(address);
+    LOCK(s.cs);
+    auto it = s.byAddress.find(address);
+    if (it == s.byAddress.end())
+        return;
+
+    it->second.erase(id);
+    if (it->second.empty())
+        s.byAddress.erase(it);
+}
+
+void WSConnectionRegistry::Set(const std::string& id, WSUser user)
+{
+    Shard& s = shard(id);
+    LOCK(s.cs);
+
+    auto it = s.connections.find(id);
+    if (it != s.connections.end()) {
+        // Same connection keeps its send queue
+        if (!user.Counters) user.Counters = it->second.Counters;
+
+        unindex(it->second.Address, id);
+        index(user.Address, id);
+        it->second = std::move(user);
+        return;
+    }
+
+    if (!user.Counters) user.Counters = std::make_shared<WSSendCounters>();
+
+    index(user.Address, id);
+    s.connections.emplace(id, std::move(user));
+    count += 1;
+}
+
+void WSConnectionRegistry::Erase(const std::string& id)
+{
+    Shard& s = shard(id);
+    LOCK(s.cs);
+
+    auto it = s.connections.find(id);
+    if (it == s.connections.end())
+        return;
+
+    unindex(it->second.Address, id);
+    s.connections.erase(it);
+    count -= 1;
+}
+
+WSConnectionRegistry::Stats WSConnectionRegistry::GetStats()
+{
+    Stats stats{0, 0, dropped};
+    for (auto& s : shards) {
+        LOCK(s.cs);
+        stats.connections += s.connections.size();
+        for (const auto& it : s.connections)
+            stats.pending += it.second.Counters->Pending;
+    }
+    return stats;
+}
+//-----------------------------------------------------
+std::vector<WSConnection> WSConnectionRegistry::Snapshot()
+{
+    std::vector<WSConnection> result;
+    result.reserve(count);
+    for (auto& s : shards) {
+        LOCK(s.cs);
+        for (const auto& it : s.connections)
+            result.emplace_back(it.first, it.second);
+    }
+    return result;
+}
+
+std::vector<WSConnection> WSConnectionRegistry::GetByAddress(const std::string& address)
+{
+    std::set<std::string> ids;
+    {
+        IndexShard& s = indexShard(address);
+        LOCK(s.cs);
+        auto it = s.byAddress.find(address);
+        if (it == s.byAddress.end())
+            return {};
+        ids = it->second;
+    }
+
+    std::vector<WSConnection> result;
+    for (const auto& id : ids) {
+        Shard& s = shard(id);
+        LOCK(s.cs);
+        // Connection may be closed after index was read
+        auto it = s.connections.find(id);
+        if (it != s.connections.end())
+            result.emplace_back(it->first, it->second);
+    }
+    return result;
+}
+
+std::set<std::string> WSConnectionRegistry::GetAddresses()
+{
+    std::set<std::string> result;
+    for (auto& s : indexShards) {
+        LOCK(s.cs);
+        for (const auto& it : s.byAddress)
+            result.insert(it.first);
+    }
+    return result;
+}
+
+std::vector<WSConnection> WSConnectionRegistry::TakeForHeight(int height)
+{
+    std::vector<WSConnection> result;
+    for (auto& s : shards) {
+        LOCK(s.cs);
+        for (auto& it : s.connections) {
+            if (height > it.second.Block) {
+                result.emplace_back(it.first, it.second);
+                it.second.Block = height;
+            }
+        }
+    }
+    return result;
+}
+//-----------------------------------------------------
+bool WSConnectionRegistry::Send(const WSUser& user, const std::string& message)
+{
+    std::shared_ptr<WSSendCounters> counters = user.Counters;
+    if (counters->Pending >= WS_SEND_QUEUE_MAX) {
+        dropped += 1;
+        return false;
+    }
+
+    counters->Pending += 1;
+    try {
+        user.Connection->send(message, [counters](const SimpleWeb::error_code& ec) { counters->Pending -= 1; });
+    } catch (const std::exception& e) {
+        counters->Pending -= 1;
+        LogPrintf("Error: WSConnectionRegistry::Send - %s\n", e.what());
+        return false;
+    }
+    return true;
+}
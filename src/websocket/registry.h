@@ -0,0 +1,97 @@
+// Copyright (c) 2018 PocketNet developers
+// Registry of connected WebSocket clients
+//-----------------------------------------------------
+#ifndef WSREGISTRY_H
+#define WSREGISTRY_H
+//-----------------------------------------------------
+#include <sync.h>
+#include <websocket/ws.h>
+#include <atomic>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+//-----------------------------------------------------
+// Count of independently locked parts of registry
+static const size_t WS_REGISTRY_SHARDS = 16;
+// Messages sent to one connection and not yet written to socket
+static const int WS_SEND_QUEUE_MAX = 256;
+//-----------------------------------------------------
+typedef std::pair<std::string, WSUser> WSConnection;
+//-----------------------------------------------------
+/*
+    Connected WebSocket clients by connection id.
+    Connections are spread over WS_REGISTRY_SHARDS maps with
+    own locks, so handlers of different connections do not
+    wait for each other. Readers get copies of entries and
+    never hold locks while sending.
+    Index address -> connection ids allows to find clients
+    of one address without scanning all connections. It is
+    sharded by address the same way.
+    Lock order: connection shard, then index shard.
+*/
+class WSConnectionRegistry
+{
+private:
+    struct Shard {
+        CCriticalSection cs;
+        std::map<std::string, WSUser> connections;
+    };
+
+    struct IndexShard {
+        CCriticalSection cs;
+        // <address, [connection ids]>
+        std::map<std::string, std::set<std::string>> byAddress;
+    };
+
+    Shard shards[WS_REGISTRY_SHARDS];
+    IndexShard indexShards[WS_REGISTRY_SHARDS];
+    std::atomic<size_t> count{0};
+    // Messages dropped because of full send queue
+    std::atomic<int64_t> dropped{0};
+
+    Shard& shard(const std::string& id);
+    IndexShard& indexShard(const std::string& address);
+    void index(const std::string& address, const std::string& id);
+    void unindex(const std::string& address, const std::string& id);
+
+public:
+    struct Stats {
+        size_t connections;
+        // Messages not yet written to sockets
+        int64_t pending;
+        // Messages dropped since start
+        int64_t dropped;
+    };
+
+    /* Add or replace connection */
+    void Set(const std::string& id, WSUser user);
+    void Erase(const std::string& id);
+
+    bool Empty() const { return count == 0; }
+    size_t Size() const { return count; }
+    Stats GetStats();
+
+    /* Copy of all connections */
+    std::vector<WSConnection> Snapshot();
+    /* Copy of connections of address */
+    std::vector<WSConnection> GetByAddress(const std::string& address);
+    /* Addresses with at least one connection */
+    std::set<std::string> GetAddresses();
+    /*
+        Connections not notified about height yet.
+        Marks them notified.
+    */
+    std::vector<WSConnection> TakeForHeight(int height);
+
+    /*
+        Send message if send queue of connection is not full.
+        Returns false if message is dropped.
+    */
+    bool Send(const WSUser& user, const std::string& message);
+};
+//-----------------------------------------------------
+extern WSConnectionRegistry WSConnections;
+//-----------------------------------------------------
+#endif // WSREGISTRY_H
@@ -879,6 +879,12 @@ namespace SimpleWeb {
 } // namespace SimpleWeb
 
 
+/* Backpressure of one connection, shared by copies of WSUser */
+struct WSSendCounters {
+    // Messages sent and not yet written to socket
+    std::atomic<int> Pending{0};
+};
+
 // Struct for connecting users
 struct WSUser {
     std::shared_ptr<SimpleWeb::SocketServer<SimpleWeb::WS>::Connection> Connection;
@@ -888,6 +894,7 @@ struct WSUser {
     bool Service;
     int MainPort;
     int WssPort;
+    std::shared_ptr<WSSendCounters> Counters;
 };
 
 